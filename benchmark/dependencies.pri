@@ -0,0 +1 @@
+DEPENDENCIES += tp_maps_sdl
@@ -0,0 +1,92 @@
+#include "Benchmark.h"
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>
+#include <cstdio>
+
+namespace tp_maps_sdl_benchmark
+{
+
+namespace
+{
+//##################################################################################################
+std::string escapeJSON(const std::string& text)
+{
+  std::string result;
+  result.reserve(text.size());
+  for(char c : text)
+  {
+    switch(c)
+    {
+      case '"':  result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\n': result += "\\n";  break;
+      default:
+        if(uint8_t(c)<0x20)
+        {
+          char buffer[8];
+          snprintf(buffer, sizeof(buffer), "\\u%04x", unsigned(uint8_t(c)));
+          result += buffer;
+        }
+        else
+          result += c;
+    }
+  }
+  return result;
+}
+}
+
+//##################################################################################################
+void BenchmarkResults::add(const BenchmarkResult& result)
+{
+  m_results.push_back(result);
+}
+
+//##################################################################################################
+std::string BenchmarkResults::toJSON() const
+{
+  std::string json = "{\n  \"results\": [";
+  for(size_t i=0; i<m_results.size(); i++)
+  {
+    const auto& result = m_results.at(i);
+    json += (i==0)?"\n":",\n";
+    json += "    {\"group\": \"" + escapeJSON(result.group) + "\", \"name\": \"" + escapeJSON(result.name) + "\"";
+    for(const auto& value : result.values)
+    {
+      char buffer[64];
+      snprintf(buffer, sizeof(buffer), "%.6g", value.second);
+      json += ", \"" + escapeJSON(value.first) + "\": " + buffer;
+    }
+    json += "}";
+  }
+  json += "\n  ]\n}\n";
+  return json;
+}
+
+//##################################################################################################
+double timeMS()
+{
+  return double(SDL_GetPerformanceCounter()) * 1000.0 / double(SDL_GetPerformanceFrequency());
+}
+
+//##################################################################################################
+double timeIterations(const std::function<void()>& fn, double minMS, size_t minIterations)
+{
+  // Warm up caches and lazy initialization first.
+  fn();
+
+  size_t iterations=0;
+  double start = timeMS();
+  double elapsed=0.0;
+  while(iterations<minIterations || elapsed<minMS)
+  {
+    fn();
+    iterations++;
+    elapsed = timeMS() - start;
+  }
+
+  return elapsed / double(iterations);
+}
+
+}
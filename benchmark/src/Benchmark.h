@@ -0,0 +1,45 @@
+#ifndef tp_maps_sdl_benchmark_Benchmark_h
+#define tp_maps_sdl_benchmark_Benchmark_h
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+
+namespace tp_maps_sdl_benchmark
+{
+
+//##################################################################################################
+//! A single named measurement with any number of numeric values, for example msPerIteration.
+struct BenchmarkResult
+{
+  std::string group;
+  std::string name;
+  std::vector<std::pair<std::string, double>> values;
+};
+
+//##################################################################################################
+class BenchmarkResults
+{
+public:
+  //################################################################################################
+  void add(const BenchmarkResult& result);
+
+  //################################################################################################
+  //! All of the results as a JSON document so that runs can be compared between releases.
+  std::string toJSON() const;
+
+private:
+  std::vector<BenchmarkResult> m_results;
+};
+
+//##################################################################################################
+double timeMS();
+
+//##################################################################################################
+//! Run fn repeatedly for at least minMS and at least minIterations, returns the mean time in ms.
+double timeIterations(const std::function<void()>& fn, double minMS=200.0, size_t minIterations=3);
+
+}
+
+#endif
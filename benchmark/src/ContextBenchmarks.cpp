@@ -0,0 +1,58 @@
+#include "ContextBenchmarks.h"
+
+#include "tp_maps_sdl/Map.h"
+
+#include <SDL2/SDL.h>
+
+namespace tp_maps_sdl_benchmark
+{
+
+//##################################################################################################
+void contextBenchmarks(BenchmarkResults& results)
+{
+  // Force Mesa onto llvmpipe so results are comparable between machines, unless already set.
+  SDL_setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+  SDL_setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+
+  // The first run may not have a cached profile, the rest should.
+  constexpr size_t runs=5;
+  for(size_t run=0; run<runs; run++)
+  {
+    double start = timeMS();
+    double constructMS{0.0};
+    tp_maps_sdl::StartupTimings timings;
+    bool valid{false};
+    std::string framebuffer;
+    {
+      tp_maps_sdl::Map map(true);
+      constructMS = timeMS() - start;
+      timings = map.startupTimings();
+      valid = SDL_GL_GetCurrentContext() != nullptr;
+      framebuffer = tp_maps_sdl::framebufferConfigToString(map.framebufferConfig());
+    }
+    double totalMS = timeMS() - start;
+
+    if(!valid)
+    {
+      SDL_Log("Context benchmark skipped, no OpenGL context could be created.");
+      return;
+    }
+
+    BenchmarkResult result;
+    result.group = "context";
+    result.name = "run" + std::to_string(run) + (timings.cachedProfile?"_cached":"_uncached");
+    result.values.emplace_back("sdlInitMS", timings.sdlInitMS);
+    result.values.emplace_back("windowMS", timings.windowMS);
+    result.values.emplace_back("contextMS", timings.contextMS);
+    result.values.emplace_back("initializeGLMS", timings.initializeGLMS);
+    result.values.emplace_back("attempts", double(timings.attempts));
+    result.values.emplace_back("constructMS", constructMS);
+    result.values.emplace_back("constructAndDestroyMS", totalMS);
+    results.add(result);
+
+    if(run==0)
+      SDL_Log("Context benchmark framebuffer: %s", framebuffer.c_str());
+  }
+}
+
+}
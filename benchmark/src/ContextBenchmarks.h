@@ -0,0 +1,15 @@
+#ifndef tp_maps_sdl_benchmark_ContextBenchmarks_h
+#define tp_maps_sdl_benchmark_ContextBenchmarks_h
+
+#include "Benchmark.h"
+
+namespace tp_maps_sdl_benchmark
+{
+
+//##################################################################################################
+//! Window and OpenGL context bring-up in the Map constructor, forced onto llvmpipe.
+void contextBenchmarks(BenchmarkResults& results);
+
+}
+
+#endif
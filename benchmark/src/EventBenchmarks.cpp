@@ -0,0 +1,132 @@
+#include "EventBenchmarks.h"
+
+#include "tp_maps_sdl/Map.h"
+
+#include <SDL2/SDL.h>
+
+namespace tp_maps_sdl_benchmark
+{
+
+namespace
+{
+//##################################################################################################
+//! Push count events of the kind made by makeEvent, in batches that fit in the SDL event queue.
+template<typename MakeEvent, typename Drain>
+double pushAndDrain(size_t count, const MakeEvent& makeEvent, const Drain& drain)
+{
+  constexpr size_t batchSize=4096;
+
+  double start = timeMS();
+  for(size_t i=0; i<count; i+=batchSize)
+  {
+    for(size_t j=i; j<count && j<i+batchSize; j++)
+    {
+      SDL_Event event = makeEvent(j);
+      SDL_PushEvent(&event);
+    }
+    drain();
+  }
+  return timeMS() - start;
+}
+
+//##################################################################################################
+struct EventKind
+{
+  std::string name;
+  std::function<SDL_Event(size_t)> makeEvent;
+};
+
+//##################################################################################################
+std::vector<EventKind> eventKinds()
+{
+  std::vector<EventKind> kinds;
+
+  kinds.push_back({"mouseMotion", [](size_t i)
+  {
+    SDL_Event event{};
+    event.type = SDL_MOUSEMOTION;
+    event.motion.x = int(i%640);
+    event.motion.y = int((i/640)%480);
+    event.motion.xrel = 1;
+    return event;
+  }});
+
+  kinds.push_back({"mouseButton", [](size_t i)
+  {
+    SDL_Event event{};
+    event.type = (i%2)?SDL_MOUSEBUTTONUP:SDL_MOUSEBUTTONDOWN;
+    event.button.button = SDL_BUTTON_LEFT;
+    event.button.clicks = 1;
+    event.button.x = 100;
+    event.button.y = 100;
+    return event;
+  }});
+
+  kinds.push_back({"mouseWheel", [](size_t i)
+  {
+    SDL_Event event{};
+    event.type = SDL_MOUSEWHEEL;
+    event.wheel.y = (i%2)?1:-1;
+    return event;
+  }});
+
+  kinds.push_back({"key", [](size_t i)
+  {
+    SDL_Event event{};
+    event.type = (i%2)?SDL_KEYUP:SDL_KEYDOWN;
+    event.key.keysym.scancode = SDL_SCANCODE_A;
+    event.key.keysym.sym = SDLK_a;
+    return event;
+  }});
+
+  kinds.push_back({"textInput", [](size_t)
+  {
+    SDL_Event event{};
+    event.type = SDL_TEXTINPUT;
+    event.text.text[0] = 'a';
+    return event;
+  }});
+
+  return kinds;
+}
+}
+
+//##################################################################################################
+void eventBenchmarks(BenchmarkResults& results)
+{
+  // Restored afterwards so that the context benchmarks get a real driver.
+  std::string previousDriver;
+  if(const char* driver = SDL_getenv("SDL_VIDEODRIVER"); driver)
+    previousDriver = driver;
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+
+  {
+    tp_maps_sdl::Map map(false);
+
+    constexpr size_t count=100000;
+    for(const auto& kind : eventKinds())
+    {
+      // SDL alone, to separate the cost of the SDL queue from the translation in processEvents().
+      double sdlMS = pushAndDrain(count, kind.makeEvent, []
+      {
+        SDL_Event event;
+        while(SDL_PollEvent(&event)){}
+      });
+
+      double mapMS = pushAndDrain(count, kind.makeEvent, [&]{map.processEvents();});
+
+      BenchmarkResult result;
+      result.group = "events";
+      result.name = kind.name;
+      result.values.emplace_back("nsPerEventSDL", sdlMS*1e6/double(count));
+      result.values.emplace_back("nsPerEventMap", mapMS*1e6/double(count));
+      result.values.emplace_back("nsPerEventTranslation", (mapMS-sdlMS)*1e6/double(count));
+      result.values.emplace_back("eventsPerSecond", double(count)*1000.0/mapMS);
+      results.add(result);
+    }
+  }
+
+  SDL_setenv("SDL_VIDEODRIVER", previousDriver.c_str(), 1);
+}
+
+}
@@ -0,0 +1,15 @@
+#ifndef tp_maps_sdl_benchmark_EventBenchmarks_h
+#define tp_maps_sdl_benchmark_EventBenchmarks_h
+
+#include "Benchmark.h"
+
+namespace tp_maps_sdl_benchmark
+{
+
+//##################################################################################################
+//! Throughput of Map::processEvents() for synthetic input under the dummy video driver.
+void eventBenchmarks(BenchmarkResults& results);
+
+}
+
+#endif
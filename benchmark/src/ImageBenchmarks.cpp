@@ -0,0 +1,250 @@
+#include "ImageBenchmarks.h"
+
+#include "tp_maps_sdl/Globals.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include <cstdlib>
+#include <cstring>
+
+// IMG_SaveJPG_RW was added in SDL_image 2.0.2.
+#if defined(SDL_IMAGE_VERSION_ATLEAST)
+#  if SDL_IMAGE_VERSION_ATLEAST(2, 0, 2)
+#    define TP_HAS_IMG_SAVE_JPG
+#  endif
+#endif
+
+namespace tp_maps_sdl_benchmark
+{
+
+namespace
+{
+//##################################################################################################
+//! Gradients with some noise and flat areas, roughly like icons and map tiles.
+std::vector<uint8_t> makeImage(size_t w, size_t h)
+{
+  std::vector<uint8_t> rgba(w*h*4);
+  uint32_t seed=1;
+  for(size_t y=0; y<h; y++)
+  {
+    for(size_t x=0; x<w; x++)
+    {
+      seed = seed*1664525u + 1013904223u;
+      uint8_t* p = rgba.data() + (y*w+x)*4;
+      bool flat = ((x/32 + y/32) % 3) == 0;
+      uint8_t noise = flat?0:uint8_t((seed>>24) & 0x0f);
+      p[0] = uint8_t((x*255)/w + noise);
+      p[1] = uint8_t((y*255)/h + noise);
+      p[2] = uint8_t(((x+y)*127)/(w+h) + noise);
+      p[3] = flat?255:uint8_t(200 + (seed>>28));
+    }
+  }
+  return rgba;
+}
+
+//##################################################################################################
+std::vector<uint8_t> encodeQOI(const std::vector<uint8_t>& rgba, size_t w, size_t h)
+{
+  std::vector<uint8_t> out = {'q', 'o', 'i', 'f'};
+  for(uint32_t v : {uint32_t(w), uint32_t(h)})
+    for(int s=24; s>=0; s-=8)
+      out.push_back(uint8_t(v>>s));
+  out.push_back(4);
+  out.push_back(0);
+
+  uint8_t index[64][4];
+  std::memset(index, 0, sizeof(index));
+  uint8_t prev[4] = {0, 0, 0, 255};
+  size_t run=0;
+  size_t count=w*h;
+
+  for(size_t i=0; i<count; i++)
+  {
+    const uint8_t* p = rgba.data() + i*4;
+    if(std::memcmp(p, prev, 4) == 0)
+    {
+      run++;
+      if(run==62 || i==count-1)
+      {
+        out.push_back(uint8_t(0xc0 | (run-1)));
+        run=0;
+      }
+      continue;
+    }
+
+    if(run)
+    {
+      out.push_back(uint8_t(0xc0 | (run-1)));
+      run=0;
+    }
+
+    size_t hash = (p[0]*3 + p[1]*5 + p[2]*7 + p[3]*11) % 64;
+    if(std::memcmp(index[hash], p, 4) == 0)
+      out.push_back(uint8_t(hash));
+    else
+    {
+      std::memcpy(index[hash], p, 4);
+      if(p[3] == prev[3])
+      {
+        int vr = int8_t(p[0]-prev[0]);
+        int vg = int8_t(p[1]-prev[1]);
+        int vb = int8_t(p[2]-prev[2]);
+        int vgr = vr-vg;
+        int vgb = vb-vg;
+        if(vr>-3 && vr<2 && vg>-3 && vg<2 && vb>-3 && vb<2)
+          out.push_back(uint8_t(0x40 | (vr+2)<<4 | (vg+2)<<2 | (vb+2)));
+        else if(vgr>-9 && vgr<8 && vg>-33 && vg<32 && vgb>-9 && vgb<8)
+        {
+          out.push_back(uint8_t(0x80 | (vg+32)));
+          out.push_back(uint8_t((vgr+8)<<4 | (vgb+8)));
+        }
+        else
+          out.insert(out.end(), {0xfe, p[0], p[1], p[2]});
+      }
+      else
+        out.insert(out.end(), {0xff, p[0], p[1], p[2], p[3]});
+    }
+
+    std::memcpy(prev, p, 4);
+  }
+
+  out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+  return out;
+}
+
+//##################################################################################################
+std::vector<uint8_t> encodeTGA(const std::vector<uint8_t>& rgba, size_t w, size_t h)
+{
+  // Uncompressed 32 bit with a top left origin, the same row order as the source.
+  std::vector<uint8_t> out(18, 0);
+  out[2] = 2;
+  out[12] = uint8_t(w); out[13] = uint8_t(w>>8);
+  out[14] = uint8_t(h); out[15] = uint8_t(h>>8);
+  out[16] = 32;
+  out[17] = 0x28;
+
+  out.reserve(18 + w*h*4);
+  for(size_t i=0; i<w*h; i++)
+  {
+    const uint8_t* p = rgba.data() + i*4;
+    out.insert(out.end(), {p[2], p[1], p[0], p[3]});
+  }
+  return out;
+}
+
+//##################################################################################################
+std::vector<uint8_t> encodePPM(const std::vector<uint8_t>& rgba, size_t w, size_t h)
+{
+  std::string header = "P6\n" + std::to_string(w) + " " + std::to_string(h) + "\n255\n";
+  std::vector<uint8_t> out(header.begin(), header.end());
+  out.reserve(out.size() + w*h*3);
+  for(size_t i=0; i<w*h; i++)
+    out.insert(out.end(), rgba.begin()+std::ptrdiff_t(i*4), rgba.begin()+std::ptrdiff_t(i*4+3));
+  return out;
+}
+
+//##################################################################################################
+std::vector<uint8_t> encodeSDL(const std::vector<uint8_t>& rgba, size_t w, size_t h, bool jpeg)
+{
+  std::vector<uint8_t> out;
+
+  auto surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint8_t*>(rgba.data()), int(w), int(h), 32, int(w*4), SDL_PIXELFORMAT_ABGR8888);
+  if(!surface)
+    return out;
+
+  size_t capacity = w*h*4 + h + 65536;
+  std::vector<uint8_t> buffer(capacity);
+  auto rw = SDL_RWFromMem(buffer.data(), int(capacity));
+
+#ifdef TP_HAS_IMG_SAVE_JPG
+  int r = jpeg?IMG_SaveJPG_RW(surface, rw, 0, 90):IMG_SavePNG_RW(surface, rw, 0);
+#else
+  int r = jpeg?-1:IMG_SavePNG_RW(surface, rw, 0);
+#endif
+
+  if(r==0)
+    out.assign(buffer.begin(), buffer.begin()+SDL_RWtell(rw));
+
+  SDL_RWclose(rw);
+  SDL_FreeSurface(surface);
+  return out;
+}
+
+//##################################################################################################
+//! Mean absolute difference per channel between a decoded image and its source, -1 if the size differs.
+double meanChannelError(const tp_image_utils::ColorMap& image, const std::vector<uint8_t>& rgba, size_t w, size_t h, bool compareAlpha)
+{
+  if(image.width() != w || image.height() != h)
+    return -1.0;
+
+  // The source rows are top down and ColorMap rows are bottom up.
+  uint64_t total=0;
+  const TPPixel* dst = image.constData();
+  for(size_t y=0; y<h; y++)
+  {
+    for(size_t x=0; x<w; x++)
+    {
+      const uint8_t* p = rgba.data() + ((h-1-y)*w+x)*4;
+      const TPPixel& d = dst[y*w+x];
+      total += uint64_t(std::abs(int(d.r)-int(p[0])));
+      total += uint64_t(std::abs(int(d.g)-int(p[1])));
+      total += uint64_t(std::abs(int(d.b)-int(p[2])));
+      total += uint64_t(std::abs(int(d.a)-int(compareAlpha?p[3]:255)));
+    }
+  }
+
+  return double(total) / double(w*h*4);
+}
+}
+
+//##################################################################################################
+void imageBenchmarks(BenchmarkResults& results)
+{
+  for(size_t size : {size_t(256), size_t(1024), size_t(4096)})
+  {
+    auto rgba = makeImage(size, size);
+
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> encoded =
+    {
+      {"png", encodeSDL(rgba, size, size, false)},
+      {"jpg", encodeSDL(rgba, size, size, true)},
+      {"qoi", encodeQOI(rgba, size, size)},
+      {"tga", encodeTGA(rgba, size, size)},
+      {"ppm", encodePPM(rgba, size, size)}
+    };
+
+    for(const auto& [format, data] : encoded)
+    {
+      if(data.empty())
+        continue;
+
+      // Check the pixels once before timing, a decoder that is fast but wrong should not be reported.
+      // PPM and JPEG have no alpha and JPEG is lossy, the rest must round trip exactly.
+      bool lossy = (format=="jpg");
+      bool hasAlpha = (format!="jpg" && format!="ppm");
+      double error = meanChannelError(tp_maps_sdl::loadTextureFromData(data.data(), data.size(), format), rgba, size, size, hasAlpha);
+      if(error<0.0 || error>(lossy?8.0:0.0))
+      {
+        SDL_Log("Decode failed: %s_%zu mean channel error %f", format.c_str(), size, error);
+        continue;
+      }
+
+      double ms = timeIterations([&]
+      {
+        tp_maps_sdl::loadTextureFromData(data.data(), data.size(), format);
+      });
+
+      BenchmarkResult result;
+      result.group = "decode";
+      result.name = format + "_" + std::to_string(size);
+      result.values.emplace_back("msPerImage", ms);
+      result.values.emplace_back("megapixelsPerSecond", double(size*size) / (ms*1000.0));
+      result.values.emplace_back("encodedBytes", double(data.size()));
+      result.values.emplace_back("meanChannelError", error);
+      results.add(result);
+    }
+  }
+}
+
+}
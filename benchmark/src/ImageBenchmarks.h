@@ -0,0 +1,15 @@
+#ifndef tp_maps_sdl_benchmark_ImageBenchmarks_h
+#define tp_maps_sdl_benchmark_ImageBenchmarks_h
+
+#include "Benchmark.h"
+
+namespace tp_maps_sdl_benchmark
+{
+
+//##################################################################################################
+//! Decode throughput of loadTextureFromData() for each format at several sizes.
+void imageBenchmarks(BenchmarkResults& results);
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+#include "ImageBenchmarks.h"
+#include "EventBenchmarks.h"
+#include "ContextBenchmarks.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_main.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace tp_maps_sdl_benchmark;
+
+//##################################################################################################
+//! Usage: tp_maps_sdl_benchmark [--output results.json] [--skip-events] [--skip-context]
+int main(int argc, char* argv[])
+{
+  std::string output;
+  bool skipEvents=false;
+  bool skipContext=false;
+  for(int i=1; i<argc; i++)
+  {
+    if(std::strcmp(argv[i], "--output")==0 && (i+1)<argc)
+      output = argv[++i];
+    else if(std::strcmp(argv[i], "--skip-events")==0)
+      skipEvents = true;
+    else if(std::strcmp(argv[i], "--skip-context")==0)
+      skipContext = true;
+  }
+
+  if(SDL_Init(SDL_INIT_EVENTS) != 0)
+  {
+    fprintf(stderr, "Failed to initialize SDL: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  BenchmarkResults results;
+  imageBenchmarks(results);
+
+  // Each Map calls SDL_Quit() when it is destroyed, so these run last.
+  if(!skipEvents)
+    eventBenchmarks(results);
+
+  if(!skipContext)
+    contextBenchmarks(results);
+
+  auto json = results.toJSON();
+  if(output.empty())
+    fputs(json.c_str(), stdout);
+  else
+    std::ofstream(output) << json;
+
+  SDL_Quit();
+  return 0;
+}
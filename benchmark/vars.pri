@@ -0,0 +1,16 @@
+TARGET = tp_maps_sdl_benchmark
+TEMPLATE = app
+
+SOURCES += src/main.cpp
+
+SOURCES += src/Benchmark.cpp
+HEADERS += src/Benchmark.h
+
+SOURCES += src/ImageBenchmarks.cpp
+HEADERS += src/ImageBenchmarks.h
+
+SOURCES += src/EventBenchmarks.cpp
+HEADERS += src/EventBenchmarks.h
+
+SOURCES += src/ContextBenchmarks.cpp
+HEADERS += src/ContextBenchmarks.h
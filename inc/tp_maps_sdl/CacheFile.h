@@ -0,0 +1,36 @@
+#ifndef tp_maps_sdl_CacheFile_h
+#define tp_maps_sdl_CacheFile_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <filesystem>
+
+namespace tp_maps_sdl
+{
+
+// Shared by the on disk caches, these are not part of the public API.
+
+//##################################################################################################
+//! The FNV-1a offset basis, pass this as the hash for the first call to fnv1a().
+constexpr uint64_t fnv1aSeed = 14695981039346656037ull;
+
+//##################################################################################################
+//! 64 bit FNV-1a, stable across platforms and launches so it can name files and resources.
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size);
+
+//##################################################################################################
+//! 16 lower case hex digits.
+std::string hashToHex(uint64_t hash);
+
+//##################################################################################################
+//! Write data to a temporary file next to path and rename it over path.
+/*!
+The temporary name is unique to the process and the call, so threads and processes sharing a cache
+directory never write into the same file, and rename is atomic on the same volume so readers never see
+a truncated file. On failure the temporary file is removed and a warning is logged.
+*/
+bool writeFileAtomic(const std::filesystem::path& path, const std::string& data);
+
+}
+
+#endif
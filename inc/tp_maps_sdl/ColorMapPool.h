@@ -0,0 +1,65 @@
+#ifndef tp_maps_sdl_ColorMapPool_h
+#define tp_maps_sdl_ColorMapPool_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct ColorMapPoolStats
+{
+  size_t hits{0};         //!< Requests served from the pool.
+  size_t misses{0};       //!< Requests that needed a new allocation.
+  size_t evictions{0};    //!< Buffers freed to keep the pool under its limit.
+  size_t pooledBytes{0};  //!< Memory currently held by the pool.
+};
+
+//##################################################################################################
+//! Recycle decoded pixel buffers so that streaming many same sized images does not churn the heap.
+/*!
+Buffers are pooled by their exact size, which suits tile streaming where almost every image is 256²
+or 512². Give images back once they have been uploaded, when the pool grows past maxBytes the least
+recently returned buffers are freed. This is thread safe.
+
+\code
+TextureLoadOptions options;
+options.pool = &pool;
+auto image = loadTextureFromData(data, size, name, options);
+// Upload the image...
+pool.give(std::move(image));
+\endcode
+*/
+class ColorMapPool
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  ColorMapPool(size_t maxBytes=256*1024*1024);
+
+  //################################################################################################
+  ~ColorMapPool();
+
+  //################################################################################################
+  //! Return a pooled image of exactly this size, the contents are undefined.
+  tp_image_utils::ColorMap take(size_t width, size_t height);
+
+  //################################################################################################
+  //! Return an image to the pool, empty images are ignored.
+  void give(tp_image_utils::ColorMap&& colorMap);
+
+  //################################################################################################
+  //! Free all of the pooled buffers.
+  void clear();
+
+  //################################################################################################
+  //! Free the least recently returned buffers until at most maxBytes remain, returns the bytes freed.
+  size_t trim(size_t maxBytes);
+
+  //################################################################################################
+  ColorMapPoolStats stats() const;
+};
+
+}
+
+#endif
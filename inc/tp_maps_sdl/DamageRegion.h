@@ -0,0 +1,69 @@
+#ifndef tp_maps_sdl_DamageRegion_h
+#define tp_maps_sdl_DamageRegion_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! A rectangle in drawable pixels with a bottom left origin, the same as glScissor and EGL.
+struct DamageRect
+{
+  int x{0};
+  int y{0};
+  int width{0};
+  int height{0};
+};
+
+//##################################################################################################
+//! The smallest rect containing all of rects, zero sized if rects is empty.
+DamageRect boundingRect(const std::vector<DamageRect>& rects);
+
+//##################################################################################################
+//! Collect the regions of the window that changed each frame.
+/*!
+A frame with no damage reported is treated as a full repaint, so callers that never report damage
+behave exactly as before. When a back buffer is reused its contents are bufferAge frames old, so the
+region that needs to be repainted is the union of the damage from the last bufferAge frames while only
+the current frame's damage needs to be presented.
+*/
+class DamageTracker
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! Frames with more rects than maxRects are reduced to their bounding rect.
+  DamageTracker(size_t maxRects=16, size_t maxBufferAge=4);
+
+  //################################################################################################
+  ~DamageTracker();
+
+  //################################################################################################
+  void addDamage(const DamageRect& rect);
+
+  //################################################################################################
+  //! Force the next frame to be a full repaint, for example after a resize.
+  void damageAll();
+
+  //################################################################################################
+  //! Work out what to repaint and present for the next frame, returns false for a full frame.
+  /*!
+  \param bufferAge - The age of the back buffer, 0 if unknown which forces a full frame.
+  \param repaint - The rects that must be redrawn, clipped to the drawable.
+  \param present - The rects that changed this frame, for swap with damage or incremental present.
+  */
+  bool frameDamage(size_t bufferAge,
+                   int width,
+                   int height,
+                   std::vector<DamageRect>& repaint,
+                   std::vector<DamageRect>& present) const;
+
+  //################################################################################################
+  //! Move this frame's damage into the history, call after presenting.
+  void endFrame();
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef tp_maps_sdl_FramePacer_h
+#define tp_maps_sdl_FramePacer_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+struct SDL_Window;
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Schedule frames on a fixed cadence that follows the display refresh rate.
+/*!
+Frame deadlines are kept in nanoseconds on a monotonic clock and advance by exactly one period each
+frame so that there is no drift. Waiting sleeps coarsely until shortly before the deadline then spins
+for the remainder, the spin margin adapts to how late the OS wakes the thread up.
+
+If a frame runs late by more than a whole period the schedule restarts from now, rather than
+rushing through several frames to catch up.
+*/
+class FramePacer
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  FramePacer();
+
+  //################################################################################################
+  ~FramePacer();
+
+  //################################################################################################
+  //! The window whose display sets the refresh rate, call displayChanged() when it moves.
+  void setWindow(SDL_Window* window);
+
+  //################################################################################################
+  //! Read the refresh rate of the display that the window is on again.
+  void displayChanged();
+
+  //################################################################################################
+  //! The refresh rate of the current display in Hz, 60 if SDL does not know.
+  double refreshRate() const;
+
+  //################################################################################################
+  //! Frames per second to aim for, 0 to follow the refresh rate. This also caps the frame rate.
+  void setTargetFPS(double targetFPS);
+
+  //################################################################################################
+  double targetFPS() const;
+
+  //################################################################################################
+  //! The period that is actually being used in nanoseconds.
+  uint64_t framePeriodNS() const;
+
+  //################################################################################################
+  //! Returns true and advances the schedule if the deadline for the next frame has been reached.
+  bool beginFrame();
+
+  //################################################################################################
+  //! The time of the frame started by the last beginFrame() in the same ms as currentTimeMS().
+  /*!
+  This is the scheduled time not the time beginFrame() was called, so animation steps by an exact
+  number of periods each frame.
+  */
+  double frameTimeMS() const;
+
+  //################################################################################################
+  //! Sleep until the deadline for the next frame.
+  void waitForNextFrame();
+
+  //################################################################################################
+  //! Monotonic clock in nanoseconds.
+  static uint64_t nowNS();
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef tp_maps_sdl_FramebufferConfig_h
+#define tp_maps_sdl_FramebufferConfig_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+struct VulkanAttachmentConfig;
+class Vulkan;
+
+//##################################################################################################
+enum class SwapBuffering
+{
+  Single,
+  Double,
+  Triple  //!< Vulkan only, OpenGL has no way to request it and reports Double.
+};
+
+//##################################################################################################
+//! The default framebuffer that is requested for the window, or obtained once it is created.
+/*!
+Depth, stencil and multisample buffers are sized to the window, so a 2D map view that sets depthBits,
+stencilBits and samples to zero saves tens of megabytes on a 4K display.
+*/
+struct FramebufferConfig
+{
+  int depthBits{24};   //!< 0 for no depth buffer.
+  int stencilBits{8};  //!< 0 for no stencil buffer.
+  int samples{4};      //!< 0 or 1 for no multisampling.
+  bool srgb{false};    //!< An sRGB capable color buffer.
+  bool alpha{false};   //!< A color buffer with an alpha channel.
+  SwapBuffering buffering{SwapBuffering::Double};
+};
+
+//##################################################################################################
+std::string framebufferConfigToString(const FramebufferConfig& config);
+
+//##################################################################################################
+//! Set the SDL_GL attributes for config before a window and context are created.
+/*!
+\param allowMultisample false for profiles where multisampled default framebuffers are unreliable.
+*/
+void setGLFramebufferAttributes(const FramebufferConfig& config, bool allowMultisample);
+
+//##################################################################################################
+//! Read the configuration of the current OpenGL context back from SDL.
+FramebufferConfig currentGLFramebufferConfig();
+
+//##################################################################################################
+VulkanAttachmentConfig vulkanAttachmentConfig(const FramebufferConfig& config);
+
+//##################################################################################################
+//! The configuration that a Vulkan instance actually obtained.
+FramebufferConfig vulkanFramebufferConfig(const Vulkan& vulkan);
+
+}
+
+#endif
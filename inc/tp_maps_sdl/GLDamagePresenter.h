@@ -0,0 +1,66 @@
+#ifndef tp_maps_sdl_GLDamagePresenter_h
+#define tp_maps_sdl_GLDamagePresenter_h
+
+#include "tp_maps_sdl/DamageRegion.h"
+
+struct SDL_Window;
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Partial repaint and present through EGL where SDL is using it.
+/*!
+Uses EGL_EXT_buffer_age or EGL_KHR_partial_update to find out how old the back buffer is,
+EGL_KHR_partial_update to tell the driver which pixels will be drawn and
+EGL_KHR/EXT_swap_buffers_with_damage to tell the compositor which pixels changed. GLX and WGL have no
+equivalent so on those bufferAge() returns 0 and the caller should draw and present full frames.
+
+Swapping with damage bypasses SDL_GL_SwapWindow(), so it is only done on video drivers where that is a
+plain eglSwapBuffers(). Wayland and KMSDRM always present through SDL.
+
+This must be constructed and used with the OpenGL context current.
+*/
+class GLDamagePresenter
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  GLDamagePresenter(SDL_Window* window);
+
+  //################################################################################################
+  ~GLDamagePresenter();
+
+  //################################################################################################
+  //! True if the back buffer age can be queried, without this partial repaints are not possible.
+  bool isSupported() const;
+
+  //################################################################################################
+  //! The age of the back buffer in frames, 0 if unknown or undefined.
+  size_t bufferAge() const;
+
+  //################################################################################################
+  //! Call before drawing anything with the rects that need to be repainted this frame.
+  void beginFrame(const std::vector<DamageRect>& repaint);
+
+  //################################################################################################
+  //! Restrict drawing to the repaint rects, call with the default framebuffer bound.
+  /*!
+  Call this just before the final pass draws into the window, once everything drawn into other
+  framebuffers is done, those have their own sizes and must not be clipped to window coordinates.
+  Without this call the whole frame is drawn and only the presented region is reduced.
+  */
+  void scissorDefaultFramebuffer();
+
+  //################################################################################################
+  //! Disable the scissor set by scissorDefaultFramebuffer().
+  void endFrame();
+
+  //################################################################################################
+  //! Swap presenting only rects, empty rects or no extension falls back to SDL_GL_SwapWindow().
+  void swap(const std::vector<DamageRect>& present);
+};
+
+}
+
+#endif
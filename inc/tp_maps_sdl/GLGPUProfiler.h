@@ -0,0 +1,41 @@
+#ifndef tp_maps_sdl_GLGPUProfiler_h
+#define tp_maps_sdl_GLGPUProfiler_h
+
+#include "tp_maps_sdl/GPUProfiler.h"
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! GPU profiling using GL_TIMESTAMP queries (OpenGL 3.3 or GL_ARB_timer_query).
+/*!
+This must be constructed, used and destroyed with the OpenGL context current. If timer queries are
+not available isSupported() will return false and all scopes will be ignored.
+*/
+class GLGPUProfiler : public GPUProfiler
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  GLGPUProfiler(size_t framesInFlight=4, size_t maxScopesPerFrame=64, size_t historySize=120);
+
+  //################################################################################################
+  ~GLGPUProfiler() override;
+
+  //################################################################################################
+  bool isSupported() const override;
+
+protected:
+  //################################################################################################
+  void resetQueries(size_t frame, size_t queryCount) override;
+
+  //################################################################################################
+  void writeTimestamp(size_t frame, size_t query, bool endOfScope) override;
+
+  //################################################################################################
+  bool readTimestamps(size_t frame, size_t queryCount, std::vector<uint64_t>& nanoseconds) override;
+};
+
+}
+
+#endif
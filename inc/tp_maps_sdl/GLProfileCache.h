@@ -0,0 +1,47 @@
+#ifndef tp_maps_sdl_GLProfileCache_h
+#define tp_maps_sdl_GLProfileCache_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Remember which OpenGL profile worked on this machine so that it can be tried first next time.
+/*!
+Each failed attempt at creating a window and context can take hundreds of milliseconds on remote and
+virtualized drivers. The name of the profile that worked is stored along with the attributes of the
+context it produced and the SDL video driver, GL_RENDERER and GL_VERSION. The cache is ignored if the
+SDL video driver changes, and rewritten once a context is created if anything else has changed.
+*/
+class GLProfileCache
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! path is the cache file, empty to use a per-user file from SDL_GetPrefPath.
+  GLProfileCache(const std::string& path=std::string());
+
+  //################################################################################################
+  ~GLProfileCache();
+
+  //################################################################################################
+  //! The profile that worked last time, or an empty string.
+  const std::string& profile() const;
+
+  //################################################################################################
+  //! Set the multisample and depth attributes that the cached profile produced last time.
+  /*!
+  Nothing is set unless framebufferConfig matches the one passed to store(), so a change in the
+  requested framebuffer is never overridden by attributes cached for a different request.
+  */
+  void applyAttributes(const std::string& framebufferConfig=std::string()) const;
+
+  //################################################################################################
+  //! Call with the context current after it has been created successfully.
+  void store(const std::string& profile, const std::string& framebufferConfig=std::string());
+};
+
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef tp_maps_sdl_GLProgramBinaryCache_h
+#define tp_maps_sdl_GLProgramBinaryCache_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include "tp_maps/Globals.h"
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct GLProgramBinaryCacheStats
+{
+  size_t hits{0};     //!< Programs loaded from a cached binary.
+  size_t misses{0};   //!< Programs that had no cached binary.
+  size_t rejected{0}; //!< Cached binaries the driver refused, these are deleted and recompiled.
+  size_t stored{0};   //!< Binaries written to the cache.
+};
+
+//##################################################################################################
+struct GLProgramBinaryCacheParams
+{
+  std::string directory;                  //!< Empty to use a per-user directory from SDL_GetPrefPath.
+  size_t maxBytes{64*1024*1024};
+};
+
+//##################################################################################################
+//! Persistent cache of linked GL program binaries.
+/*!
+Binaries are keyed by a hash of the shader sources, the shader profile and the GL_VENDOR,
+GL_RENDERER and GL_VERSION strings so a driver update invalidates the whole cache. Files are written
+to a temporary name and renamed into place so a crash never leaves a truncated binary behind, and
+the least recently used binaries are evicted once the cache grows past maxBytes.
+
+This must be constructed and used with the OpenGL context current. If neither OpenGL 4.1,
+GL_ARB_get_program_binary or GL_OES_get_program_binary are available isSupported() returns false,
+load() always misses and save() does nothing.
+
+\code
+auto key = cache->makeKey({vertexSource, fragmentSource});
+GLuint program = glCreateProgram();
+if(!cache->load(program, key))
+{
+  // Attach and compile shaders...
+  cache->prepareProgram(program);
+  glLinkProgram(program);
+  cache->save(program, key);
+}
+\endcode
+*/
+class GLProgramBinaryCache
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  GLProgramBinaryCache(tp_maps::ShaderProfile shaderProfile, const GLProgramBinaryCacheParams& params=GLProgramBinaryCacheParams());
+
+  //################################################################################################
+  ~GLProgramBinaryCache();
+
+  //################################################################################################
+  bool isSupported() const;
+
+  //################################################################################################
+  //! The directory the binaries are stored in.
+  const std::string& directory() const;
+
+  //################################################################################################
+  //! Generate a key from the program sources, the shader profile and the driver.
+  std::string makeKey(const std::vector<std::string>& sources) const;
+
+  //################################################################################################
+  //! Load a cached binary into program, returns true if program was linked successfully.
+  bool load(uint32_t program, const std::string& key);
+
+  //################################################################################################
+  //! Call before glLinkProgram so that the driver keeps the binary around for save().
+  void prepareProgram(uint32_t program);
+
+  //################################################################################################
+  //! Store the binary of a successfully linked program.
+  void save(uint32_t program, const std::string& key);
+
+  //################################################################################################
+  //! Delete every cached binary.
+  void clear();
+
+  //################################################################################################
+  GLProgramBinaryCacheStats stats() const;
+};
+
+}
+
+#endif
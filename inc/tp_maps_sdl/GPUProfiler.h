@@ -0,0 +1,116 @@
+#ifndef tp_maps_sdl_GPUProfiler_h
+#define tp_maps_sdl_GPUProfiler_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Rolling GPU timing statistics for a named scope, all times are in milliseconds.
+struct GPUScopeStats
+{
+  std::string name;
+  double lastMS{0.0};
+  double meanMS{0.0};
+  double minMS{0.0};
+  double maxMS{0.0};
+  size_t samples{0};
+};
+
+//##################################################################################################
+//! Measure GPU time spent in named scopes without stalling the pipeline.
+/*!
+Scopes write GPU timestamps into per-frame query pools, the results are read back a few frames later
+once the GPU has finished with them. If a frame is still not available when its pool is needed again
+its results are dropped rather than waiting on the GPU.
+
+\code
+profiler->beginFrame();
+profiler->beginScope("shadows");
+...
+profiler->endScope();
+profiler->endFrame();
+\endcode
+*/
+class GPUProfiler
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  GPUProfiler(size_t framesInFlight=4, size_t maxScopesPerFrame=64, size_t historySize=120);
+
+  //################################################################################################
+  virtual ~GPUProfiler();
+
+  //################################################################################################
+  virtual bool isSupported() const=0;
+
+  //################################################################################################
+  void setEnabled(bool enabled);
+
+  //################################################################################################
+  bool enabled() const;
+
+  //################################################################################################
+  //! Read back completed frames and start recording a new frame.
+  void beginFrame();
+
+  //################################################################################################
+  void endFrame();
+
+  //################################################################################################
+  //! Scopes can be nested, stats are accumulated by name.
+  void beginScope(const std::string& name);
+
+  //################################################################################################
+  void endScope();
+
+  //################################################################################################
+  std::vector<GPUScopeStats> stats() const;
+
+  //################################################################################################
+  void resetStats();
+
+  //################################################################################################
+  //! The number of frames whose results were dropped because the GPU had not finished them in time.
+  size_t droppedFrames() const;
+
+protected:
+  //################################################################################################
+  //! Reset the queries for a frame before it is recorded again.
+  virtual void resetQueries(size_t frame, size_t queryCount)=0;
+
+  //################################################################################################
+  virtual void writeTimestamp(size_t frame, size_t query, bool endOfScope)=0;
+
+  //################################################################################################
+  //! Return false without blocking if the results are not available yet.
+  virtual bool readTimestamps(size_t frame, size_t queryCount, std::vector<uint64_t>& nanoseconds)=0;
+};
+
+//##################################################################################################
+//! RAII helper to time a scope.
+class GPUProfileScope
+{
+  GPUProfiler* m_profiler;
+public:
+  //################################################################################################
+  GPUProfileScope(GPUProfiler* profiler, const std::string& name):
+    m_profiler(profiler)
+  {
+    if(m_profiler)
+      m_profiler->beginScope(name);
+  }
+
+  //################################################################################################
+  ~GPUProfileScope()
+  {
+    if(m_profiler)
+      m_profiler->endScope();
+  }
+};
+
+}
+
+#endif
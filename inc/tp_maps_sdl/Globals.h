@@ -3,6 +3,8 @@
 
 #include "tp_maps/textures/BasicTexture.h" // IWYU pragma: keep
 
+#include <functional>
+
 #if defined(TP_MAPS_SDL_LIBRARY)
 #  define TP_MAPS_SDL_SHARED_EXPORT
 #else
@@ -14,9 +16,62 @@
 //! An implementation of tp_maps running in SDL.
 namespace tp_maps_sdl
 {
+class ColorMapPool;
+
+//##################################################################################################
+//! Options for decoding part of an image or decoding it at a lower resolution.
+/*!
+Rows are cropped and box filtered as they are decoded so the full resolution image is never held in
+memory. For QOI, TGA and PNM this applies to the whole decode, SDL_image formats are decoded into a
+surface first but no full resolution ColorMap is created.
+*/
+struct TextureLoadOptions
+{
+  size_t maxDimension{0}; //!< Downscale so that neither side exceeds this, 0 for no limit.
+  size_t regionX{0};      //!< Source region in pixels from the bottom left.
+  size_t regionY{0};
+  size_t regionWidth{0};  //!< Zero width or height for the whole image.
+  size_t regionHeight{0};
+  ColorMapPool* pool{nullptr}; //!< Optional pool to take the decoded image and tile buffers from.
+};
+
+//##################################################################################################
+//! Called for each tile, tiles are numbered from the bottom left.
+using TileCallback = std::function<void(size_t tileX, size_t tileY, const tp_image_utils::ColorMap& tile)>;
+
+//##################################################################################################
+tp_image_utils::ColorMap loadTextureFromResource(const std::string& path,
+                                                 const TextureLoadOptions& options=TextureLoadOptions());
+
+//##################################################################################################
+//! Decode an image from memory, QOI, TGA and PNM are decoded directly everything else uses SDL_image.
+tp_image_utils::ColorMap loadTextureFromData(const void* data,
+                                             size_t size,
+                                             const std::string& name=std::string(),
+                                             const TextureLoadOptions& options=TextureLoadOptions());
+
+//##################################################################################################
+//! Decode into destination, reusing its buffer if it is already the right size.
+bool loadTextureInto(tp_image_utils::ColorMap& destination,
+                     const void* data,
+                     size_t size,
+                     const std::string& name=std::string(),
+                     const TextureLoadOptions& options=TextureLoadOptions());
+
+//##################################################################################################
+//! Split an image into tiles of at most tileSize, holding only one row of tiles in memory at a time.
+bool loadTilesFromResource(const std::string& path,
+                           size_t tileSize,
+                           const TileCallback& callback,
+                           const TextureLoadOptions& options=TextureLoadOptions());
 
 //##################################################################################################
-tp_image_utils::ColorMap loadTextureFromResource(const std::string& path);
+bool loadTilesFromData(const void* data,
+                       size_t size,
+                       size_t tileSize,
+                       const TileCallback& callback,
+                       const std::string& name=std::string(),
+                       const TextureLoadOptions& options=TextureLoadOptions());
 
 }
 
@@ -0,0 +1,49 @@
+#ifndef tp_maps_sdl_ImageDecoders_h
+#define tp_maps_sdl_ImageDecoders_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+class ImageRowSink;
+
+//##################################################################################################
+//! Formats that can be decoded without going through SDL_image.
+enum class ImageFormat
+{
+  Unknown, //!< Not one of the built in formats, use SDL_image.
+  QOI,     //!< The Quite OK Image format.
+  TGA,     //!< Uncompressed or RLE Truevision TGA, 8 bit grey, 24 or 32 bit color.
+  PNM      //!< Binary PPM (P6) or PGM (P5).
+};
+
+//##################################################################################################
+const char* imageFormatToString(ImageFormat format);
+
+//##################################################################################################
+//! Detect the format from the magic bytes at the start of the data.
+ImageFormat detectImageFormat(const void* data, size_t size);
+
+//##################################################################################################
+//! Decode one of the built in formats, streaming rows to sink.
+/*!
+\return false if the format is not recognized, the data is invalid or the sink aborted.
+*/
+bool decodeImage(const void* data, size_t size, ImageRowSink& sink);
+
+//##################################################################################################
+//! Decode one of the built in formats straight into result in bottom left order.
+bool decodeImage(const void* data, size_t size, tp_image_utils::ColorMap& result);
+
+//##################################################################################################
+bool decodeQOI(const void* data, size_t size, ImageRowSink& sink);
+
+//##################################################################################################
+bool decodeTGA(const void* data, size_t size, ImageRowSink& sink);
+
+//##################################################################################################
+bool decodePNM(const void* data, size_t size, ImageRowSink& sink);
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef tp_maps_sdl_ImageRowSink_h
+#define tp_maps_sdl_ImageRowSink_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+class ColorMapPool;
+
+//##################################################################################################
+//! Receives decoded images a row at a time so that the full image never has to be held in memory.
+/*!
+Row 0 is the bottom row. Decoders deliver rows in order, either bottom up or top down depending on
+the file, but never out of order.
+*/
+class ImageRowSink
+{
+public:
+  //################################################################################################
+  virtual ~ImageRowSink()=default;
+
+  //################################################################################################
+  //! Called once with the size of the image before any rows, return false to abort decoding.
+  virtual bool begin(size_t width, size_t height)=0;
+
+  //################################################################################################
+  //! Return a buffer of width pixels for the decoder to write row y into.
+  virtual TPPixel* row(size_t y)=0;
+
+  //################################################################################################
+  //! Called once row y has been written.
+  virtual void rowDone(size_t y)=0;
+};
+
+//##################################################################################################
+//! Decode straight into a ColorMap.
+/*!
+If result is already the right size its buffer is reused, otherwise it is taken from pool if there
+is one.
+*/
+class ColorMapRowSink : public ImageRowSink
+{
+  tp_image_utils::ColorMap& m_result;
+  ColorMapPool* m_pool;
+public:
+  //################################################################################################
+  ColorMapRowSink(tp_image_utils::ColorMap& result, ColorMapPool* pool=nullptr);
+
+  //################################################################################################
+  bool begin(size_t width, size_t height) override;
+
+  //################################################################################################
+  TPPixel* row(size_t y) override;
+
+  //################################################################################################
+  void rowDone(size_t y) override;
+};
+
+//##################################################################################################
+//! Crop to a region and box filter down to a maximum size while streaming rows to another sink.
+/*!
+Only a single row of accumulators is held, so the memory used depends on the width of the region not
+the height of the image.
+*/
+class RegionScaleRowSink : public ImageRowSink
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! A region with a zero width or height means the whole image, maxDimension 0 means no limit.
+  RegionScaleRowSink(ImageRowSink& next,
+                     size_t regionX,
+                     size_t regionY,
+                     size_t regionWidth,
+                     size_t regionHeight,
+                     size_t maxDimension);
+
+  //################################################################################################
+  ~RegionScaleRowSink() override;
+
+  //################################################################################################
+  bool begin(size_t width, size_t height) override;
+
+  //################################################################################################
+  TPPixel* row(size_t y) override;
+
+  //################################################################################################
+  void rowDone(size_t y) override;
+};
+
+//##################################################################################################
+//! Cut the image into tiles, holding only one row of tiles in memory at a time.
+/*!
+Tiles are numbered from the bottom left, tiles on the right and top edges may be smaller than
+tileSize. The tile passed to the callback is only valid during the callback, if there is a pool it is
+returned to it afterwards.
+*/
+class TileRowSink : public ImageRowSink
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  TileRowSink(size_t tileSize, const TileCallback& callback, ColorMapPool* pool=nullptr);
+
+  //################################################################################################
+  ~TileRowSink() override;
+
+  //################################################################################################
+  bool begin(size_t width, size_t height) override;
+
+  //################################################################################################
+  TPPixel* row(size_t y) override;
+
+  //################################################################################################
+  void rowDone(size_t y) override;
+};
+
+}
+
+#endif
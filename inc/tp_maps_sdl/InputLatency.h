@@ -0,0 +1,83 @@
+#ifndef tp_maps_sdl_InputLatency_h
+#define tp_maps_sdl_InputLatency_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Input to photon latency, all times are in milliseconds.
+struct InputLatencyStats
+{
+  size_t samples{0};
+  double meanMS{0.0};
+  double p50MS{0.0};
+  double p90MS{0.0};
+  double p99MS{0.0};
+  double maxMS{0.0};
+
+  double bucketMS{1.0};        //!< The width of each bucket.
+  std::vector<size_t> buckets; //!< The last bucket also counts everything above the range.
+};
+
+//##################################################################################################
+//! Measure the time from an input event to the present of the first frame painted after it.
+/*!
+Input events are stamped with their SDL timestamp. The frame that starts painting after an event takes
+ownership of it and when that frame has been presented a sample is added for each of its events.
+SDL timestamps have a resolution of 1ms, so the histogram does too by default. Only pass events that
+caused a repaint, otherwise an event that changes nothing is charged the idle time until the next frame.
+
+\code
+if(needsRepaint)
+  tracker.inputEvent(event.common.timestamp);
+...
+tracker.frameStarted();
+q->paintGL();
+SDL_GL_SwapWindow(window);
+tracker.framePresented();
+\endcode
+*/
+class InputLatencyTracker
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  InputLatencyTracker(double bucketMS=1.0, size_t bucketCount=100);
+
+  //################################################################################################
+  ~InputLatencyTracker();
+
+  //################################################################################################
+  void setEnabled(bool enabled);
+
+  //################################################################################################
+  bool enabled() const;
+
+  //################################################################################################
+  //! Print the stats with tpDebug() every intervalMS, 0 to disable.
+  void setLogInterval(double intervalMS);
+
+  //################################################################################################
+  //! Record an input event that has just been handled, timestamp is in SDL_GetTicks() time.
+  void inputEvent(uint32_t timestamp);
+
+  //################################################################################################
+  //! Call before painting, the frame takes ownership of the pending input events.
+  void frameStarted();
+
+  //################################################################################################
+  //! Call once the swap or present for the frame has returned.
+  void framePresented();
+
+  //################################################################################################
+  InputLatencyStats stats() const;
+
+  //################################################################################################
+  void resetStats();
+};
+
+}
+
+#endif
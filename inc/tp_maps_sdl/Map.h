@@ -2,6 +2,9 @@
 #define tp_maps_sdl_Map_h
 
 #include "tp_maps_sdl/Globals.h"
+#include "tp_maps_sdl/DamageRegion.h"
+#include "tp_maps_sdl/MemoryPressure.h"
+#include "tp_maps_sdl/FramebufferConfig.h"
 
 #include "tp_maps/Map.h"
 
@@ -10,6 +13,23 @@
 
 namespace tp_maps_sdl
 {
+class GPUProfiler;
+class GLProgramBinaryCache;
+class InputLatencyTracker;
+class FramePacer;
+class WorkerPool;
+
+//##################################################################################################
+//! Time spent bringing up the window and OpenGL context, all times are in milliseconds.
+struct StartupTimings
+{
+  double sdlInitMS{0.0};
+  double windowMS{0.0};       //!< Includes destroying windows for failed attempts.
+  double contextMS{0.0};
+  double initializeGLMS{0.0};
+  size_t attempts{0};         //!< The number of profiles tried before a context was created.
+  bool cachedProfile{false};  //!< True if the profile remembered from the last launch worked.
+};
 
 //##################################################################################################
 class TP_MAPS_SDL_SHARED_EXPORT Map : public tp_maps::Map
@@ -19,6 +39,10 @@ public:
   //################################################################################################
   Map(bool enableDepthBuffer = true, bool fullScreen = false, const std::string& title=std::string());
 
+  //################################################################################################
+  //! Request a specific default framebuffer, tp_maps depth testing is enabled if depthBits>0.
+  Map(const FramebufferConfig& framebufferConfig, bool fullScreen = false, const std::string& title=std::string());
+
   //################################################################################################
   ~Map() override;
 
@@ -28,6 +52,33 @@ public:
   //################################################################################################
   void processEvents();
 
+  //################################################################################################
+  //! GPU timings for named scopes, paintGL is always recorded as a scope called "paintGL".
+  GPUProfiler* gpuProfiler() const;
+
+  //################################################################################################
+  //! Persistent program binaries for the selected shader profile, null when running on Vulkan.
+  GLProgramBinaryCache* programBinaryCache() const;
+
+  //################################################################################################
+  const StartupTimings& startupTimings() const;
+
+  //################################################################################################
+  //! The framebuffer that was obtained, this may differ from the one requested.
+  const FramebufferConfig& framebufferConfig() const;
+
+  //################################################################################################
+  //! Time from each input event to the swap of the first frame painted after it.
+  InputLatencyTracker* inputLatency() const;
+
+  //################################################################################################
+  //! Paces exec() and animate() to the display refresh rate or a target frame rate.
+  FramePacer* framePacer() const;
+
+  //################################################################################################
+  //! Threads for decoding and I/O, completions are delivered on this thread from processEvents().
+  WorkerPool* workerPool() const;
+
   //################################################################################################
   void makeCurrent() override;
 
@@ -36,6 +87,33 @@ public:
   void update(tp_maps::RenderFromStage renderFromStage=tp_maps::RenderFromStage::Full) override;
 
   //################################################################################################
+  //! Release memory now, returns the number of bytes released.
+  size_t trimMemory(TrimLevel level);
+
+  //################################################################################################
+  //! Add handlers for app caches and set a budget, SDL_APP_LOWMEMORY trims at TrimLevel::Critical.
+  MemoryPressure* memoryPressure() const;
+
+  //################################################################################################
+  //! Report a region that changed, frames with damage only repaint and present the damaged regions.
+  /*!
+  Call this before update() for each region that changed. A frame that is updated with no damage
+  reported repaints everything. Partial frames are only used where EGL reports the back buffer age,
+  they present just the damage and are drawn in full unless the final pass calls scissorToDamage().
+  */
+  void addDamage(const DamageRect& rect);
+
+  //################################################################################################
+  //! Restrict drawing to the damage of a partial frame, does nothing for full frames.
+  /*!
+  Call from paintGL() with the default framebuffer bound, after any passes that render into other
+  framebuffers and before the final pass draws into the window. The scissor is disabled again before
+  the swap, the final pass must not change the scissor state.
+  */
+  void scissorToDamage();
+
+  //################################################################################################
+  //! Queue callback to be called from processEvents(), this is safe to call from any thread.
   void callAsync(const std::function<void()>& callback) override;
 
   //################################################################################################
@@ -0,0 +1,99 @@
+#ifndef tp_maps_sdl_MemoryPressure_h
+#define tp_maps_sdl_MemoryPressure_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+enum class TrimLevel
+{
+  Background, //!< The app has been backgrounded, drop what is cheap to rebuild.
+  Moderate,   //!< Over budget, drop caches and transient buffers.
+  Critical    //!< The OS is about to kill the app, drop everything that can be rebuilt.
+};
+
+//##################################################################################################
+const char* trimLevelToString(TrimLevel level);
+
+//##################################################################################################
+//! Release memory in priority order in response to the OS or a memory budget.
+/*!
+Handlers are called in ascending priority order, put the things that are cheapest to rebuild first.
+Each handler frees what it can for the level and returns the number of bytes it released. The Map
+calls trim() for SDL_APP_LOWMEMORY and SDL_APP_WILLENTERBACKGROUND as soon as processEvents() polls
+them, before the app can be suspended, and checks the budget periodically from processEvents(), so
+handlers are always called on the main thread.
+
+\code
+map->memoryPressure()->addHandler("tile pool", 10, [&](TrimLevel level)
+{
+  return pool.trim((level==TrimLevel::Critical)?0:pool.stats().pooledBytes/2);
+});
+\endcode
+*/
+class MemoryPressure
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! Return the number of bytes released.
+  using Handler = std::function<size_t(TrimLevel level)>;
+
+  //################################################################################################
+  //! Return the current usage in bytes, or 0 if unknown.
+  using UsageFunction = std::function<size_t()>;
+
+  //################################################################################################
+  MemoryPressure();
+
+  //################################################################################################
+  ~MemoryPressure();
+
+  //################################################################################################
+  //! Returns an id that can be passed to removeHandler().
+  size_t addHandler(const std::string& name, int priority, const Handler& handler);
+
+  //################################################################################################
+  void removeHandler(size_t id);
+
+  //################################################################################################
+  //! Call the handlers and return the total number of bytes released.
+  size_t trim(TrimLevel level);
+
+  //################################################################################################
+  //! Trim when resident memory or VRAM goes over budget, 0 for no limit.
+  void setBudget(size_t rssBytes, size_t vramBytes);
+
+  //################################################################################################
+  //! Once over budget, keep trimming until usage is below this fraction of the budget. Default 0.9.
+  void setLowFraction(float lowFraction);
+
+  //################################################################################################
+  //! VRAM is only checked against its budget if this is set.
+  void setVRAMUsageFunction(const UsageFunction& vramUsage);
+
+  //################################################################################################
+  //! Check the budget if intervalMS has passed since the last check, returns the bytes released.
+  /*!
+  The first check over budget trims at TrimLevel::Moderate and later checks that are still over trim at
+  TrimLevel::Critical. The interval doubles, up to 32 times, while usage stays above the low target.
+  Call this from the main thread.
+  */
+  size_t checkBudget(double intervalMS=1000.0);
+
+  //################################################################################################
+  //! Resident set size of the process in bytes, 0 if the platform is not supported.
+  static size_t residentBytes();
+
+  //################################################################################################
+  //! The total released since creation.
+  size_t releasedBytes() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef tp_maps_sdl_TextureAtlas_h
+#define tp_maps_sdl_TextureAtlas_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Where an image was placed in the atlas.
+struct TextureAtlasEntry
+{
+  size_t page{0};
+  size_t x{0};      //!< Bottom left of the image in pixels, not including padding.
+  size_t y{0};
+  size_t width{0};
+  size_t height{0};
+  glm::vec2 uvMin{0.0f, 0.0f};
+  glm::vec2 uvMax{0.0f, 0.0f};
+};
+
+//##################################################################################################
+struct TextureAtlasParams
+{
+  size_t pageWidth{2048};
+  size_t pageHeight{2048};
+  size_t padding{2};      //!< Pixels of extruded border around each image.
+  size_t maxPages{16};
+};
+
+//##################################################################################################
+//! Pack many small images into a few large pages to reduce texture binds and draw calls.
+/*!
+Images are packed using a skyline bottom left packer, each image is surrounded by padding that its
+edge pixels are extruded into so that linear filtering and mipmapping does not bleed neighbouring
+images into each other.
+
+Images can be inserted and removed at any time. Removing an image leaves a hole that the skyline can't
+reuse, call defragment() to repack everything once fragmentation() gets too high. Pages that have
+changed since the last call to takeDirtyPages() need uploading again.
+*/
+class TextureAtlas
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  TextureAtlas(const TextureAtlasParams& params=TextureAtlasParams());
+
+  //################################################################################################
+  ~TextureAtlas();
+
+  //################################################################################################
+  //! Add or replace an image, returns false if it is too big or all the pages are full.
+  bool insert(const std::string& name, const tp_image_utils::ColorMap& image);
+
+  //################################################################################################
+  //! Load an image with loadTextureFromResource() and insert it using the path as its name.
+  bool insertResource(const std::string& path);
+
+  //################################################################################################
+  //! Insert many images at once, packing the largest first gives a tighter fit.
+  /*!
+  \return The names of the images that did not fit.
+  */
+  std::vector<std::string> insert(const std::vector<std::pair<std::string, tp_image_utils::ColorMap>>& images);
+
+  //################################################################################################
+  void remove(const std::string& name);
+
+  //################################################################################################
+  //! Returns nullptr if the image is not in the atlas.
+  const TextureAtlasEntry* entry(const std::string& name) const;
+
+  //################################################################################################
+  size_t pageCount() const;
+
+  //################################################################################################
+  const tp_image_utils::ColorMap& page(size_t index) const;
+
+  //################################################################################################
+  //! Return the pages that have changed since the last call and clear the list.
+  /*!
+  After defragment() the atlas can have fewer pages than before, the pages that were dropped are
+  returned too with indices >= pageCount(). Release those rather than passing them to page().
+  */
+  std::vector<size_t> takeDirtyPages();
+
+  //################################################################################################
+  //! The fraction of the used page area that is lost to removed images.
+  float fragmentation() const;
+
+  //################################################################################################
+  //! Repack all of the images from scratch, this can move every image and change every page.
+  void defragment();
+};
+
+}
+
+#endif
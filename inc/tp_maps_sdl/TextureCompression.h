@@ -0,0 +1,67 @@
+#ifndef tp_maps_sdl_TextureCompression_h
+#define tp_maps_sdl_TextureCompression_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+enum class CompressedTextureFormat
+{
+  None,      //!< The device supports none of the formats below, upload uncompressed.
+  BC1,       //!< 4 bits per pixel RGB, DXT1 / S3TC.
+  BC3,       //!< 8 bits per pixel RGBA, DXT5 / S3TC.
+  ETC2_RGB8, //!< 4 bits per pixel RGB, written as ETC1 blocks which all ETC2 decoders accept.
+  ETC2_RGBA8 //!< 8 bits per pixel RGBA, ETC2 color with EAC alpha.
+};
+
+//##################################################################################################
+const char* compressedTextureFormatToString(CompressedTextureFormat format);
+
+//##################################################################################################
+//! The GL internal format for glCompressedTexImage2D, 0 for None.
+uint32_t glInternalFormat(CompressedTextureFormat format);
+
+//##################################################################################################
+//! Bytes per 4x4 block, 0 for None.
+size_t blockBytes(CompressedTextureFormat format);
+
+//##################################################################################################
+bool hasAlpha(CompressedTextureFormat format);
+
+//##################################################################################################
+struct CompressedImage
+{
+  CompressedTextureFormat format{CompressedTextureFormat::None};
+  size_t width{0};
+  size_t height{0};
+  std::vector<uint8_t> data; //!< Blocks in the same row order as the source ColorMap, bottom first.
+};
+
+//##################################################################################################
+//! Encode an image into 4x4 blocks.
+/*!
+The image is split into bands of block rows that are encoded in parallel, threadCount 0 uses one
+thread per hardware thread. Images that are not a multiple of 4 are padded by repeating their edges.
+This favours speed over quality, it is intended for imagery tiles rather than UI art.
+*/
+CompressedImage compressImage(const tp_image_utils::ColorMap& image,
+                              CompressedTextureFormat format,
+                              size_t threadCount=0);
+
+//##################################################################################################
+//! Pick the best format that the current GL context can sample from, call with the context current.
+CompressedTextureFormat selectGLCompressedTextureFormat(bool needAlpha);
+
+//##################################################################################################
+//! Write a single mip level KTX 1 file.
+bool writeKTX(const std::string& path, const CompressedImage& image);
+
+//##################################################################################################
+//! Read a KTX 1 file written by writeKTX().
+bool readKTX(const void* data, size_t size, CompressedImage& image);
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef tp_maps_sdl_Trace_h
+#define tp_maps_sdl_Trace_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <atomic>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Checked inline by TraceScope so that tracing costs one relaxed load when it is disabled.
+extern std::atomic<bool> traceActive;
+
+//##################################################################################################
+//! Start or stop recording, starting discards anything recorded before.
+/*!
+Each thread records into its own fixed size buffer without locking, once a buffer is full further
+events from that thread are dropped and counted. Buffers are allocated when a thread first records
+while tracing is enabled, and the buffers of exited threads are released once they have been saved.
+
+Setting the TP_MAPS_SDL_TRACE environment variable to a file path enables tracing when a Map is created
+and saves the trace there when it is destroyed.
+*/
+void setTraceEnabled(bool enabled);
+
+//##################################################################################################
+bool traceEnabled();
+
+//##################################################################################################
+//! Name the calling thread in the trace, the name must outlive the trace.
+void setTraceThreadName(const char* name);
+
+//##################################################################################################
+//! Record a complete event, name and category must be string literals or otherwise outlive the trace.
+void traceEvent(const char* name, const char* category, uint64_t startNS, uint64_t endNS);
+
+//##################################################################################################
+//! The clock used for trace events in nanoseconds.
+uint64_t traceNowNS();
+
+//##################################################################################################
+//! Events dropped because a thread's buffer was full.
+size_t traceDroppedEvents();
+
+//##################################################################################################
+//! Chrome trace_event JSON, this can be loaded into Perfetto or chrome://tracing.
+std::string traceToJSON();
+
+//##################################################################################################
+bool saveTrace(const std::string& path);
+
+//##################################################################################################
+//! Time a scope as a complete event.
+class TraceScope
+{
+  const char* m_name;
+  const char* m_category;
+  uint64_t m_startNS{0};
+public:
+  //################################################################################################
+  TraceScope(const char* name, const char* category="tp_maps_sdl"):
+    m_name(name),
+    m_category(category)
+  {
+    if(traceActive.load(std::memory_order_relaxed))
+      m_startNS = traceNowNS();
+  }
+
+  //################################################################################################
+  ~TraceScope()
+  {
+    if(m_startNS)
+      traceEvent(m_name, m_category, m_startNS, traceNowNS());
+  }
+};
+
+}
+
+#endif
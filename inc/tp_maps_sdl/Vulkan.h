@@ -2,11 +2,54 @@
 #define tp_maps_sdl_Vulkan_h
 
 #include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+#include "tp_maps_sdl/DamageRegion.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
 
 struct SDL_Window;
 
 namespace tp_maps_sdl
 {
+class VulkanUploader;
+class VulkanGPUProfiler;
+class VulkanCommandRecorder;
+class VulkanStaticFrameCache;
+class VulkanShaderCache;
+class VulkanPipelineCache;
+enum class CompressedTextureFormat;
+
+//##################################################################################################
+enum class VulkanDepthPreference
+{
+  Precision, //!< Prefer the most precise depth format (D32).
+  Size       //!< Prefer the smallest depth format (D16), saves memory and bandwidth.
+};
+
+//##################################################################################################
+//! Render pass attachments, depth and multisample color are transient and never stored.
+struct VulkanAttachmentConfig
+{
+  uint32_t sampleCount{1}; //!< Clamped to the highest count the device supports.
+  bool depth{true};
+  bool stencil{true};
+  VulkanDepthPreference depthPreference{VulkanDepthPreference::Precision};
+  bool srgb{false};        //!< Use an sRGB color format so writes are encoded from linear.
+  bool alpha{false};       //!< Composite the window using the alpha channel when supported.
+  uint32_t imageCount{0};  //!< Swapchain images, 0 for one more than the surface minimum.
+};
+
+//##################################################################################################
+//! Budget and usage of one memory heap in bytes.
+struct VulkanHeapBudget
+{
+  VkDeviceSize size{0};
+  VkDeviceSize budget{0};   //!< From VK_EXT_memory_budget, otherwise 80% of the heap size.
+  VkDeviceSize usage{0};    //!< From VK_EXT_memory_budget, otherwise 0 as it is unknown.
+  bool deviceLocal{false};
+  bool fromExtension{false};
+};
 
 //##################################################################################################
 class Vulkan
@@ -15,10 +58,126 @@ class Vulkan
 public:
 
   //################################################################################################
-  Vulkan(SDL_Window* window, const std::string& title);
+  Vulkan(SDL_Window* window,
+         const std::string& title,
+         const VulkanAttachmentConfig& attachmentConfig=VulkanAttachmentConfig());
+
+  //################################################################################################
+  //! Headless mode, no window, surface or swapchain.
+  /*!
+  This renders into offscreen color and depth images and reads the results back through host visible
+  buffers. framesInFlight frames can be rendering at once, this works on CPU implementations like
+  lavapipe.
+  */
+  Vulkan(size_t width,
+         size_t height,
+         size_t framesInFlight=3,
+         const std::string& title=std::string(),
+         const VulkanAttachmentConfig& attachmentConfig=VulkanAttachmentConfig());
 
   //################################################################################################
   ~Vulkan();
+
+  //################################################################################################
+  bool isValid() const;
+
+  //################################################################################################
+  bool isHeadless() const;
+
+  //################################################################################################
+  //! The sample count that was actually used.
+  uint32_t sampleCount() const;
+
+  //################################################################################################
+  //! The depth format that was selected, VK_FORMAT_UNDEFINED if there is no depth buffer.
+  VkFormat depthFormat() const;
+
+  //################################################################################################
+  //! The size of the swapchain images or offscreen frames.
+  VkExtent2D extent() const;
+
+  //################################################################################################
+  //! The configuration that was actually obtained, which may differ from the one requested.
+  const VulkanAttachmentConfig& attachmentConfig() const;
+
+  //################################################################################################
+  //! Render a frame in headless mode.
+  /*!
+  draw is called inside the render pass with the command buffer for the frame. completed is called
+  from collectOffscreen() or a later call to renderOffscreen() once the frame has been read back.
+  This only blocks if all of the frames in flight are still rendering.
+  */
+  void renderOffscreen(const std::function<void(VkCommandBuffer)>& draw,
+                       const std::function<void(const tp_image_utils::ColorMap&)>& completed);
+
+  //################################################################################################
+  //! Render a frame in headless mode and read back only the listed regions.
+  /*!
+  Regions are in pixels from the top left of the image, the same as viewports and scissors. Each is
+  handed back as its own ColorMap with the index of the region, so tiles of one large frame are
+  returned without copying the rest of the image. The regions are read back into a buffer the size of
+  one image, so after clipping their total area must not exceed the image, overlapping is allowed up to
+  that limit. If the regions exceed it or the frame can't be rendered, completed is called straight
+  away with an empty ColorMap for every region.
+  */
+  void renderOffscreenRegions(const std::function<void(VkCommandBuffer)>& draw,
+                              const std::vector<VkRect2D>& regions,
+                              const std::function<void(size_t, const tp_image_utils::ColorMap&)>& completed);
+
+  //################################################################################################
+  //! Hand back completed offscreen frames in order, returns the number of frames collected.
+  size_t collectOffscreen(bool wait);
+
+  //################################################################################################
+  //! Asynchronous texture and buffer uploads, this is null if the device failed to initialize.
+  VulkanUploader* uploader() const;
+
+  //################################################################################################
+  //! GPU timestamps on the graphics queue.
+  VulkanGPUProfiler* gpuProfiler() const;
+
+  //################################################################################################
+  //! Parallel recording of secondary command buffers, one set of pools per swapchain image.
+  VulkanCommandRecorder* commandRecorder() const;
+
+  //################################################################################################
+  //! Recorded secondaries per render stage per swapchain image, reused until a stage is invalidated.
+  VulkanStaticFrameCache* staticFrameCache() const;
+
+  //################################################################################################
+  //! SPIR-V for the GLSL_450 variants generated by tp_maps, precompiled or cached on disk.
+  VulkanShaderCache* shaderCache() const;
+
+  //################################################################################################
+  //! Graphics pipelines for the render pass, built on worker threads and cached on disk.
+  VulkanPipelineCache* pipelineCache() const;
+
+  //################################################################################################
+  //! The best block compressed format that the device can sample, None if there isn't one.
+  CompressedTextureFormat compressedTextureFormat(bool needAlpha) const;
+
+  //################################################################################################
+  static VkFormat compressedTextureVkFormat(CompressedTextureFormat format);
+
+  //################################################################################################
+  //! True if VK_EXT_memory_budget was enabled on the device.
+  bool memoryBudgetSupported() const;
+
+  //################################################################################################
+  //! Budget and usage per memory heap, queried each call as they change with other processes.
+  std::vector<VulkanHeapBudget> memoryBudget() const;
+
+  //################################################################################################
+  //! Called with the heap and size when an allocation fails, return true to retry it once.
+  void setOutOfMemoryHandler(const std::function<bool(uint32_t heapIndex, VkDeviceSize bytes)>& outOfMemoryHandler);
+
+  //################################################################################################
+  //! True if VK_KHR_incremental_present was enabled on the device.
+  bool incrementalPresentSupported() const;
+
+  //################################################################################################
+  //! Damage converted for a VkPresentRegionKHR chained to VkPresentInfoKHR through VkPresentRegionsKHR.
+  static std::vector<VkRectLayerKHR> presentRectangles(const std::vector<DamageRect>& rects, VkExtent2D extent);
 };
 
 }
@@ -0,0 +1,84 @@
+#ifndef tp_maps_sdl_VulkanBatchRenderer_h
+#define tp_maps_sdl_VulkanBatchRenderer_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <vulkan/vulkan.h>
+
+#include "glm/glm.hpp"
+
+namespace tp_maps_sdl
+{
+class Vulkan;
+
+//##################################################################################################
+//! One view to render, camera is passed through to the draw function untouched.
+struct BatchRenderJob
+{
+  size_t width{0};
+  size_t height{0};
+  glm::mat4 viewMatrix{1.0f};
+  glm::mat4 projectionMatrix{1.0f};
+  std::function<void(const tp_image_utils::ColorMap&)> completed;
+};
+
+//##################################################################################################
+struct BatchRenderStats
+{
+  size_t jobs{0};         //!< Jobs rendered and handed back.
+  size_t rejected{0};     //!< Jobs larger than the offscreen frame, completed with an empty ColorMap.
+  size_t passes{0};       //!< Frames submitted.
+  double occupancy{0.0};  //!< Fraction of the submitted frame area covered by tiles.
+};
+
+//##################################################################################################
+//! Render many small views of one scene on a single headless Vulkan device.
+/*!
+Queued jobs are packed into rows of tiles across the offscreen frame and each pass renders every tile
+with its own viewport and scissor, so one submission and one readback serve many views. Only the tiles
+are copied back and each is handed to its job as a separate ColorMap once the pass completes. Scene
+resources such as buffers, textures and pipelines belong to the caller and are shared by every job.
+
+Passes are submitted as frames of the headless Vulkan instance so up to framesInFlight passes render
+while earlier ones are read back. Views per second is best with a large offscreen frame, for example
+4096x4096 fits 256 256x256 thumbnails per pass.
+*/
+class VulkanBatchRenderer
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! Record the draw calls for a job, called inside the render pass after viewport and scissor are set.
+  using DrawFunction = std::function<void(VkCommandBuffer commandBuffer, const BatchRenderJob& job, const VkViewport& viewport)>;
+
+  //################################################################################################
+  //! vulkan must be headless and outlive the batch renderer.
+  VulkanBatchRenderer(Vulkan* vulkan, const DrawFunction& draw);
+
+  //################################################################################################
+  //! Flushes and waits for all jobs to be handed back.
+  ~VulkanBatchRenderer();
+
+  //################################################################################################
+  //! Queue a job, it is not rendered until a pass fills up or flush() is called.
+  void add(const BatchRenderJob& job);
+
+  //################################################################################################
+  //! Submit every queued job, returns the number of passes submitted.
+  size_t flush();
+
+  //################################################################################################
+  //! Hand back completed passes, returns the number of passes collected.
+  size_t collect(bool wait);
+
+  //################################################################################################
+  //! Flush and wait for every job to be handed back.
+  void finish();
+
+  //################################################################################################
+  BatchRenderStats stats() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef tp_maps_sdl_VulkanCommandRecorder_h
+#define tp_maps_sdl_VulkanCommandRecorder_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! Record secondary command buffers in parallel across a set of worker threads.
+/*!
+Each worker thread owns a transient command pool per frame in flight, the pools for a frame are
+reset in beginFrame() so the caller must have waited on that frame's fence first. Draw lists are
+split into contiguous ranges, each range is recorded into its own secondary command buffer and the
+secondaries are executed from the primary in the order of the draw list.
+
+\code
+recorder->beginFrame(frame);
+vkCmdBeginRenderPass(primary, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+recorder->executeParallel(primary, inheritance, draws.size(), [&](VkCommandBuffer cb, size_t begin, size_t end)
+{
+  for(size_t i=begin; i<end; i++)
+    draws[i].record(cb);
+});
+vkCmdEndRenderPass(primary);
+\endcode
+*/
+class VulkanCommandRecorder
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  struct Params
+  {
+    VkDevice device{VK_NULL_HANDLE};
+    uint32_t queueFamilyIndex{0};
+    size_t framesInFlight{3};
+    size_t threadCount{0};      //!< 0 to use one per hardware thread less the render thread.
+    size_t minDrawsPerJob{256}; //!< Smaller draw lists are recorded in fewer secondaries.
+  };
+
+  //################################################################################################
+  //! Record draws [begin, end) into the secondary command buffer, this is called from worker threads.
+  using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t begin, size_t end)>;
+
+  //################################################################################################
+  VulkanCommandRecorder(const Params& params);
+
+  //################################################################################################
+  ~VulkanCommandRecorder();
+
+  //################################################################################################
+  size_t threadCount() const;
+
+  //################################################################################################
+  //! Reset the command pools for a frame, the GPU must have finished with that frame.
+  void beginFrame(size_t frame);
+
+  //################################################################################################
+  //! Record the draw list in parallel and execute the resulting secondaries from primary in order.
+  /*!
+  The primary must be inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+  that matches inheritance. This blocks until all of the secondaries have been recorded.
+  */
+  void executeParallel(VkCommandBuffer primary,
+                       const VkCommandBufferInheritanceInfo& inheritance,
+                       size_t drawCount,
+                       const RecordFunction& record);
+};
+
+}
+
+#endif
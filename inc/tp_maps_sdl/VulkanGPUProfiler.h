@@ -0,0 +1,51 @@
+#ifndef tp_maps_sdl_VulkanGPUProfiler_h
+#define tp_maps_sdl_VulkanGPUProfiler_h
+
+#include "tp_maps_sdl/GPUProfiler.h"
+
+#include <vulkan/vulkan.h>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+//! GPU profiling using vkCmdWriteTimestamp into a query pool per frame in flight.
+/*!
+setCommandBuffer() must be called with the command buffer being recorded before beginFrame() and
+before any scopes are written, the command buffer must be submitted to the queue family passed in.
+*/
+class VulkanGPUProfiler : public GPUProfiler
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  VulkanGPUProfiler(VkPhysicalDevice physicalDevice,
+                    VkDevice device,
+                    uint32_t queueFamilyIndex,
+                    size_t framesInFlight=4,
+                    size_t maxScopesPerFrame=64,
+                    size_t historySize=120);
+
+  //################################################################################################
+  ~VulkanGPUProfiler() override;
+
+  //################################################################################################
+  bool isSupported() const override;
+
+  //################################################################################################
+  void setCommandBuffer(VkCommandBuffer commandBuffer);
+
+protected:
+  //################################################################################################
+  void resetQueries(size_t frame, size_t queryCount) override;
+
+  //################################################################################################
+  void writeTimestamp(size_t frame, size_t query, bool endOfScope) override;
+
+  //################################################################################################
+  bool readTimestamps(size_t frame, size_t queryCount, std::vector<uint64_t>& nanoseconds) override;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef tp_maps_sdl_VulkanPipelineCache_h
+#define tp_maps_sdl_VulkanPipelineCache_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+class VulkanShaderCache;
+
+//##################################################################################################
+//! Everything needed to build a graphics pipeline, viewport and scissor are dynamic state.
+struct VulkanPipelineDescription
+{
+  std::string vertexShader;   //!< GLSL_450, looked up through the VulkanShaderCache.
+  std::string fragmentShader; //!< GLSL_450, looked up through the VulkanShaderCache.
+  std::vector<VkVertexInputBindingDescription> bindings;
+  std::vector<VkVertexInputAttributeDescription> attributes;
+  VkPrimitiveTopology topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+  VkCullModeFlags cullMode{VK_CULL_MODE_NONE};
+  bool depthTest{true};
+  bool depthWrite{true};
+  bool blend{false};
+  std::string layout;         //!< The name passed to the layout function.
+};
+
+//##################################################################################################
+struct VulkanPipelineCacheStats
+{
+  size_t requested{0}; //!< Pipelines queued by warmUp() or requested by pipeline().
+  size_t built{0};
+  size_t failed{0};
+  size_t stolen{0};    //!< Queued pipelines that the render thread built itself rather than wait.
+  double buildMS{0.0}; //!< Total time spent in vkCreateGraphicsPipelines across all threads.
+};
+
+//##################################################################################################
+struct VulkanPipelineCacheParams
+{
+  VkPhysicalDevice physicalDevice{VK_NULL_HANDLE};
+  VkDevice device{VK_NULL_HANDLE};
+  VkRenderPass renderPass{VK_NULL_HANDLE};
+  uint32_t subpass{0};
+  VkSampleCountFlagBits sampleCount{VK_SAMPLE_COUNT_1_BIT};
+  VulkanShaderCache* shaderCache{nullptr};
+  size_t threadCount{0};       //!< 0 to use one less than the number of cores.
+  std::string cacheDirectory;  //!< Empty to use a per-user directory from SDL_GetPrefPath.
+};
+
+//##################################################################################################
+//! Build graphics pipelines on worker threads so the render loop can start straight away.
+/*!
+All pipelines are created against one VkPipelineCache that is loaded from and saved to disk. Every
+description passed to pipeline() is recorded and saved, so that the next launch can pass
+previousDescriptions() to warmUp() and have the same pipelines built before they are needed.
+
+pipeline() only blocks on the pipeline that was asked for. If it is still queued it is taken off the
+queue and built on the calling thread, rather than waiting behind everything queued before it.
+
+Pipelines are owned by the cache and destroyed with it. All methods can be called from any thread.
+*/
+class VulkanPipelineCache
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! Resolve VulkanPipelineDescription::layout, called from warmUp() and pipeline() not workers.
+  using LayoutFunction = std::function<VkPipelineLayout(const std::string& name)>;
+
+  //################################################################################################
+  VulkanPipelineCache(const VulkanPipelineCacheParams& params);
+
+  //################################################################################################
+  //! Waits for the workers and saves the pipeline cache and recorded descriptions.
+  ~VulkanPipelineCache();
+
+  //################################################################################################
+  void setLayoutFunction(const LayoutFunction& layoutFunction);
+
+  //################################################################################################
+  //! A stable key for a description, descriptions with the same key share a pipeline.
+  static std::string descriptionKey(const VulkanPipelineDescription& description);
+
+  //################################################################################################
+  //! The descriptions that were requested through pipeline() during the previous run.
+  std::vector<VulkanPipelineDescription> previousDescriptions() const;
+
+  //################################################################################################
+  //! Queue descriptions to be built on the worker threads, returns the number that were queued.
+  size_t warmUp(const std::vector<VulkanPipelineDescription>& descriptions);
+
+  //################################################################################################
+  //! Returns the pipeline, building it or waiting for it if required. VK_NULL_HANDLE on failure.
+  VkPipeline pipeline(const VulkanPipelineDescription& description);
+
+  //################################################################################################
+  //! Returns the pipeline if it has been built, VK_NULL_HANDLE if it is still queued or building.
+  VkPipeline tryPipeline(const VulkanPipelineDescription& description);
+
+  //################################################################################################
+  //! The fraction of queued pipelines that are finished, 1 when nothing is pending.
+  float progress() const;
+
+  //################################################################################################
+  //! The number of pipelines queued or building.
+  size_t pending() const;
+
+  //################################################################################################
+  //! Block until nothing is pending.
+  void waitAll();
+
+  //################################################################################################
+  //! Write the pipeline cache and recorded descriptions to disk, this is also done on destruction.
+  void save();
+
+  //################################################################################################
+  VulkanPipelineCacheStats stats() const;
+};
+
+}
+
+#endif
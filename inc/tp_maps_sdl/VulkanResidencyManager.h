@@ -0,0 +1,111 @@
+#ifndef tp_maps_sdl_VulkanResidencyManager_h
+#define tp_maps_sdl_VulkanResidencyManager_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+#include "tp_maps_sdl/Vulkan.h"
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+//##################################################################################################
+struct VulkanResidencyStats
+{
+  size_t textures{0};          //!< Textures currently tracked.
+  VkDeviceSize residentBytes{0};
+  size_t demotions{0};         //!< Mip levels dropped to stay within budget.
+  size_t evictions{0};         //!< Textures evicted to stay within budget.
+  size_t overBudgetFrames{0};  //!< Frames that ended over budget with nothing left to release.
+};
+
+//##################################################################################################
+//! Keep textures within the memory budget of each heap by dropping mips and evicting old textures.
+/*!
+Each texture is registered with the heap it lives in, its size and two callbacks. demote() is asked to
+drop the most detailed resident mip and returns the new size, evict() releases the texture entirely.
+The owner recreates a texture at full detail when it is next needed and calls resized() or add() again.
+
+enforce() compares the usage of each heap against its budget, as reported by VK_EXT_memory_budget, and
+releases the least recently touched textures first. Textures touched in the last few frames are never
+released, and never within the frames in flight of the Vulkan instance, so call beginFrame() once the
+fence of the new frame has been waited on. That way a texture is only demoted or evicted once no
+submitted command buffer can reference it, and demote() and evict() may destroy images immediately.
+
+Without the extension usage is taken from the bytes tracked here, so allocations made by anything else
+are not accounted for.
+
+Everything should be called from the render thread. releaseFromHeap() can be passed to
+Vulkan::setOutOfMemoryHandler() so that a failed allocation releases textures and is retried.
+*/
+class VulkanResidencyManager
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! Drop the most detailed resident mip, return the bytes now used or 0 if there was nothing to drop.
+  using DemoteFunction = std::function<VkDeviceSize()>;
+
+  //################################################################################################
+  //! Release the texture, it is no longer tracked after this is called.
+  using EvictFunction = std::function<void()>;
+
+  //################################################################################################
+  //! vulkan must outlive the residency manager.
+  VulkanResidencyManager(Vulkan* vulkan);
+
+  //################################################################################################
+  ~VulkanResidencyManager();
+
+  //################################################################################################
+  //! Start tracking a texture and return an id used for the other calls.
+  size_t add(uint32_t heapIndex, VkDeviceSize bytes, const DemoteFunction& demote, const EvictFunction& evict);
+
+  //################################################################################################
+  //! Stop tracking a texture that the owner has destroyed, evict() is not called.
+  void remove(size_t id);
+
+  //################################################################################################
+  //! Mark a texture as used this frame.
+  void touch(size_t id);
+
+  //################################################################################################
+  //! Update the size after the owner has reloaded or changed the resident mips.
+  void resized(size_t id, VkDeviceSize bytes);
+
+  //################################################################################################
+  //! Advance the frame counter used to decide which textures are idle.
+  void beginFrame();
+
+  //################################################################################################
+  //! Release textures from heaps that are over budget, returns the number of bytes released.
+  VkDeviceSize enforce();
+
+  //################################################################################################
+  //! Release at least bytes from a heap ignoring the idle frames but not the frames in flight, returns
+  //! true if anything was released.
+  bool releaseFromHeap(uint32_t heapIndex, VkDeviceSize bytes);
+
+  //################################################################################################
+  //! The fraction of each heap budget to stay below, leaving headroom for transient allocations.
+  void setTargetFraction(float targetFraction);
+
+  //################################################################################################
+  //! Textures touched within this many frames are never demoted or evicted by enforce(), values below
+  //! the number of frames in flight have no effect.
+  void setMinIdleFrames(size_t minIdleFrames);
+
+  //################################################################################################
+  //! The budget per heap, with usage taken from tracked bytes if VK_EXT_memory_budget is missing.
+  std::vector<VulkanHeapBudget> budget() const;
+
+  //################################################################################################
+  //! Bytes used in device local heaps, suitable for MemoryPressure::setVRAMUsageFunction.
+  size_t usedBytes() const;
+
+  //################################################################################################
+  VulkanResidencyStats stats() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef tp_maps_sdl_VulkanShaderCache_h
+#define tp_maps_sdl_VulkanShaderCache_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanShaderCacheStats
+{
+  size_t resourceHits{0}; //!< Modules loaded from SPIR-V embedded as resources.
+  size_t diskHits{0};     //!< Modules loaded from SPIR-V compiled at runtime on a previous launch.
+  size_t compiled{0};     //!< Modules compiled at runtime by the compile function.
+  size_t failed{0};       //!< Variants that could not be found or compiled.
+};
+
+//##################################################################################################
+//! Look up precompiled SPIR-V for the GLSL variants that tp_maps generates.
+/*!
+Each variant is identified by a hash of its stage and GLSL source. SPIR-V is looked up in this order:
+  1. Embedded resources at /tp_maps_sdl/spirv/<hash>.spv, compiled at build time.
+  2. The on disk cache, SPIR-V compiled at runtime on a previous launch.
+  3. The optional compile function, the result is written to the on disk cache.
+
+Compiling at runtime is slow so the intention is that everything is found in the resources. Setting
+an export directory writes the GLSL for every variant that was not embedded, as <hash>.<stage>, so
+that it can be compiled offline with glslangValidator and added to the resources.
+
+Shader modules are owned by the cache and destroyed with it. All methods can be called from any thread.
+*/
+class VulkanShaderCache
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! Compile GLSL to SPIR-V, return an empty vector on failure.
+  using CompileFunction = std::function<std::vector<uint32_t>(VkShaderStageFlagBits stage, const std::string& glsl)>;
+
+  //################################################################################################
+  struct Params
+  {
+    VkDevice device{VK_NULL_HANDLE};
+    std::string cacheDirectory;  //!< Empty to use a per-user directory from SDL_GetPrefPath.
+    std::string exportDirectory; //!< Empty to not export variants that were missing from the resources.
+    CompileFunction compile;     //!< Optional runtime fallback.
+  };
+
+  //################################################################################################
+  VulkanShaderCache(const Params& params);
+
+  //################################################################################################
+  ~VulkanShaderCache();
+
+  //################################################################################################
+  //! The hash that identifies a variant, this is the resource and file name.
+  static std::string variantHash(VkShaderStageFlagBits stage, const std::string& glsl);
+
+  //################################################################################################
+  //! Returns the SPIR-V for a variant or an empty vector if it could not be found or compiled.
+  std::vector<uint32_t> spirv(VkShaderStageFlagBits stage, const std::string& glsl);
+
+  //################################################################################################
+  //! Returns a shader module for the variant, VK_NULL_HANDLE if it could not be found or compiled.
+  VkShaderModule shaderModule(VkShaderStageFlagBits stage, const std::string& glsl);
+
+  //################################################################################################
+  VulkanShaderCacheStats stats() const;
+};
+
+}
+
+#endif
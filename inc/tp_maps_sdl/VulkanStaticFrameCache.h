@@ -0,0 +1,91 @@
+#ifndef tp_maps_sdl_VulkanStaticFrameCache_h
+#define tp_maps_sdl_VulkanStaticFrameCache_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanStaticFrameCacheStats
+{
+  size_t recordedStages{0}; //!< Secondaries that had to be recorded.
+  size_t reusedStages{0};   //!< Secondaries that were resubmitted as-is.
+  size_t reusedFrames{0};   //!< Frames where nothing at all had to be recorded.
+};
+
+//##################################################################################################
+//! Keep a recorded secondary command buffer per render stage per swapchain image.
+/*!
+Stages are numbered in render order by the caller that records them, from 0 to stageCount-1, and
+invalidating a stage invalidates every stage after it. They are not tp_maps::RenderFromStage values,
+Map::update() invalidates every stage as it has no mapping from those to stage indices. On each frame only the invalidated stages are re-recorded
+for that swapchain image, the rest are executed again without being touched. When only an overlay
+changes this reduces the CPU cost of a frame to recording the last stage.
+
+The caller must have waited for the previous submission of a swapchain image before calling
+execute() for it.
+*/
+class VulkanStaticFrameCache
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  struct Params
+  {
+    VkDevice device{VK_NULL_HANDLE};
+    uint32_t queueFamilyIndex{0};
+    size_t imageCount{3};
+    size_t stageCount{8}; //!< The number of stages the record function is called for.
+  };
+
+  //################################################################################################
+  //! Record a single stage into a secondary command buffer.
+  using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t stage)>;
+
+  //################################################################################################
+  VulkanStaticFrameCache(const Params& params);
+
+  //################################################################################################
+  ~VulkanStaticFrameCache();
+
+  //################################################################################################
+  void setEnabled(bool enabled);
+
+  //################################################################################################
+  bool enabled() const;
+
+  //################################################################################################
+  //! Invalidate stage and all of the stages after it for every swapchain image.
+  void invalidateFrom(size_t stage);
+
+  //################################################################################################
+  //! Invalidate everything, call this if the render pass or framebuffers are recreated.
+  void invalidateAll();
+
+  //################################################################################################
+  //! Returns true if every stage for image is still valid, the previous primary can be resubmitted.
+  bool isImageValid(size_t image) const;
+
+  //################################################################################################
+  //! Record the invalid stages for image and execute all of the stages from primary in order.
+  /*!
+  The primary must be inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+  that matches inheritance.
+  */
+  void execute(size_t image,
+               VkCommandBuffer primary,
+               const VkCommandBufferInheritanceInfo& inheritance,
+               const RecordFunction& record);
+
+  //################################################################################################
+  VulkanStaticFrameCacheStats stats() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef tp_maps_sdl_VulkanUploader_h
+#define tp_maps_sdl_VulkanUploader_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <vulkan/vulkan.h>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanUploadStats
+{
+  size_t bytesUploaded{0};   //!< Total bytes copied through the staging ring.
+  size_t uploadCount{0};     //!< Total number of buffer and image uploads.
+  size_t batchCount{0};      //!< Total number of transfer submissions.
+  size_t stallCount{0};      //!< Times the CPU had to wait for the GPU to free ring space.
+  double throughputMBps{0.0};//!< Rolling upload throughput measured from submit to completion.
+  bool dedicatedTransferQueue{false};
+};
+
+//##################################################################################################
+//! Asynchronous uploads through a persistently mapped staging ring buffer.
+/*!
+If the device exposes a transfer only queue family uploads are submitted to that, the ownership of
+the destination resources is released to the graphics queue family and the graphics queue must wait
+on the semaphores returned by takeGraphicsWait(). On devices with a single queue family (lavapipe,
+most mobile GPUs) uploads are submitted to the graphics queue instead.
+*/
+class VulkanUploader
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  struct Params
+  {
+    VkPhysicalDevice physicalDevice{VK_NULL_HANDLE};
+    VkDevice device{VK_NULL_HANDLE};
+
+    uint32_t transferQueueFamilyIndex{0};
+    VkQueue transferQueue{VK_NULL_HANDLE};
+
+    uint32_t graphicsQueueFamilyIndex{0};
+    VkQueue graphicsQueue{VK_NULL_HANDLE};
+
+    VkDeviceSize ringSize{64*1024*1024};
+  };
+
+  //################################################################################################
+  VulkanUploader(const Params& params);
+
+  //################################################################################################
+  ~VulkanUploader();
+
+  //################################################################################################
+  bool isValid() const;
+
+  //################################################################################################
+  //! Copy data into the ring and queue a copy into dst.
+  bool uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+  //################################################################################################
+  //! Copy tightly packed pixels into the ring and queue a copy into mip 0 of dst.
+  /*!
+  dst is transitioned from UNDEFINED and will be in finalLayout once the graphics queue has waited
+  on the semaphores returned by takeGraphicsWait().
+  */
+  bool uploadImage(VkImage dst,
+                   uint32_t width,
+                   uint32_t height,
+                   const void* data,
+                   VkDeviceSize size,
+                   VkImageLayout finalLayout=VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  //################################################################################################
+  //! Submit all queued copies.
+  void flush();
+
+  //################################################################################################
+  //! Record queue family acquire barriers and collect the semaphores the graphics submit must wait on.
+  /*!
+  This should be called once per frame on the command buffer that will be submitted to the graphics
+  queue, after flush(). When there is no dedicated transfer queue this does nothing.
+  */
+  void takeGraphicsWait(VkCommandBuffer graphicsCommandBuffer,
+                        std::vector<VkSemaphore>& waitSemaphores,
+                        std::vector<VkPipelineStageFlags>& waitStages);
+
+  //################################################################################################
+  //! Block until every submitted upload has completed.
+  void waitIdle();
+
+  //################################################################################################
+  //! Wait for pending uploads and free the staging ring, it is created again by the next upload.
+  size_t releaseStagingMemory();
+
+  //################################################################################################
+  VulkanUploadStats stats() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef tp_maps_sdl_WorkerPool_h
+#define tp_maps_sdl_WorkerPool_h
+
+#include "tp_maps_sdl/Globals.h" // IWYU pragma: keep
+
+#include <functional>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+enum class WorkPriority
+{
+  Low,    //!< Prefetching and other speculative work.
+  Normal,
+  High    //!< Work for what is on screen now.
+};
+
+//##################################################################################################
+struct WorkerPoolStats
+{
+  size_t queued{0};    //!< Jobs waiting for a worker.
+  size_t running{0};   //!< Jobs being run by a worker now.
+  size_t completed{0}; //!< Completions waiting for deliverCompleted().
+  size_t stolen{0};    //!< Jobs taken from another worker's queue since creation.
+  size_t cancelled{0}; //!< Jobs dropped by cancel() since creation.
+};
+
+//##################################################################################################
+//! Run work on a pool of threads and hand the results back on the main thread.
+/*!
+Each worker has its own queue per priority, jobs are spread across the queues and idle workers steal
+from the back of other queues. Higher priority jobs are always taken first across all of the queues.
+
+The done callback for each job is queued when the work finishes and called from deliverCompleted()
+on the main thread, Map calls this from processEvents() with a time budget so that a burst of
+completions is spread over several frames.
+
+\code
+auto id = map->workerPool()->run([=]{tile->decode();}, [=]{tile->upload();}, WorkPriority::High);
+...
+// The tile scrolled off screen.
+map->workerPool()->cancel(id);
+\endcode
+*/
+class WorkerPool
+{
+  TP_DQ;
+public:
+  //################################################################################################
+  //! threadCount 0 uses one per hardware thread less the main thread, threads start on first use.
+  WorkerPool(size_t threadCount=0);
+
+  //################################################################################################
+  //! Cancels queued jobs and waits for running jobs to finish, no done callbacks are called.
+  ~WorkerPool();
+
+  //################################################################################################
+  size_t threadCount() const;
+
+  //################################################################################################
+  //! Queue work, done is called on the main thread once work has finished. Returns the job id.
+  /*!
+  This can be called from any thread including from inside work.
+  */
+  uint64_t run(const std::function<void()>& work,
+               const std::function<void()>& done=std::function<void()>(),
+               WorkPriority priority=WorkPriority::Normal);
+
+  //################################################################################################
+  //! Queue a callback to be called on the main thread, this can be called from any thread.
+  void post(const std::function<void()>& callback);
+
+  //################################################################################################
+  //! Cancel a job, returns false if it has already been delivered.
+  /*!
+  If the work has not started it is dropped. If it is running it will finish, but done is not called.
+  Work that runs for a long time can poll isCancelled() to stop early.
+  */
+  bool cancel(uint64_t id);
+
+  //################################################################################################
+  //! True if the job was cancelled, can be called from inside the work.
+  bool isCancelled(uint64_t id) const;
+
+  //################################################################################################
+  //! Cancel everything that has not been delivered yet.
+  void cancelAll();
+
+  //################################################################################################
+  //! The maximum time deliverCompleted() spends calling callbacks, at least one is always called.
+  void setCompletionBudgetMS(double budgetMS);
+
+  //################################################################################################
+  double completionBudgetMS() const;
+
+  //################################################################################################
+  //! Call done callbacks on the main thread, returns the number called.
+  size_t deliverCompleted();
+
+  //################################################################################################
+  WorkerPoolStats stats() const;
+};
+
+}
+
+#endif
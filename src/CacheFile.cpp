@@ -0,0 +1,83 @@
+#include "tp_maps_sdl/CacheFile.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//##################################################################################################
+long processID()
+{
+#ifdef _WIN32
+  return long(_getpid());
+#else
+  return long(getpid());
+#endif
+}
+}
+
+//##################################################################################################
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+  auto bytes = static_cast<const uint8_t*>(data);
+  for(size_t i=0; i<size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+//##################################################################################################
+std::string hashToHex(uint64_t hash)
+{
+  char result[17];
+  snprintf(result, sizeof(result), "%016llx", static_cast<unsigned long long>(hash));
+  return result;
+}
+
+//##################################################################################################
+bool writeFileAtomic(const std::filesystem::path& path, const std::string& data)
+{
+  static std::atomic<uint64_t> counter{0};
+
+  auto tmpPath = path;
+  tmpPath += ".tmp" + std::to_string(processID()) + "_" + std::to_string(counter++);
+
+  std::error_code ec;
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), std::streamsize(data.size()));
+    out.close();
+    if(!out)
+    {
+      tpWarning() << "Failed to write cache file: " << tmpPath.string();
+      std::filesystem::remove(tmpPath, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmpPath, path, ec);
+  if(ec)
+  {
+    tpWarning() << "Failed to rename cache file: " << tmpPath.string() << " Error: " << ec.message();
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,131 @@
+#include "tp_maps_sdl/ColorMapPool.h"
+
+#include <list>
+#include <mutex>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct ColorMapPool::Private
+{
+  size_t maxBytes;
+
+  mutable std::mutex mutex;
+
+  //! Most recently returned at the front.
+  std::list<tp_image_utils::ColorMap> pool;
+
+  ColorMapPoolStats stats;
+
+  //################################################################################################
+  Private(size_t maxBytes_):
+    maxBytes(maxBytes_)
+  {
+
+  }
+
+  //################################################################################################
+  static size_t bytes(const tp_image_utils::ColorMap& colorMap)
+  {
+    return colorMap.width()*colorMap.height()*sizeof(TPPixel);
+  }
+};
+
+//##################################################################################################
+ColorMapPool::ColorMapPool(size_t maxBytes):
+  d(new Private(maxBytes))
+{
+
+}
+
+//##################################################################################################
+ColorMapPool::~ColorMapPool()
+{
+  delete d;
+}
+
+//##################################################################################################
+tp_image_utils::ColorMap ColorMapPool::take(size_t width, size_t height)
+{
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    for(auto i=d->pool.begin(); i!=d->pool.end(); ++i)
+    {
+      if(i->width()==width && i->height()==height)
+      {
+        tp_image_utils::ColorMap result = std::move(*i);
+        d->pool.erase(i);
+        d->stats.hits++;
+        d->stats.pooledBytes -= width*height*sizeof(TPPixel);
+        return result;
+      }
+    }
+
+    d->stats.misses++;
+  }
+
+  return tp_image_utils::ColorMap(width, height);
+}
+
+//##################################################################################################
+void ColorMapPool::give(tp_image_utils::ColorMap&& colorMap)
+{
+  size_t bytes = Private::bytes(colorMap);
+  if(bytes==0 || bytes>d->maxBytes)
+    return;
+
+  // Anything evicted is freed after the lock is released.
+  std::list<tp_image_utils::ColorMap> evicted;
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->pool.push_front(std::move(colorMap));
+    d->stats.pooledBytes += bytes;
+
+    while(d->stats.pooledBytes>d->maxBytes)
+    {
+      d->stats.pooledBytes -= Private::bytes(d->pool.back());
+      d->stats.evictions++;
+      evicted.splice(evicted.end(), d->pool, std::prev(d->pool.end()));
+    }
+  }
+}
+
+//##################################################################################################
+void ColorMapPool::clear()
+{
+  std::list<tp_image_utils::ColorMap> pool;
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    pool.swap(d->pool);
+    d->stats.pooledBytes = 0;
+  }
+}
+
+//##################################################################################################
+size_t ColorMapPool::trim(size_t maxBytes)
+{
+  size_t freed=0;
+  std::list<tp_image_utils::ColorMap> evicted;
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    while(d->stats.pooledBytes>maxBytes)
+    {
+      size_t bytes = Private::bytes(d->pool.back());
+      d->stats.pooledBytes -= bytes;
+      d->stats.evictions++;
+      freed += bytes;
+      evicted.splice(evicted.end(), d->pool, std::prev(d->pool.end()));
+    }
+  }
+  return freed;
+}
+
+//##################################################################################################
+ColorMapPoolStats ColorMapPool::stats() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->stats;
+}
+
+}
@@ -0,0 +1,156 @@
+#include "tp_maps_sdl/DamageRegion.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//##################################################################################################
+bool clip(DamageRect& rect, int width, int height)
+{
+  int x0 = std::max(0, rect.x);
+  int y0 = std::max(0, rect.y);
+  int x1 = std::min(width,  rect.x+rect.width);
+  int y1 = std::min(height, rect.y+rect.height);
+  rect = DamageRect{x0, y0, x1-x0, y1-y0};
+  return rect.width>0 && rect.height>0;
+}
+}
+
+//##################################################################################################
+DamageRect boundingRect(const std::vector<DamageRect>& rects)
+{
+  if(rects.empty())
+    return DamageRect();
+
+  int x0 = rects.front().x;
+  int y0 = rects.front().y;
+  int x1 = x0 + rects.front().width;
+  int y1 = y0 + rects.front().height;
+  for(const auto& r : rects)
+  {
+    x0 = std::min(x0, r.x);
+    y0 = std::min(y0, r.y);
+    x1 = std::max(x1, r.x+r.width);
+    y1 = std::max(y1, r.y+r.height);
+  }
+  return DamageRect{x0, y0, x1-x0, y1-y0};
+}
+
+//##################################################################################################
+struct DamageTracker::Private
+{
+  const size_t maxRects;
+  const size_t maxBufferAge;
+
+  //! Damage for the frame being built.
+  std::vector<DamageRect> current;
+  bool all{false};
+
+  //################################################################################################
+  struct Frame
+  {
+    std::vector<DamageRect> rects;
+    bool all{true};
+  };
+
+  //! Damage from previous frames, the most recent at the front.
+  std::deque<Frame> history;
+
+  //################################################################################################
+  Private(size_t maxRects_, size_t maxBufferAge_):
+    maxRects(std::max(size_t(1), maxRects_)),
+    maxBufferAge(std::max(size_t(1), maxBufferAge_))
+  {
+
+  }
+
+  //################################################################################################
+  void reduce(std::vector<DamageRect>& rects) const
+  {
+    if(rects.size()>maxRects)
+      rects = {boundingRect(rects)};
+  }
+};
+
+//##################################################################################################
+DamageTracker::DamageTracker(size_t maxRects, size_t maxBufferAge):
+  d(new Private(maxRects, maxBufferAge))
+{
+
+}
+
+//##################################################################################################
+DamageTracker::~DamageTracker()
+{
+  delete d;
+}
+
+//##################################################################################################
+void DamageTracker::addDamage(const DamageRect& rect)
+{
+  if(rect.width>0 && rect.height>0)
+    d->current.push_back(rect);
+}
+
+//##################################################################################################
+void DamageTracker::damageAll()
+{
+  d->all = true;
+}
+
+//##################################################################################################
+bool DamageTracker::frameDamage(size_t bufferAge,
+                                int width,
+                                int height,
+                                std::vector<DamageRect>& repaint,
+                                std::vector<DamageRect>& present) const
+{
+  repaint.clear();
+  present.clear();
+
+  // An age of 1 means the back buffer holds the last frame, it is still missing this frame's damage.
+  if(d->all || d->current.empty() || bufferAge<1 || bufferAge>d->maxBufferAge || (bufferAge-1)>d->history.size())
+    return false;
+
+  for(auto rect : d->current)
+    if(clip(rect, width, height))
+      present.push_back(rect);
+  d->reduce(present);
+
+  repaint = present;
+  for(size_t i=0; i+1<bufferAge; i++)
+  {
+    const auto& frame = d->history.at(i);
+    if(frame.all)
+      return false;
+
+    for(auto rect : frame.rects)
+      if(clip(rect, width, height))
+        repaint.push_back(rect);
+  }
+  d->reduce(repaint);
+
+  return !present.empty();
+}
+
+//##################################################################################################
+void DamageTracker::endFrame()
+{
+  Private::Frame frame;
+  frame.all = d->all || d->current.empty();
+  frame.rects.swap(d->current);
+  d->reduce(frame.rects);
+
+  d->history.push_front(std::move(frame));
+  while(d->history.size()>d->maxBufferAge)
+    d->history.pop_back();
+
+  d->current.clear();
+  d->all = false;
+}
+
+}
@@ -0,0 +1,167 @@
+#include "tp_maps_sdl/FramePacer.h"
+
+#include "tp_utils/TimeUtils.h"
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+constexpr uint64_t minSpinNS =   200'000;
+constexpr uint64_t maxSpinNS = 4'000'000;
+}
+
+//##################################################################################################
+struct FramePacer::Private
+{
+  SDL_Window* window{nullptr};
+  double refreshRate{60.0};
+  double targetFPS{0.0};
+  uint64_t periodNS{0};
+
+  //! Deadline for the next frame.
+  uint64_t nextFrameNS{0};
+
+  //! Scheduled time of the current frame.
+  uint64_t frameNS{0};
+
+  //! Converts nowNS() into the time base of tp_utils::currentTimeMS().
+  double epochOffsetMS{0.0};
+
+  //! Wake up this long before a deadline and spin for the rest, grows if the OS oversleeps.
+  uint64_t spinNS{1'000'000};
+
+  //################################################################################################
+  void updatePeriod()
+  {
+    double fps = (targetFPS>0.0)?targetFPS:refreshRate;
+    periodNS = uint64_t(1'000'000'000.0 / std::max(1.0, fps));
+  }
+};
+
+//##################################################################################################
+FramePacer::FramePacer():
+  d(new Private())
+{
+  d->epochOffsetMS = double(tp_utils::currentTimeMS()) - double(nowNS())/1'000'000.0;
+  d->updatePeriod();
+  d->nextFrameNS = nowNS();
+  d->frameNS = d->nextFrameNS;
+}
+
+//##################################################################################################
+FramePacer::~FramePacer()
+{
+  delete d;
+}
+
+//##################################################################################################
+void FramePacer::setWindow(SDL_Window* window)
+{
+  d->window = window;
+  displayChanged();
+}
+
+//##################################################################################################
+void FramePacer::displayChanged()
+{
+  double refreshRate = 60.0;
+
+  SDL_DisplayMode mode;
+  if(d->window && SDL_GetWindowDisplayMode(d->window, &mode) == 0 && mode.refresh_rate>0)
+    refreshRate = double(mode.refresh_rate);
+
+  if(refreshRate != d->refreshRate)
+  {
+    tpDebug() << "FramePacer: Display refresh rate " << refreshRate << "Hz";
+    d->refreshRate = refreshRate;
+    d->updatePeriod();
+  }
+}
+
+//##################################################################################################
+double FramePacer::refreshRate() const
+{
+  return d->refreshRate;
+}
+
+//##################################################################################################
+void FramePacer::setTargetFPS(double targetFPS)
+{
+  d->targetFPS = std::max(0.0, targetFPS);
+  d->updatePeriod();
+}
+
+//##################################################################################################
+double FramePacer::targetFPS() const
+{
+  return d->targetFPS;
+}
+
+//##################################################################################################
+uint64_t FramePacer::framePeriodNS() const
+{
+  return d->periodNS;
+}
+
+//##################################################################################################
+bool FramePacer::beginFrame()
+{
+  uint64_t now = nowNS();
+  if(now<d->nextFrameNS)
+    return false;
+
+  d->frameNS = d->nextFrameNS;
+  d->nextFrameNS += d->periodNS;
+
+  // Missed a whole frame, start a new schedule rather than trying to catch up.
+  if(d->nextFrameNS<=now)
+  {
+    d->frameNS = now;
+    d->nextFrameNS = now + d->periodNS;
+  }
+
+  return true;
+}
+
+//##################################################################################################
+double FramePacer::frameTimeMS() const
+{
+  return d->epochOffsetMS + double(d->frameNS)/1'000'000.0;
+}
+
+//##################################################################################################
+void FramePacer::waitForNextFrame()
+{
+  uint64_t deadline = d->nextFrameNS;
+  uint64_t now = nowNS();
+
+  if(now+d->spinNS < deadline)
+  {
+    uint64_t wake = deadline - d->spinNS;
+    std::this_thread::sleep_for(std::chrono::nanoseconds(wake-now));
+
+    // Widen the margin quickly when the OS oversleeps and narrow it slowly when it doesn't.
+    now = nowNS();
+    uint64_t overshoot = (now>wake)?now-wake:0;
+    d->spinNS = std::clamp(std::max(d->spinNS - d->spinNS/16, overshoot + overshoot/4), minSpinNS, maxSpinNS);
+  }
+
+  while(nowNS()<deadline)
+    std::this_thread::yield();
+}
+
+//##################################################################################################
+uint64_t FramePacer::nowNS()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}
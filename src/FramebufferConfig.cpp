@@ -0,0 +1,116 @@
+#include "tp_maps_sdl/FramebufferConfig.h"
+#include "tp_maps_sdl/Vulkan.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+std::string framebufferConfigToString(const FramebufferConfig& config)
+{
+  const char* buffering = "double";
+  switch(config.buffering)
+  {
+    case SwapBuffering::Single: buffering = "single"; break;
+    case SwapBuffering::Double: buffering = "double"; break;
+    case SwapBuffering::Triple: buffering = "triple"; break;
+  }
+
+  return "depth:" + std::to_string(config.depthBits) +
+      " stencil:" + std::to_string(config.stencilBits) +
+      " samples:" + std::to_string(config.samples) +
+      " srgb:" + std::to_string(int(config.srgb)) +
+      " alpha:" + std::to_string(int(config.alpha)) +
+      " buffering:" + buffering;
+}
+
+//##################################################################################################
+void setGLFramebufferAttributes(const FramebufferConfig& config, bool allowMultisample)
+{
+  const int samples = (allowMultisample && config.samples>1)?config.samples:0;
+
+  SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, std::max(0, config.depthBits));
+  SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, std::max(0, config.stencilBits));
+  SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, samples?1:0);
+  SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, samples);
+  SDL_GL_SetAttribute(SDL_GL_FRAMEBUFFER_SRGB_CAPABLE, config.srgb?1:0);
+  SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, config.alpha?8:0);
+  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, config.buffering==SwapBuffering::Single?0:1);
+}
+
+//##################################################################################################
+FramebufferConfig currentGLFramebufferConfig()
+{
+  auto get = [](SDL_GLattr attribute)
+  {
+    int value=0;
+    SDL_GL_GetAttribute(attribute, &value);
+    return value;
+  };
+
+  FramebufferConfig config;
+  config.depthBits = get(SDL_GL_DEPTH_SIZE);
+  config.stencilBits = get(SDL_GL_STENCIL_SIZE);
+  config.samples = get(SDL_GL_MULTISAMPLEBUFFERS)?get(SDL_GL_MULTISAMPLESAMPLES):0;
+  config.srgb = get(SDL_GL_FRAMEBUFFER_SRGB_CAPABLE);
+  config.alpha = get(SDL_GL_ALPHA_SIZE)>0;
+  config.buffering = get(SDL_GL_DOUBLEBUFFER)?SwapBuffering::Double:SwapBuffering::Single;
+  return config;
+}
+
+//##################################################################################################
+VulkanAttachmentConfig vulkanAttachmentConfig(const FramebufferConfig& config)
+{
+  VulkanAttachmentConfig attachmentConfig;
+  attachmentConfig.sampleCount = uint32_t(std::max(1, config.samples));
+  attachmentConfig.depth = config.depthBits>0;
+  attachmentConfig.stencil = config.stencilBits>0;
+  attachmentConfig.depthPreference = (config.depthBits>16)?VulkanDepthPreference::Precision:VulkanDepthPreference::Size;
+  attachmentConfig.srgb = config.srgb;
+  attachmentConfig.alpha = config.alpha;
+
+  switch(config.buffering)
+  {
+    case SwapBuffering::Single: attachmentConfig.imageCount = 1; break;
+    case SwapBuffering::Double: attachmentConfig.imageCount = 2; break;
+    case SwapBuffering::Triple: attachmentConfig.imageCount = 3; break;
+  }
+
+  return attachmentConfig;
+}
+
+//##################################################################################################
+FramebufferConfig vulkanFramebufferConfig(const Vulkan& vulkan)
+{
+  const auto& attachmentConfig = vulkan.attachmentConfig();
+
+  FramebufferConfig config;
+  config.samples = int(attachmentConfig.sampleCount>1?attachmentConfig.sampleCount:0);
+  config.srgb = attachmentConfig.srgb;
+  config.alpha = attachmentConfig.alpha;
+
+  switch(vulkan.depthFormat())
+  {
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:   config.depthBits = 32; config.stencilBits = 8; break;
+    case VK_FORMAT_D32_SFLOAT:           config.depthBits = 32; config.stencilBits = 0; break;
+    case VK_FORMAT_D24_UNORM_S8_UINT:    config.depthBits = 24; config.stencilBits = 8; break;
+    case VK_FORMAT_X8_D24_UNORM_PACK32:  config.depthBits = 24; config.stencilBits = 0; break;
+    case VK_FORMAT_D16_UNORM_S8_UINT:    config.depthBits = 16; config.stencilBits = 8; break;
+    case VK_FORMAT_D16_UNORM:            config.depthBits = 16; config.stencilBits = 0; break;
+    default:                             config.depthBits = 0;  config.stencilBits = 0; break;
+  }
+
+  if(attachmentConfig.imageCount>=3)
+    config.buffering = SwapBuffering::Triple;
+  else if(attachmentConfig.imageCount==2)
+    config.buffering = SwapBuffering::Double;
+  else
+    config.buffering = SwapBuffering::Single;
+
+  return config;
+}
+
+}
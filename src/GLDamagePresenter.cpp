@@ -0,0 +1,261 @@
+#include "tp_maps_sdl/GLDamagePresenter.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#if defined(TP_GLES2) || defined(TP_ANDROID) || defined(TP_IOS)
+#  include <SDL2/SDL_opengles2.h>
+#else
+#  include <SDL2/SDL_opengl.h>
+#endif
+
+#include <cstring>
+#include <type_traits>
+
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+// EGL types and enums, declared here so that EGL headers are not needed to build.
+using EGLDisplay = void*;
+using EGLSurface = void*;
+using EGLint     = int32_t;
+using EGLBoolean = uint32_t;
+
+constexpr EGLint EGL_EXTENSIONS_    = 0x3055;
+constexpr EGLint EGL_DRAW_          = 0x3059;
+constexpr EGLint EGL_BUFFER_AGE_EXT = 0x313D;
+
+using GetCurrentDisplay      = EGLDisplay  (APIENTRY*)();
+using GetCurrentSurface      = EGLSurface  (APIENTRY*)(EGLint readdraw);
+using QueryString            = const char* (APIENTRY*)(EGLDisplay dpy, EGLint name);
+using QuerySurface           = EGLBoolean  (APIENTRY*)(EGLDisplay dpy, EGLSurface surface, EGLint attribute, EGLint* value);
+using SetDamageRegion        = EGLBoolean  (APIENTRY*)(EGLDisplay dpy, EGLSurface surface, EGLint* rects, EGLint nRects);
+using SwapBuffersWithDamage  = EGLBoolean  (APIENTRY*)(EGLDisplay dpy, EGLSurface surface, const EGLint* rects, EGLint nRects);
+using Enable                 = void (APIENTRY*)(GLenum cap);
+using Disable                = void (APIENTRY*)(GLenum cap);
+using Scissor                = void (APIENTRY*)(GLint x, GLint y, GLsizei width, GLsizei height);
+
+//##################################################################################################
+bool hasExtension(const char* extensions, const char* name)
+{
+  if(!extensions)
+    return false;
+
+  size_t len = std::strlen(name);
+  for(const char* p=std::strstr(extensions, name); p; p=std::strstr(p+len, name))
+    if((p==extensions || p[-1]==' ') && (p[len]==' ' || p[len]=='\0'))
+      return true;
+  return false;
+}
+
+//##################################################################################################
+//! SDL_GL_GetProcAddress() goes through glXGetProcAddress on GLX which returns junk for EGL names.
+bool sdlUsesEGL()
+{
+  const char* driver = SDL_GetCurrentVideoDriver();
+  if(!driver)
+    return false;
+
+  for(const char* name : {"android", "wayland", "kmsdrm", "RPI", "vivante"})
+    if(std::strcmp(driver, name)==0)
+      return true;
+
+  return std::strcmp(driver, "x11")==0 && SDL_GetHintBoolean("SDL_VIDEO_X11_FORCE_EGL", SDL_FALSE);
+}
+
+//##################################################################################################
+//! True where SDL_GL_SwapWindow() is only eglSwapBuffers() so calling EGL directly skips nothing.
+/*!
+On Wayland SDL waits for frame callbacks and handles resizes in the swap, on KMSDRM it flips the GBM
+front buffer to the CRTC. Swapping behind SDL's back on those would break pacing or never display.
+*/
+bool sdlSwapIsPlainEGL()
+{
+  const char* driver = SDL_GetCurrentVideoDriver();
+  if(!driver)
+    return false;
+
+  for(const char* name : {"android", "x11", "RPI", "vivante"})
+    if(std::strcmp(driver, name)==0)
+      return true;
+
+  return false;
+}
+
+//##################################################################################################
+std::vector<EGLint> toEGLRects(const std::vector<DamageRect>& rects)
+{
+  std::vector<EGLint> result;
+  result.reserve(rects.size()*4);
+  for(const auto& r : rects)
+  {
+    result.push_back(r.x);
+    result.push_back(r.y);
+    result.push_back(r.width);
+    result.push_back(r.height);
+  }
+  return result;
+}
+}
+
+//##################################################################################################
+struct GLDamagePresenter::Private
+{
+  SDL_Window* window;
+
+  EGLDisplay display{nullptr};
+  EGLSurface surface{nullptr};
+  bool bufferAge{false};
+  bool scissor{false};
+
+  //! The repaint region of the current frame, only applied when the default framebuffer is bound.
+  std::vector<DamageRect> repaint;
+
+  GetCurrentDisplay     getCurrentDisplay{nullptr};
+  GetCurrentSurface     getCurrentSurface{nullptr};
+  QueryString           queryString{nullptr};
+  QuerySurface          querySurface{nullptr};
+  SetDamageRegion       setDamageRegion{nullptr};
+  SwapBuffersWithDamage swapBuffersWithDamage{nullptr};
+  Enable                enable{nullptr};
+  Disable               disable{nullptr};
+  Scissor               glScissor{nullptr};
+
+  //################################################################################################
+  Private(SDL_Window* window_):
+    window(window_)
+  {
+    auto load = [](auto& fn, const char* name)
+    {
+      fn = reinterpret_cast<std::remove_reference_t<decltype(fn)>>(SDL_GL_GetProcAddress(name));
+      return fn != nullptr;
+    };
+
+    if(!load(enable, "glEnable") || !load(disable, "glDisable") || !load(glScissor, "glScissor"))
+      return;
+
+    if(!sdlUsesEGL())
+      return;
+
+    if(!load(getCurrentDisplay, "eglGetCurrentDisplay") ||
+       !load(getCurrentSurface, "eglGetCurrentSurface") ||
+       !load(queryString,       "eglQueryString")       ||
+       !load(querySurface,      "eglQuerySurface"))
+      return;
+
+    display = getCurrentDisplay();
+    surface = getCurrentSurface(EGL_DRAW_);
+    if(!display || !surface)
+      return;
+
+    const char* extensions = queryString(display, EGL_EXTENSIONS_);
+
+    bool partialUpdate = hasExtension(extensions, "EGL_KHR_partial_update");
+    bufferAge = partialUpdate || hasExtension(extensions, "EGL_EXT_buffer_age");
+
+    if(partialUpdate)
+      load(setDamageRegion, "eglSetDamageRegionKHR");
+
+    if(!sdlSwapIsPlainEGL())
+      tpDebug() << "GLDamagePresenter: Presenting through SDL_GL_SwapWindow() on " << SDL_GetCurrentVideoDriver();
+    else if(hasExtension(extensions, "EGL_KHR_swap_buffers_with_damage"))
+      load(swapBuffersWithDamage, "eglSwapBuffersWithDamageKHR");
+    else if(hasExtension(extensions, "EGL_EXT_swap_buffers_with_damage"))
+      load(swapBuffersWithDamage, "eglSwapBuffersWithDamageEXT");
+
+    tpDebug() << "GLDamagePresenter: buffer age: " << bufferAge
+              << " partial update: " << (setDamageRegion!=nullptr)
+              << " swap with damage: " << (swapBuffersWithDamage!=nullptr);
+  }
+};
+
+//##################################################################################################
+GLDamagePresenter::GLDamagePresenter(SDL_Window* window):
+  d(new Private(window))
+{
+
+}
+
+//##################################################################################################
+GLDamagePresenter::~GLDamagePresenter()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool GLDamagePresenter::isSupported() const
+{
+  return d->bufferAge;
+}
+
+//##################################################################################################
+size_t GLDamagePresenter::bufferAge() const
+{
+  if(!d->bufferAge)
+    return 0;
+
+  EGLint age=0;
+  if(!d->querySurface(d->display, d->surface, EGL_BUFFER_AGE_EXT, &age) || age<0)
+    return 0;
+
+  return size_t(age);
+}
+
+//##################################################################################################
+void GLDamagePresenter::beginFrame(const std::vector<DamageRect>& repaint)
+{
+  d->repaint = repaint;
+}
+
+//##################################################################################################
+void GLDamagePresenter::scissorDefaultFramebuffer()
+{
+  if(d->repaint.empty() || !d->enable || d->scissor)
+    return;
+
+  // The damage region promises that nothing outside it is drawn, so it is only set with the scissor.
+  if(d->setDamageRegion)
+  {
+    auto rects = toEGLRects(d->repaint);
+    d->setDamageRegion(d->display, d->surface, rects.data(), EGLint(d->repaint.size()));
+  }
+
+  // GL only has one scissor rect so the union of the damage is drawn.
+  DamageRect bounds = boundingRect(d->repaint);
+  d->enable(GL_SCISSOR_TEST);
+  d->glScissor(bounds.x, bounds.y, bounds.width, bounds.height);
+  d->scissor = true;
+}
+
+//##################################################################################################
+void GLDamagePresenter::endFrame()
+{
+  if(d->scissor)
+  {
+    d->disable(GL_SCISSOR_TEST);
+    d->scissor = false;
+  }
+  d->repaint.clear();
+}
+
+//##################################################################################################
+void GLDamagePresenter::swap(const std::vector<DamageRect>& present)
+{
+  if(!present.empty() && d->swapBuffersWithDamage)
+  {
+    auto rects = toEGLRects(present);
+    if(d->swapBuffersWithDamage(d->display, d->surface, rects.data(), EGLint(present.size())))
+      return;
+  }
+
+  SDL_GL_SwapWindow(d->window);
+}
+
+}
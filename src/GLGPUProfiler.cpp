@@ -0,0 +1,191 @@
+#include "tp_maps_sdl/GLGPUProfiler.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#if defined(TP_GLES2) || defined(TP_ANDROID) || defined(TP_IOS)
+#  include <SDL2/SDL_opengles2.h>
+#else
+#  include <SDL2/SDL_opengl.h>
+#endif
+
+#include <algorithm>
+#include <type_traits>
+
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+#ifndef GL_TIMESTAMP
+#  define GL_TIMESTAMP 0x8E28
+#endif
+
+#ifndef GL_QUERY_RESULT
+#  define GL_QUERY_RESULT 0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#  define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+#ifndef GL_GPU_DISJOINT_EXT
+#  define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+using GenQueries           = void (APIENTRY*)(GLsizei n, GLuint* ids);
+using DeleteQueries        = void (APIENTRY*)(GLsizei n, const GLuint* ids);
+using QueryCounter         = void (APIENTRY*)(GLuint id, GLenum target);
+using GetQueryObjectiv     = void (APIENTRY*)(GLuint id, GLenum pname, GLint* params);
+using GetQueryObjectui64v  = void (APIENTRY*)(GLuint id, GLenum pname, uint64_t* params);
+using GetIntegerv          = void (APIENTRY*)(GLenum pname, GLint* data);
+}
+
+//##################################################################################################
+struct GLGPUProfiler::Private
+{
+  bool supported{false};
+  bool disjointExt{false};
+
+  GenQueries          genQueries{nullptr};
+  DeleteQueries       deleteQueries{nullptr};
+  QueryCounter        queryCounter{nullptr};
+  GetQueryObjectiv    getQueryObjectiv{nullptr};
+  GetQueryObjectui64v getQueryObjectui64v{nullptr};
+  GetIntegerv         getIntegerv{nullptr};
+
+  std::vector<std::vector<GLuint>> queries;
+
+  //################################################################################################
+  Private(size_t framesInFlight):
+    queries(std::max(size_t(2), framesInFlight))
+  {
+    auto load = [](auto& fn, const char* name)
+    {
+      fn = reinterpret_cast<std::remove_reference_t<decltype(fn)>>(SDL_GL_GetProcAddress(name));
+      return fn != nullptr;
+    };
+
+    int major=0;
+    int minor=0;
+    int profile=0;
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, &major);
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, &minor);
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, &profile);
+
+    if(profile == SDL_GL_CONTEXT_PROFILE_ES)
+    {
+      if(SDL_GL_ExtensionSupported("GL_EXT_disjoint_timer_query"))
+      {
+        disjointExt = true;
+        supported =
+            load(genQueries,          "glGenQueriesEXT") &&
+            load(deleteQueries,       "glDeleteQueriesEXT") &&
+            load(queryCounter,        "glQueryCounterEXT") &&
+            load(getQueryObjectiv,    "glGetQueryObjectivEXT") &&
+            load(getQueryObjectui64v, "glGetQueryObjectui64vEXT") &&
+            load(getIntegerv,         "glGetIntegerv");
+      }
+    }
+    else if(major>3 || (major==3 && minor>=3) || SDL_GL_ExtensionSupported("GL_ARB_timer_query"))
+    {
+      supported =
+          load(genQueries,          "glGenQueries") &&
+          load(deleteQueries,       "glDeleteQueries") &&
+          load(queryCounter,        "glQueryCounter") &&
+          load(getQueryObjectiv,    "glGetQueryObjectiv") &&
+          load(getQueryObjectui64v, "glGetQueryObjectui64v");
+    }
+
+    if(!supported)
+      tpWarning() << "GLGPUProfiler: Timer queries are not supported, GPU profiling disabled.";
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    if(!supported)
+      return;
+
+    for(const auto& frame : queries)
+      if(!frame.empty())
+        deleteQueries(GLsizei(frame.size()), frame.data());
+  }
+};
+
+//##################################################################################################
+GLGPUProfiler::GLGPUProfiler(size_t framesInFlight, size_t maxScopesPerFrame, size_t historySize):
+  GPUProfiler(framesInFlight, maxScopesPerFrame, historySize),
+  d(new Private(framesInFlight))
+{
+
+}
+
+//##################################################################################################
+GLGPUProfiler::~GLGPUProfiler()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool GLGPUProfiler::isSupported() const
+{
+  return d->supported;
+}
+
+//##################################################################################################
+void GLGPUProfiler::resetQueries(size_t frame, size_t queryCount)
+{
+  // GL queries don't need resetting, just make sure there are enough of them.
+  auto& queries = d->queries.at(frame);
+  if(queries.size()<queryCount)
+  {
+    auto first = queries.size();
+    queries.resize(queryCount);
+    d->genQueries(GLsizei(queryCount-first), queries.data()+first);
+  }
+}
+
+//##################################################################################################
+void GLGPUProfiler::writeTimestamp(size_t frame, size_t query, bool)
+{
+  d->queryCounter(d->queries.at(frame).at(query), GL_TIMESTAMP);
+}
+
+//##################################################################################################
+bool GLGPUProfiler::readTimestamps(size_t frame, size_t queryCount, std::vector<uint64_t>& nanoseconds)
+{
+  nanoseconds.clear();
+  if(queryCount==0)
+    return true;
+
+  const auto& queries = d->queries.at(frame);
+
+  // Queries complete in order so if the last one is available they all are.
+  GLint available=0;
+  d->getQueryObjectiv(queries.at(queryCount-1), GL_QUERY_RESULT_AVAILABLE, &available);
+  if(!available)
+    return false;
+
+  // A disjoint operation (power state change, context switch) invalidates the frame.
+  if(d->disjointExt)
+  {
+    GLint disjoint=0;
+    d->getIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if(disjoint)
+      return true;
+  }
+
+  nanoseconds.resize(queryCount);
+  for(size_t i=0; i<queryCount; i++)
+    d->getQueryObjectui64v(queries.at(i), GL_QUERY_RESULT, &nanoseconds[i]);
+
+  return true;
+}
+
+}
@@ -0,0 +1,158 @@
+#include "tp_maps_sdl/GLProfileCache.h"
+#include "tp_maps_sdl/CacheFile.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#if defined(TP_GLES2) || defined(TP_ANDROID) || defined(TP_IOS)
+#  include <SDL2/SDL_opengles2.h>
+#else
+#  include <SDL2/SDL_opengl.h>
+#endif
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+using GetString = const GLubyte* (APIENTRY*)(GLenum name);
+
+//##################################################################################################
+//! The attributes that are stored, apart from the profile these are passed back to SDL.
+const std::vector<std::pair<const char*, SDL_GLattr>>& storedAttributes()
+{
+  static const std::vector<std::pair<const char*, SDL_GLattr>> attributes =
+  {
+    {"multisampleBuffers", SDL_GL_MULTISAMPLEBUFFERS},
+    {"multisampleSamples", SDL_GL_MULTISAMPLESAMPLES},
+    {"depthSize",          SDL_GL_DEPTH_SIZE},
+    {"stencilSize",        SDL_GL_STENCIL_SIZE}
+  };
+  return attributes;
+}
+
+//##################################################################################################
+std::string currentVideoDriver()
+{
+  auto driver = SDL_GetCurrentVideoDriver();
+  return driver?driver:"";
+}
+}
+
+//##################################################################################################
+struct GLProfileCache::Private
+{
+  std::string path;
+  std::string profile;
+  std::map<std::string, std::string> values;
+
+  //################################################################################################
+  Private(const std::string& path_):
+    path(path_)
+  {
+    if(path.empty())
+    {
+      if(char* prefPath = SDL_GetPrefPath("tp_maps_sdl", ""); prefPath)
+      {
+        path = std::string(prefPath) + "gl_profile.txt";
+        SDL_free(prefPath);
+      }
+    }
+
+    if(path.empty())
+      return;
+
+    std::ifstream in(path);
+    for(std::string line; std::getline(in, line);)
+    {
+      auto i = line.find('=');
+      if(i != std::string::npos)
+        values[line.substr(0, i)] = line.substr(i+1);
+    }
+
+    if(values["videoDriver"] == currentVideoDriver())
+      profile = values["profile"];
+  }
+};
+
+//##################################################################################################
+GLProfileCache::GLProfileCache(const std::string& path):
+  d(new Private(path))
+{
+
+}
+
+//##################################################################################################
+GLProfileCache::~GLProfileCache()
+{
+  delete d;
+}
+
+//##################################################################################################
+const std::string& GLProfileCache::profile() const
+{
+  return d->profile;
+}
+
+//##################################################################################################
+void GLProfileCache::applyAttributes(const std::string& framebufferConfig) const
+{
+  if(d->profile.empty())
+    return;
+
+  if(d->values["framebufferConfig"] != framebufferConfig)
+    return;
+
+  for(const auto& [name, attribute] : storedAttributes())
+    if(auto i = d->values.find(name); i != d->values.end())
+      SDL_GL_SetAttribute(attribute, std::atoi(i->second.c_str()));
+}
+
+//##################################################################################################
+void GLProfileCache::store(const std::string& profile, const std::string& framebufferConfig)
+{
+  if(d->path.empty())
+    return;
+
+  std::map<std::string, std::string> values;
+  values["profile"] = profile;
+  values["videoDriver"] = currentVideoDriver();
+  values["framebufferConfig"] = framebufferConfig;
+
+  for(const auto& [name, attribute] : storedAttributes())
+  {
+    int value=0;
+    SDL_GL_GetAttribute(attribute, &value);
+    values[name] = std::to_string(value);
+  }
+
+  if(auto getString = reinterpret_cast<GetString>(SDL_GL_GetProcAddress("glGetString")); getString)
+  {
+    auto toString = [&](GLenum name){auto s=getString(name); return s?std::string(reinterpret_cast<const char*>(s)):std::string();};
+    values["renderer"] = toString(GL_RENDERER);
+    values["version"] = toString(GL_VERSION);
+  }
+
+  if(values == d->values)
+    return;
+
+  d->values = values;
+  d->profile = profile;
+
+  std::string data;
+  for(const auto& [name, value] : values)
+    data += name + '=' + value + '\n';
+  writeFileAtomic(d->path, data);
+}
+
+}
@@ -0,0 +1,353 @@
+#include "tp_maps_sdl/GLProgramBinaryCache.h"
+#include "tp_maps_sdl/CacheFile.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#if defined(TP_GLES2) || defined(TP_ANDROID) || defined(TP_IOS)
+#  include <SDL2/SDL_opengles2.h>
+#else
+#  include <SDL2/SDL_opengl.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#  define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#  define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#  define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_LINK_STATUS
+#  define GL_LINK_STATUS 0x8B82
+#endif
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+using GetProgramBinary  = void (APIENTRY*)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+using ProgramBinary     = void (APIENTRY*)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+using ProgramParameteri = void (APIENTRY*)(GLuint program, GLenum pname, GLint value);
+using GetProgramiv      = void (APIENTRY*)(GLuint program, GLenum pname, GLint* params);
+using GetIntegerv       = void (APIENTRY*)(GLenum pname, GLint* data);
+using GetString         = const GLubyte* (APIENTRY*)(GLenum name);
+
+//! Written at the start of every file, bump the version if the layout changes.
+constexpr char fileMagic[8] = {'T', 'P', 'P', 'B', 'I', 'N', '0', '1'};
+}
+
+//##################################################################################################
+struct GLProgramBinaryCache::Private
+{
+  GLProgramBinaryCacheParams params;
+  tp_maps::ShaderProfile shaderProfile;
+
+  bool supported{false};
+  std::string driver;
+
+  GetProgramBinary  getProgramBinary{nullptr};
+  ProgramBinary     programBinary{nullptr};
+  ProgramParameteri programParameteri{nullptr};
+  GetProgramiv      getProgramiv{nullptr};
+
+  GLProgramBinaryCacheStats stats;
+
+  //################################################################################################
+  Private(tp_maps::ShaderProfile shaderProfile_, const GLProgramBinaryCacheParams& params_):
+    params(params_),
+    shaderProfile(shaderProfile_)
+  {
+    auto load = [](auto& fn, const char* name)
+    {
+      fn = reinterpret_cast<std::remove_reference_t<decltype(fn)>>(SDL_GL_GetProcAddress(name));
+      return fn != nullptr;
+    };
+
+    GetString getString{nullptr};
+    GetIntegerv getIntegerv{nullptr};
+    if(!load(getString, "glGetString") || !load(getIntegerv, "glGetIntegerv") || !load(getProgramiv, "glGetProgramiv"))
+      return;
+
+    for(GLenum name : {GLenum(GL_VENDOR), GLenum(GL_RENDERER), GLenum(GL_VERSION)})
+    {
+      if(auto s = getString(name); s)
+        driver += reinterpret_cast<const char*>(s);
+      driver += '\n';
+    }
+
+    int major=0;
+    int minor=0;
+    int profile=0;
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, &major);
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, &minor);
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, &profile);
+
+    if(profile == SDL_GL_CONTEXT_PROFILE_ES)
+    {
+      // ES 2 has no retrievable hint, the driver always keeps the binary.
+      if(SDL_GL_ExtensionSupported("GL_OES_get_program_binary"))
+        supported =
+            load(getProgramBinary, "glGetProgramBinaryOES") &&
+            load(programBinary,    "glProgramBinaryOES");
+    }
+    else if(major>4 || (major==4 && minor>=1) || SDL_GL_ExtensionSupported("GL_ARB_get_program_binary"))
+    {
+      supported =
+          load(getProgramBinary,  "glGetProgramBinary") &&
+          load(programBinary,     "glProgramBinary") &&
+          load(programParameteri, "glProgramParameteri");
+    }
+
+    // Some drivers expose the extension but support no formats at all.
+    if(supported)
+    {
+      GLint formats=0;
+      getIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+      supported = formats>0;
+    }
+
+    if(!supported)
+    {
+      tpDebug() << "GLProgramBinaryCache: Program binaries are not supported, shaders will be compiled from source.";
+      return;
+    }
+
+    if(params.directory.empty())
+    {
+      if(char* path = SDL_GetPrefPath("tp_maps_sdl", "program_binaries"); path)
+      {
+        params.directory = path;
+        SDL_free(path);
+      }
+    }
+
+    std::error_code ec;
+    if(params.directory.empty() || (std::filesystem::create_directories(params.directory, ec), ec))
+    {
+      tpWarning() << "GLProgramBinaryCache: Failed to create cache directory: " << params.directory;
+      supported = false;
+    }
+  }
+
+  //################################################################################################
+  std::filesystem::path pathForKey(const std::string& key) const
+  {
+    return std::filesystem::path(params.directory) / (key + ".bin");
+  }
+
+  //################################################################################################
+  //! Remove the least recently used binaries until the cache fits in maxBytes.
+  void evict()
+  {
+    struct Entry
+    {
+      std::filesystem::path path;
+      std::filesystem::file_time_type time;
+      uintmax_t size;
+    };
+
+    std::vector<Entry> entries;
+    uintmax_t totalSize=0;
+
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(params.directory, ec))
+    {
+      if(entry.path().extension() != ".bin")
+        continue;
+
+      Entry e;
+      e.path = entry.path();
+      e.time = entry.last_write_time(ec);
+      e.size = entry.file_size(ec);
+      if(ec)
+        continue;
+
+      totalSize += e.size;
+      entries.push_back(e);
+    }
+
+    if(totalSize<=params.maxBytes)
+      return;
+
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b){return a.time<b.time;});
+    for(const auto& e : entries)
+    {
+      if(totalSize<=params.maxBytes)
+        break;
+
+      if(std::filesystem::remove(e.path, ec))
+        totalSize -= e.size;
+    }
+  }
+};
+
+//##################################################################################################
+GLProgramBinaryCache::GLProgramBinaryCache(tp_maps::ShaderProfile shaderProfile, const GLProgramBinaryCacheParams& params):
+  d(new Private(shaderProfile, params))
+{
+
+}
+
+//##################################################################################################
+GLProgramBinaryCache::~GLProgramBinaryCache()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool GLProgramBinaryCache::isSupported() const
+{
+  return d->supported;
+}
+
+//##################################################################################################
+const std::string& GLProgramBinaryCache::directory() const
+{
+  return d->params.directory;
+}
+
+//##################################################################################################
+std::string GLProgramBinaryCache::makeKey(const std::vector<std::string>& sources) const
+{
+  uint64_t hash = fnv1aSeed;
+
+  auto profile = int(d->shaderProfile);
+  hash = fnv1a(hash, &profile, sizeof(profile));
+  hash = fnv1a(hash, d->driver.data(), d->driver.size());
+
+  // Include the lengths so that moving text between sources changes the key.
+  for(const auto& source : sources)
+  {
+    uint64_t size = source.size();
+    hash = fnv1a(hash, &size, sizeof(size));
+    hash = fnv1a(hash, source.data(), source.size());
+  }
+
+  return hashToHex(hash);
+}
+
+//##################################################################################################
+bool GLProgramBinaryCache::load(uint32_t program, const std::string& key)
+{
+  if(!d->supported)
+    return false;
+
+  auto path = d->pathForKey(key);
+
+  std::ifstream in(path, std::ios::binary);
+  if(!in)
+  {
+    d->stats.misses++;
+    return false;
+  }
+
+  char magic[sizeof(fileMagic)];
+  uint32_t format=0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&format), sizeof(format));
+  std::string binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  std::error_code ec;
+
+  GLint linked=GL_FALSE;
+  if(std::equal(magic, magic+sizeof(magic), fileMagic) && !binary.empty())
+  {
+    d->programBinary(GLuint(program), GLenum(format), binary.data(), GLsizei(binary.size()));
+    d->getProgramiv(GLuint(program), GL_LINK_STATUS, &linked);
+  }
+
+  if(linked != GL_TRUE)
+  {
+    // Rejected binaries are normal after a driver update, just compile from source.
+    d->stats.rejected++;
+    std::filesystem::remove(path, ec);
+    return false;
+  }
+
+  // Touch the file so that eviction is least recently used rather than least recently written.
+  std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+  d->stats.hits++;
+  return true;
+}
+
+//##################################################################################################
+void GLProgramBinaryCache::prepareProgram(uint32_t program)
+{
+  if(d->supported && d->programParameteri)
+    d->programParameteri(GLuint(program), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+//##################################################################################################
+void GLProgramBinaryCache::save(uint32_t program, const std::string& key)
+{
+  if(!d->supported)
+    return;
+
+  GLint linked=GL_FALSE;
+  d->getProgramiv(GLuint(program), GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE)
+    return;
+
+  GLint length=0;
+  d->getProgramiv(GLuint(program), GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length<1)
+    return;
+
+  std::string binary(size_t(length), '\0');
+  GLenum format=0;
+  GLsizei written=0;
+  d->getProgramBinary(GLuint(program), length, &written, &format, binary.data());
+  if(written<1)
+    return;
+  binary.resize(size_t(written));
+
+  auto format32 = uint32_t(format);
+  std::string data(fileMagic, sizeof(fileMagic));
+  data.append(reinterpret_cast<const char*>(&format32), sizeof(format32));
+  data += binary;
+
+  if(!writeFileAtomic(d->pathForKey(key), data))
+    return;
+
+  d->stats.stored++;
+  d->evict();
+}
+
+//##################################################################################################
+void GLProgramBinaryCache::clear()
+{
+  if(d->params.directory.empty())
+    return;
+
+  std::error_code ec;
+  for(const auto& entry : std::filesystem::directory_iterator(d->params.directory, ec))
+    if(entry.path().extension() == ".bin")
+      std::filesystem::remove(entry.path(), ec);
+}
+
+//##################################################################################################
+GLProgramBinaryCacheStats GLProgramBinaryCache::stats() const
+{
+  return d->stats;
+}
+
+}
@@ -0,0 +1,254 @@
+#include "tp_maps_sdl/GPUProfiler.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <limits>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct GPUProfiler::Private
+{
+  GPUProfiler* q;
+
+  const size_t framesInFlight;
+  const size_t maxQueries;
+  const size_t historySize;
+
+  bool enabled{true};
+  bool recording{false};
+
+  //################################################################################################
+  struct Scope
+  {
+    std::string name;
+    size_t beginQuery{0};
+    size_t endQuery{0};
+  };
+
+  //################################################################################################
+  struct Frame
+  {
+    std::vector<Scope> scopes;
+    size_t queryCount{0};
+    bool pending{false};
+  };
+
+  std::vector<Frame> frames;
+  size_t current{0};
+
+  //! Indexes into the current frames scopes, npos for scopes that did not fit.
+  std::vector<size_t> openScopes;
+
+  //################################################################################################
+  struct History
+  {
+    std::deque<double> samples;
+    double last{0.0};
+  };
+
+  std::map<std::string, History> history;
+  size_t droppedFrames{0};
+
+  std::vector<uint64_t> nanoseconds;
+
+  //################################################################################################
+  Private(GPUProfiler* q_, size_t framesInFlight_, size_t maxScopesPerFrame, size_t historySize_):
+    q(q_),
+    framesInFlight(std::max(size_t(2), framesInFlight_)),
+    maxQueries(maxScopesPerFrame*2),
+    historySize(std::max(size_t(1), historySize_)),
+    frames(framesInFlight)
+  {
+
+  }
+
+  //################################################################################################
+  bool collect(size_t f)
+  {
+    auto& frame = frames.at(f);
+    if(!frame.pending)
+      return true;
+
+    if(!q->readTimestamps(f, frame.queryCount, nanoseconds))
+      return false;
+
+    frame.pending = false;
+
+    for(const auto& scope : frame.scopes)
+    {
+      if(scope.endQuery>=nanoseconds.size() || scope.beginQuery>=nanoseconds.size())
+        continue;
+
+      auto begin = nanoseconds.at(scope.beginQuery);
+      auto end = nanoseconds.at(scope.endQuery);
+      double ms = (end>begin)?double(end-begin)/1000000.0:0.0;
+
+      auto& h = history[scope.name];
+      h.last = ms;
+      h.samples.push_back(ms);
+      while(h.samples.size()>historySize)
+        h.samples.pop_front();
+    }
+
+    return true;
+  }
+};
+
+//##################################################################################################
+GPUProfiler::GPUProfiler(size_t framesInFlight, size_t maxScopesPerFrame, size_t historySize):
+  d(new Private(this, framesInFlight, maxScopesPerFrame, historySize))
+{
+
+}
+
+//##################################################################################################
+GPUProfiler::~GPUProfiler()
+{
+  delete d;
+}
+
+//##################################################################################################
+void GPUProfiler::setEnabled(bool enabled)
+{
+  d->enabled = enabled;
+}
+
+//##################################################################################################
+bool GPUProfiler::enabled() const
+{
+  return d->enabled;
+}
+
+//##################################################################################################
+void GPUProfiler::beginFrame()
+{
+  if(d->recording)
+    endFrame();
+
+  if(!d->enabled || !isSupported())
+    return;
+
+  // Collect everything that has finished, oldest first.
+  for(size_t i=1; i<=d->framesInFlight; i++)
+    d->collect((d->current+i)%d->framesInFlight);
+
+  d->current = (d->current+1)%d->framesInFlight;
+
+  auto& frame = d->frames.at(d->current);
+  if(!d->collect(d->current))
+  {
+    frame.pending = false;
+    d->droppedFrames++;
+  }
+
+  frame.scopes.clear();
+  frame.queryCount = 0;
+  resetQueries(d->current, d->maxQueries);
+  d->recording = true;
+}
+
+//##################################################################################################
+void GPUProfiler::endFrame()
+{
+  if(!d->recording)
+    return;
+
+  while(!d->openScopes.empty())
+  {
+    tpWarning() << "GPUProfiler: Scope left open at the end of the frame.";
+    endScope();
+  }
+
+  auto& frame = d->frames.at(d->current);
+  frame.pending = !frame.scopes.empty();
+  d->recording = false;
+}
+
+//##################################################################################################
+void GPUProfiler::beginScope(const std::string& name)
+{
+  auto& frame = d->frames.at(d->current);
+
+  // Every open scope that was recorded still needs a query for its end.
+  size_t pendingEnds = size_t(std::count_if(d->openScopes.begin(), d->openScopes.end(), [](size_t i){return i!=std::numeric_limits<size_t>::max();}));
+  if(!d->recording || frame.queryCount+2+pendingEnds>d->maxQueries)
+  {
+    d->openScopes.push_back(std::numeric_limits<size_t>::max());
+    return;
+  }
+
+  d->openScopes.push_back(frame.scopes.size());
+  auto& scope = frame.scopes.emplace_back();
+  scope.name = name;
+  scope.beginQuery = frame.queryCount++;
+  writeTimestamp(d->current, scope.beginQuery, false);
+}
+
+//##################################################################################################
+void GPUProfiler::endScope()
+{
+  if(d->openScopes.empty())
+    return;
+
+  auto index = d->openScopes.back();
+  d->openScopes.pop_back();
+
+  if(!d->recording || index == std::numeric_limits<size_t>::max())
+    return;
+
+  auto& frame = d->frames.at(d->current);
+  auto& scope = frame.scopes.at(index);
+  scope.endQuery = frame.queryCount++;
+  writeTimestamp(d->current, scope.endQuery, true);
+}
+
+//##################################################################################################
+std::vector<GPUScopeStats> GPUProfiler::stats() const
+{
+  std::vector<GPUScopeStats> result;
+  result.reserve(d->history.size());
+
+  for(const auto& i : d->history)
+  {
+    if(i.second.samples.empty())
+      continue;
+
+    auto& s = result.emplace_back();
+    s.name = i.first;
+    s.lastMS = i.second.last;
+    s.samples = i.second.samples.size();
+    s.minMS = std::numeric_limits<double>::max();
+    s.maxMS = 0.0;
+
+    double total=0.0;
+    for(auto ms : i.second.samples)
+    {
+      total += ms;
+      s.minMS = std::min(s.minMS, ms);
+      s.maxMS = std::max(s.maxMS, ms);
+    }
+    s.meanMS = total / double(s.samples);
+  }
+
+  return result;
+}
+
+//##################################################################################################
+void GPUProfiler::resetStats()
+{
+  d->history.clear();
+  d->droppedFrames = 0;
+}
+
+//##################################################################################################
+size_t GPUProfiler::droppedFrames() const
+{
+  return d->droppedFrames;
+}
+
+}
@@ -1,4 +1,7 @@
 #include "tp_maps_sdl/Globals.h"
+#include "tp_maps_sdl/ImageDecoders.h"
+#include "tp_maps_sdl/ImageRowSink.h"
+#include "tp_maps_sdl/Trace.h"
 
 #include "tp_utils/DebugUtils.h"
 #include "tp_utils/Resources.h"
@@ -8,43 +11,64 @@
 namespace tp_maps_sdl
 {
 
+namespace
+{
 //##################################################################################################
-tp_image_utils::ColorMap loadTextureFromResource(const std::string& path)
+//! Decode into sink using the built in decoders or SDL_image.
+bool decodeToSink(const void* data, size_t size, const std::string& name, ImageRowSink& sink)
 {
-  if(!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
+  TraceScope traceScope("decodeTexture", "texture");
+
+  // Formats that we control are decoded directly, this avoids SDL_image and the per pixel conversion.
+  if(auto format = detectImageFormat(data, size); format != ImageFormat::Unknown)
   {
-    tpWarning() << "SDL_image could not initialize! SDL_image Error: " << IMG_GetError();
-    return tp_image_utils::ColorMap();
+    if(decodeImage(data, size, sink))
+      return true;
+
+    tpWarning() << "Failed to decode " << imageFormatToString(format) << " image: " << name;
+    return false;
   }
 
-  tp_utils::Resource resource = tp_utils::resource(path);
-  if(!resource.data || resource.size<1)
+  if(!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG))
   {
-    tpWarning() << "Failed to load resource: " << path;
-    return tp_image_utils::ColorMap();
+    tpWarning() << "SDL_image could not initialize! SDL_image Error: " << IMG_GetError();
+    return false;
   }
 
-  auto rw = SDL_RWFromConstMem(resource.data, int(resource.size));
+  auto rw = SDL_RWFromConstMem(data, int(size));
   if(!rw)
   {
-    tpWarning() << "Failed to create SDL_RWops for resource: " << path;
-    return tp_image_utils::ColorMap();
+    tpWarning() << "Failed to create SDL_RWops for resource: " << name;
+    return false;
   }
   TP_CLEANUP([&]{SDL_FreeRW(rw);});
 
   auto surface = IMG_Load_RW(rw, 0);
   if(!surface)
   {
-    tpWarning() << "Failed to create SDL_Surface for resource: " << path;
-    return tp_image_utils::ColorMap();
+    tpWarning() << "Failed to create SDL_Surface for resource: " << name;
+    return false;
   }
   TP_CLEANUP([&]{SDL_FreeSurface(surface);});
 
+  // JPEGs and PNGs without alpha load as 24 bit or paletted surfaces, the loop below reads 32 bit pixels.
+  if(surface->format->BytesPerPixel != 4)
+  {
+    auto converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0);
+    if(!converted)
+    {
+      tpWarning() << "Failed to convert SDL_Surface for resource: " << name << " SDL Error: " << SDL_GetError();
+      return false;
+    }
+    SDL_FreeSurface(surface);
+    surface = converted;
+  }
+
   SDL_LockSurface(surface);
   TP_CLEANUP([&]{SDL_UnlockSurface(surface);});
 
-  tp_image_utils::ColorMap result(size_t(surface->w), size_t(surface->h));
-  TPPixel* dst = result.data();
+  if(!sink.begin(size_t(surface->w), size_t(surface->h)))
+    return false;
 
   std::ptrdiff_t pitch = surface->pitch / 4;
   auto hh = surface->h-1;
@@ -53,14 +77,108 @@ tp_image_utils::ColorMap loadTextureFromResource(const std::string& path)
     // Note that:
     // tp_image_utils::ColorMap 0,0 is in the bottom left.
     // SDL_Surface              0,0 is in the top left.
+    TPPixel* dst = sink.row(size_t(y));
     const Uint32* src = reinterpret_cast<const Uint32*>(surface->pixels) + (pitch*(hh-y));
     auto srcMax = src+std::ptrdiff_t(surface->w);
     for(; src<srcMax; src++, dst++)
       SDL_GetRGBA(*src, surface->format, &dst->r, &dst->g, &dst->b, &dst->a);
+    sink.rowDone(size_t(y));
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool needsRegionScale(const TextureLoadOptions& options)
+{
+  return options.maxDimension>0 || (options.regionWidth>0 && options.regionHeight>0);
+}
+}
+
+//##################################################################################################
+tp_image_utils::ColorMap loadTextureFromResource(const std::string& path, const TextureLoadOptions& options)
+{
+  tp_utils::Resource resource = tp_utils::resource(path);
+  if(!resource.data || resource.size<1)
+  {
+    tpWarning() << "Failed to load resource: " << path;
+    return tp_image_utils::ColorMap();
   }
 
+  return loadTextureFromData(resource.data, resource.size, path, options);
+}
+
+//##################################################################################################
+tp_image_utils::ColorMap loadTextureFromData(const void* data, size_t size, const std::string& name, const TextureLoadOptions& options)
+{
+  // Separate returns so that result is moved rather than copied, keeping any pooled buffer.
+  tp_image_utils::ColorMap result;
+  if(!loadTextureInto(result, data, size, name, options))
+    return {};
   return result;
 }
 
+//##################################################################################################
+bool loadTextureInto(tp_image_utils::ColorMap& destination,
+                     const void* data,
+                     size_t size,
+                     const std::string& name,
+                     const TextureLoadOptions& options)
+{
+  ColorMapRowSink colorMapSink(destination, options.pool);
+
+  if(needsRegionScale(options))
+  {
+    RegionScaleRowSink regionScaleSink(colorMapSink,
+                                       options.regionX,
+                                       options.regionY,
+                                       options.regionWidth,
+                                       options.regionHeight,
+                                       options.maxDimension);
+    return decodeToSink(data, size, name, regionScaleSink);
+  }
+
+  return decodeToSink(data, size, name, colorMapSink);
 }
 
+//##################################################################################################
+bool loadTilesFromResource(const std::string& path,
+                           size_t tileSize,
+                           const TileCallback& callback,
+                           const TextureLoadOptions& options)
+{
+  tp_utils::Resource resource = tp_utils::resource(path);
+  if(!resource.data || resource.size<1)
+  {
+    tpWarning() << "Failed to load resource: " << path;
+    return false;
+  }
+
+  return loadTilesFromData(resource.data, resource.size, tileSize, callback, path, options);
+}
+
+//##################################################################################################
+bool loadTilesFromData(const void* data,
+                       size_t size,
+                       size_t tileSize,
+                       const TileCallback& callback,
+                       const std::string& name,
+                       const TextureLoadOptions& options)
+{
+  TileRowSink tileSink(tileSize, callback, options.pool);
+
+  if(needsRegionScale(options))
+  {
+    RegionScaleRowSink regionScaleSink(tileSink,
+                                       options.regionX,
+                                       options.regionY,
+                                       options.regionWidth,
+                                       options.regionHeight,
+                                       options.maxDimension);
+    return decodeToSink(data, size, name, regionScaleSink);
+  }
+
+  return decodeToSink(data, size, name, tileSink);
+}
+
+}
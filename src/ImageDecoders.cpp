@@ -0,0 +1,395 @@
+#include "tp_maps_sdl/ImageDecoders.h"
+#include "tp_maps_sdl/ImageRowSink.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//! Refuse to allocate anything bigger than this from a corrupt header.
+constexpr size_t maxPixels = size_t(1)<<28;
+
+//##################################################################################################
+uint32_t readBE32(const uint8_t* p)
+{
+  return (uint32_t(p[0])<<24) | (uint32_t(p[1])<<16) | (uint32_t(p[2])<<8) | uint32_t(p[3]);
+}
+
+//##################################################################################################
+uint16_t readLE16(const uint8_t* p)
+{
+  return uint16_t(uint16_t(p[0]) | (uint16_t(p[1])<<8));
+}
+
+//##################################################################################################
+bool validSize(size_t w, size_t h)
+{
+  return w>0 && h>0 && w<=maxPixels && h<=maxPixels && (w*h)<=maxPixels;
+}
+
+//##################################################################################################
+//! TGA has no magic number, so check the header is plausible.
+/*!
+Only the image types and depths that decodeTGA() supports are accepted, even with a version 2 footer,
+so that colour mapped and 15/16 bit files still go to SDL_image rather than failing here.
+*/
+bool isTGA(const uint8_t* p, size_t size)
+{
+  if(size<18)
+    return false;
+
+  uint8_t colorMapType = p[1];
+  uint8_t imageType    = p[2];
+  uint8_t depth        = p[16];
+  bool typeOK  = (imageType==2 || imageType==3 || imageType==10 || imageType==11);
+  bool depthOK = (depth==8 || depth==24 || depth==32);
+  return colorMapType==0 && typeOK && depthOK && readLE16(p+12)>0 && readLE16(p+14)>0;
+}
+
+//##################################################################################################
+//! Skip white space and # comments in a PNM header.
+void skipPNMSpace(const uint8_t*& p, const uint8_t* end)
+{
+  while(p<end)
+  {
+    if(*p=='#')
+    {
+      while(p<end && *p!='\n')
+        p++;
+    }
+    else if(*p==' ' || *p=='\t' || *p=='\n' || *p=='\r')
+      p++;
+    else
+      break;
+  }
+}
+
+//##################################################################################################
+bool readPNMInt(const uint8_t*& p, const uint8_t* end, size_t& value)
+{
+  skipPNMSpace(p, end);
+  if(p>=end || *p<'0' || *p>'9')
+    return false;
+
+  value = 0;
+  for(; p<end && *p>='0' && *p<='9'; p++)
+  {
+    value = value*10 + size_t(*p-'0');
+    if(value>maxPixels)
+      return false;
+  }
+  return true;
+}
+}
+
+//##################################################################################################
+const char* imageFormatToString(ImageFormat format)
+{
+  switch(format)
+  {
+    case ImageFormat::Unknown: return "Unknown";
+    case ImageFormat::QOI:     return "QOI";
+    case ImageFormat::TGA:     return "TGA";
+    case ImageFormat::PNM:     return "PNM";
+  }
+  return "Unknown";
+}
+
+//##################################################################################################
+ImageFormat detectImageFormat(const void* data, size_t size)
+{
+  auto p = static_cast<const uint8_t*>(data);
+
+  if(size>=14 && std::memcmp(p, "qoif", 4) == 0)
+    return ImageFormat::QOI;
+
+  if(size>=3 && p[0]=='P' && (p[1]=='5' || p[1]=='6'))
+    return ImageFormat::PNM;
+
+  if(isTGA(p, size))
+    return ImageFormat::TGA;
+
+  return ImageFormat::Unknown;
+}
+
+//##################################################################################################
+bool decodeImage(const void* data, size_t size, ImageRowSink& sink)
+{
+  switch(detectImageFormat(data, size))
+  {
+    case ImageFormat::Unknown: return false;
+    case ImageFormat::QOI:     return decodeQOI(data, size, sink);
+    case ImageFormat::TGA:     return decodeTGA(data, size, sink);
+    case ImageFormat::PNM:     return decodePNM(data, size, sink);
+  }
+  return false;
+}
+
+//##################################################################################################
+bool decodeImage(const void* data, size_t size, tp_image_utils::ColorMap& result)
+{
+  ColorMapRowSink sink(result);
+  return decodeImage(data, size, sink);
+}
+
+//##################################################################################################
+bool decodeQOI(const void* data, size_t size, ImageRowSink& sink)
+{
+  auto p = static_cast<const uint8_t*>(data);
+  constexpr size_t headerSize=14;
+  constexpr size_t paddingSize=8;
+
+  if(size<headerSize+paddingSize || std::memcmp(p, "qoif", 4) != 0)
+    return false;
+
+  size_t w = readBE32(p+4);
+  size_t h = readBE32(p+8);
+  if(!validSize(w, h) || !sink.begin(w, h))
+    return false;
+
+  TPPixel index[64];
+  std::memset(index, 0, sizeof(index));
+  TPPixel px{0, 0, 0, 255};
+
+  const uint8_t* in = p+headerSize;
+  const uint8_t* end = p+size-paddingSize;
+  size_t run=0;
+
+  // QOI is stored top down, rows are numbered bottom up.
+  for(size_t y=h; y>0; y--)
+  {
+    TPPixel* dst = sink.row(y-1);
+    for(size_t x=0; x<w; x++)
+    {
+      if(run>0)
+      {
+        run--;
+      }
+      else if(in<end)
+      {
+        uint8_t b1 = *in++;
+
+        if(b1 == 0xfe) // QOI_OP_RGB
+        {
+          if(end-in<3)
+            return false;
+          px.r = in[0];
+          px.g = in[1];
+          px.b = in[2];
+          in += 3;
+        }
+        else if(b1 == 0xff) // QOI_OP_RGBA
+        {
+          if(end-in<4)
+            return false;
+          px.r = in[0];
+          px.g = in[1];
+          px.b = in[2];
+          px.a = in[3];
+          in += 4;
+        }
+        else switch(b1 & 0xc0)
+        {
+          case 0x00: // QOI_OP_INDEX
+            px = index[b1];
+            break;
+
+          case 0x40: // QOI_OP_DIFF
+            px.r = uint8_t(px.r + ((b1>>4) & 0x03) - 2);
+            px.g = uint8_t(px.g + ((b1>>2) & 0x03) - 2);
+            px.b = uint8_t(px.b + ( b1     & 0x03) - 2);
+            break;
+
+          case 0x80: // QOI_OP_LUMA
+          {
+            if(in>=end)
+              return false;
+            uint8_t b2 = *in++;
+            int vg = (b1 & 0x3f) - 32;
+            px.r = uint8_t(px.r + vg - 8 + ((b2>>4) & 0x0f));
+            px.g = uint8_t(px.g + vg);
+            px.b = uint8_t(px.b + vg - 8 +  (b2     & 0x0f));
+            break;
+          }
+
+          default: // QOI_OP_RUN
+            run = (b1 & 0x3f);
+            break;
+        }
+
+        index[(px.r*3 + px.g*5 + px.b*7 + px.a*11) % 64] = px;
+      }
+
+      dst[x] = px;
+    }
+    sink.rowDone(y-1);
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool decodeTGA(const void* data, size_t size, ImageRowSink& sink)
+{
+  auto p = static_cast<const uint8_t*>(data);
+  if(size<18)
+    return false;
+
+  size_t idLength   = p[0];
+  uint8_t imageType = p[2];
+  size_t w          = readLE16(p+12);
+  size_t h          = readLE16(p+14);
+  size_t depth      = p[16];
+  uint8_t descriptor= p[17];
+
+  if(p[1] != 0 || !validSize(w, h))
+    return false;
+
+  bool rle = (imageType==10 || imageType==11);
+  if(!(imageType==2 || imageType==3 || rle) || !(depth==8 || depth==24 || depth==32))
+    return false;
+
+  size_t bytesPerPixel = depth/8;
+  const uint8_t* in = p+18+idLength;
+  const uint8_t* end = p+size;
+  if(in>end)
+    return false;
+
+  if(!rle && size_t(end-in) < w*h*bytesPerPixel)
+    return false;
+
+  if(!sink.begin(w, h))
+    return false;
+
+  // The default TGA origin is bottom left, the same as ColorMap.
+  bool topOrigin   = descriptor & 0x20;
+  bool rightOrigin = descriptor & 0x10;
+
+  auto readPixel = [&](const uint8_t* s)
+  {
+    if(bytesPerPixel==1)
+      return TPPixel{s[0], s[0], s[0], 255};
+    return TPPixel{s[2], s[1], s[0], (bytesPerPixel==4)?s[3]:uint8_t(255)};
+  };
+
+  // State for RLE packets, these can span rows.
+  size_t packetLeft=0;
+  bool packetRepeat=false;
+  TPPixel repeatPixel{0, 0, 0, 0};
+
+  for(size_t r=0; r<h; r++)
+  {
+    size_t y = topOrigin?h-1-r:r;
+    TPPixel* dst = sink.row(y);
+
+    for(size_t i=0; i<w; i++)
+    {
+      size_t x = rightOrigin?w-1-i:i;
+
+      if(!rle)
+      {
+        dst[x] = readPixel(in);
+        in += bytesPerPixel;
+        continue;
+      }
+
+      if(packetLeft==0)
+      {
+        if(in>=end)
+          return false;
+        uint8_t packet = *in++;
+        packetLeft = size_t(packet & 0x7f) + 1;
+        packetRepeat = packet & 0x80;
+        if(packetRepeat)
+        {
+          if(size_t(end-in)<bytesPerPixel)
+            return false;
+          repeatPixel = readPixel(in);
+          in += bytesPerPixel;
+        }
+      }
+
+      packetLeft--;
+      if(packetRepeat)
+        dst[x] = repeatPixel;
+      else
+      {
+        if(size_t(end-in)<bytesPerPixel)
+          return false;
+        dst[x] = readPixel(in);
+        in += bytesPerPixel;
+      }
+    }
+
+    sink.rowDone(y);
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool decodePNM(const void* data, size_t size, ImageRowSink& sink)
+{
+  auto p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p+size;
+  if(size<3 || p[0]!='P' || (p[1]!='5' && p[1]!='6'))
+    return false;
+
+  size_t channels = (p[1]=='6')?3:1;
+  const uint8_t* in = p+2;
+
+  size_t w=0;
+  size_t h=0;
+  size_t maxValue=0;
+  if(!readPNMInt(in, end, w) || !readPNMInt(in, end, h) || !readPNMInt(in, end, maxValue))
+    return false;
+
+  if(!validSize(w, h) || maxValue<1 || maxValue>65535 || in>=end)
+    return false;
+
+  // Exactly one white space character separates the header from the raster.
+  in++;
+
+  size_t bytesPerSample = (maxValue>255)?2:1;
+  size_t stride = w*channels*bytesPerSample;
+  if(size_t(end-in) < stride*h)
+    return false;
+
+  if(!sink.begin(w, h))
+    return false;
+
+  uint8_t lut[256];
+  for(size_t i=0; i<256; i++)
+    lut[i] = uint8_t(std::min(size_t(255), (i*255 + maxValue/2) / std::min(maxValue, size_t(255))));
+
+  // Samples are big endian so for 16 bit samples the first byte is the most significant.
+  auto sample = [&](const uint8_t* s){return (bytesPerSample==1)?lut[s[0]]:uint8_t(((size_t(s[0])<<8 | s[1])*255 + maxValue/2) / maxValue);};
+
+  // PNM is stored top down, rows are numbered bottom up.
+  for(size_t r=0; r<h; r++)
+  {
+    size_t y = h-1-r;
+    TPPixel* dst = sink.row(y);
+    const uint8_t* s = in + r*stride;
+    for(size_t x=0; x<w; x++, s+=channels*bytesPerSample)
+    {
+      if(channels==3)
+        dst[x] = TPPixel{sample(s), sample(s+bytesPerSample), sample(s+2*bytesPerSample), 255};
+      else
+      {
+        uint8_t v = sample(s);
+        dst[x] = TPPixel{v, v, v, 255};
+      }
+    }
+    sink.rowDone(y);
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,318 @@
+#include "tp_maps_sdl/ImageRowSink.h"
+#include "tp_maps_sdl/ColorMapPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+ColorMapRowSink::ColorMapRowSink(tp_image_utils::ColorMap& result, ColorMapPool* pool):
+  m_result(result),
+  m_pool(pool)
+{
+
+}
+
+//##################################################################################################
+bool ColorMapRowSink::begin(size_t width, size_t height)
+{
+  if(m_result.width()==width && m_result.height()==height)
+    return true;
+
+  if(m_pool)
+  {
+    m_pool->give(std::move(m_result));
+    m_result = m_pool->take(width, height);
+  }
+  else
+    m_result = tp_image_utils::ColorMap(width, height);
+
+  return true;
+}
+
+//##################################################################################################
+TPPixel* ColorMapRowSink::row(size_t y)
+{
+  return m_result.data() + y*m_result.width();
+}
+
+//##################################################################################################
+void ColorMapRowSink::rowDone(size_t y)
+{
+  TP_UNUSED(y);
+}
+
+//##################################################################################################
+struct RegionScaleRowSink::Private
+{
+  ImageRowSink& next;
+  size_t regionX;
+  size_t regionY;
+  size_t regionWidth;
+  size_t regionHeight;
+  size_t maxDimension;
+
+  size_t outWidth{0};
+  size_t outHeight{0};
+
+  std::vector<TPPixel> scratch;
+  std::vector<size_t> columnStarts; //!< The first source column for each output column, plus the end.
+  std::vector<uint64_t> sums;
+  size_t currentRow{std::numeric_limits<size_t>::max()};
+  size_t rowsAccumulated{0};
+
+  //################################################################################################
+  Private(ImageRowSink& next_,
+          size_t regionX_,
+          size_t regionY_,
+          size_t regionWidth_,
+          size_t regionHeight_,
+          size_t maxDimension_):
+    next(next_),
+    regionX(regionX_),
+    regionY(regionY_),
+    regionWidth(regionWidth_),
+    regionHeight(regionHeight_),
+    maxDimension(maxDimension_)
+  {
+
+  }
+
+  //################################################################################################
+  //! The first source row, relative to the region, that contributes to output row.
+  size_t bandStart(size_t outRow) const
+  {
+    return (outRow*regionHeight) / outHeight;
+  }
+
+  //################################################################################################
+  size_t outputRowFor(size_t localY) const
+  {
+    size_t outRow = std::min(outHeight-1, (localY*outHeight) / regionHeight);
+    while(outRow+1<outHeight && bandStart(outRow+1)<=localY)
+      outRow++;
+    while(outRow>0 && bandStart(outRow)>localY)
+      outRow--;
+    return outRow;
+  }
+};
+
+//##################################################################################################
+RegionScaleRowSink::RegionScaleRowSink(ImageRowSink& next,
+                                       size_t regionX,
+                                       size_t regionY,
+                                       size_t regionWidth,
+                                       size_t regionHeight,
+                                       size_t maxDimension):
+  d(new Private(next, regionX, regionY, regionWidth, regionHeight, maxDimension))
+{
+
+}
+
+//##################################################################################################
+RegionScaleRowSink::~RegionScaleRowSink()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool RegionScaleRowSink::begin(size_t width, size_t height)
+{
+  if(d->regionWidth==0 || d->regionHeight==0)
+  {
+    d->regionX = 0;
+    d->regionY = 0;
+    d->regionWidth = width;
+    d->regionHeight = height;
+  }
+
+  d->regionX = std::min(d->regionX, width);
+  d->regionY = std::min(d->regionY, height);
+  d->regionWidth = std::min(d->regionWidth, width-d->regionX);
+  d->regionHeight = std::min(d->regionHeight, height-d->regionY);
+
+  if(d->regionWidth==0 || d->regionHeight==0)
+    return false;
+
+  d->outWidth = d->regionWidth;
+  d->outHeight = d->regionHeight;
+
+  // Keep the aspect ratio, the longest side becomes maxDimension.
+  size_t longest = std::max(d->regionWidth, d->regionHeight);
+  if(d->maxDimension>0 && longest>d->maxDimension)
+  {
+    d->outWidth  = std::max(size_t(1), (d->regionWidth *d->maxDimension + longest/2) / longest);
+    d->outHeight = std::max(size_t(1), (d->regionHeight*d->maxDimension + longest/2) / longest);
+  }
+
+  d->scratch.resize(width);
+  d->sums.assign(d->outWidth*4, 0);
+  d->columnStarts.resize(d->outWidth+1);
+  for(size_t x=0; x<=d->outWidth; x++)
+    d->columnStarts[x] = d->regionX + (x*d->regionWidth) / d->outWidth;
+
+  d->currentRow = std::numeric_limits<size_t>::max();
+  d->rowsAccumulated = 0;
+
+  return d->next.begin(d->outWidth, d->outHeight);
+}
+
+//##################################################################################################
+TPPixel* RegionScaleRowSink::row(size_t y)
+{
+  TP_UNUSED(y);
+  return d->scratch.data();
+}
+
+//##################################################################################################
+void RegionScaleRowSink::rowDone(size_t y)
+{
+  if(y<d->regionY || y>=d->regionY+d->regionHeight)
+    return;
+
+  size_t localY = y - d->regionY;
+  const TPPixel* src = d->scratch.data();
+
+  // Not scaling, just crop.
+  if(d->outWidth==d->regionWidth && d->outHeight==d->regionHeight)
+  {
+    std::memcpy(d->next.row(localY), src+d->regionX, d->regionWidth*sizeof(TPPixel));
+    d->next.rowDone(localY);
+    return;
+  }
+
+  size_t outRow = d->outputRowFor(localY);
+  if(outRow != d->currentRow)
+  {
+    d->currentRow = outRow;
+    d->rowsAccumulated = 0;
+    std::fill(d->sums.begin(), d->sums.end(), 0);
+  }
+
+  uint64_t* sum = d->sums.data();
+  for(size_t x=0; x<d->outWidth; x++, sum+=4)
+  {
+    for(size_t sx=d->columnStarts[x]; sx<d->columnStarts[x+1]; sx++)
+    {
+      const TPPixel& p = src[sx];
+      sum[0] += p.r;
+      sum[1] += p.g;
+      sum[2] += p.b;
+      sum[3] += p.a;
+    }
+  }
+
+  d->rowsAccumulated++;
+
+  size_t bandHeight = ((outRow+1<d->outHeight)?d->bandStart(outRow+1):d->regionHeight) - d->bandStart(outRow);
+  if(d->rowsAccumulated<bandHeight)
+    return;
+
+  TPPixel* dst = d->next.row(outRow);
+  sum = d->sums.data();
+  for(size_t x=0; x<d->outWidth; x++, sum+=4)
+  {
+    uint64_t count = uint64_t(d->columnStarts[x+1]-d->columnStarts[x]) * bandHeight;
+    dst[x].r = uint8_t((sum[0] + count/2) / count);
+    dst[x].g = uint8_t((sum[1] + count/2) / count);
+    dst[x].b = uint8_t((sum[2] + count/2) / count);
+    dst[x].a = uint8_t((sum[3] + count/2) / count);
+  }
+  d->next.rowDone(outRow);
+
+  d->currentRow = std::numeric_limits<size_t>::max();
+}
+
+//##################################################################################################
+struct TileRowSink::Private
+{
+  size_t tileSize;
+  TileCallback callback;
+  ColorMapPool* pool;
+
+  size_t width{0};
+  size_t height{0};
+
+  std::vector<TPPixel> band;
+  size_t currentBand{std::numeric_limits<size_t>::max()};
+  size_t rowsInBand{0};
+
+  //################################################################################################
+  Private(size_t tileSize_, const TileCallback& callback_, ColorMapPool* pool_):
+    tileSize(std::max(size_t(1), tileSize_)),
+    callback(callback_),
+    pool(pool_)
+  {
+
+  }
+};
+
+//##################################################################################################
+TileRowSink::TileRowSink(size_t tileSize, const TileCallback& callback, ColorMapPool* pool):
+  d(new Private(tileSize, callback, pool))
+{
+
+}
+
+//##################################################################################################
+TileRowSink::~TileRowSink()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool TileRowSink::begin(size_t width, size_t height)
+{
+  d->width = width;
+  d->height = height;
+  d->band.resize(width*std::min(d->tileSize, height));
+  d->currentBand = std::numeric_limits<size_t>::max();
+  d->rowsInBand = 0;
+  return true;
+}
+
+//##################################################################################################
+TPPixel* TileRowSink::row(size_t y)
+{
+  return d->band.data() + (y%d->tileSize)*d->width;
+}
+
+//##################################################################################################
+void TileRowSink::rowDone(size_t y)
+{
+  size_t bandIndex = y/d->tileSize;
+  if(bandIndex != d->currentBand)
+  {
+    d->currentBand = bandIndex;
+    d->rowsInBand = 0;
+  }
+
+  d->rowsInBand++;
+
+  size_t bandY = bandIndex*d->tileSize;
+  size_t bandHeight = std::min(d->tileSize, d->height-bandY);
+  if(d->rowsInBand<bandHeight)
+    return;
+
+  for(size_t tileX=0; tileX*d->tileSize<d->width; tileX++)
+  {
+    size_t x = tileX*d->tileSize;
+    size_t tileWidth = std::min(d->tileSize, d->width-x);
+
+    auto tile = d->pool?d->pool->take(tileWidth, bandHeight):tp_image_utils::ColorMap(tileWidth, bandHeight);
+    for(size_t ty=0; ty<bandHeight; ty++)
+      std::memcpy(tile.data()+ty*tileWidth, d->band.data()+ty*d->width+x, tileWidth*sizeof(TPPixel));
+
+    d->callback(tileX, bandIndex, tile);
+
+    if(d->pool)
+      d->pool->give(std::move(tile));
+  }
+
+  d->currentBand = std::numeric_limits<size_t>::max();
+}
+
+}
@@ -0,0 +1,169 @@
+#include "tp_maps_sdl/InputLatency.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//! Stop collecting timestamps if nothing is being painted, the oldest are the interesting ones.
+constexpr size_t maxPending=1024;
+}
+
+//##################################################################################################
+struct InputLatencyTracker::Private
+{
+  const double bucketMS;
+
+  bool enabled{true};
+  double logIntervalMS{10000.0};
+  uint32_t lastLog{0};
+
+  std::vector<uint32_t> pending;
+  std::vector<uint32_t> inFlight;
+
+  std::vector<size_t> buckets;
+  size_t samples{0};
+  double sumMS{0.0};
+  double maxMS{0.0};
+
+  //################################################################################################
+  Private(double bucketMS_, size_t bucketCount):
+    bucketMS(std::max(0.001, bucketMS_)),
+    buckets(std::max(size_t(1), bucketCount), 0)
+  {
+    pending.reserve(maxPending);
+    inFlight.reserve(maxPending);
+  }
+
+  //################################################################################################
+  //! The upper edge of the bucket containing the fraction of samples.
+  double percentile(double fraction) const
+  {
+    if(samples==0)
+      return 0.0;
+
+    auto target = size_t(std::ceil(fraction*double(samples)));
+    size_t count=0;
+    for(size_t i=0; i<buckets.size(); i++)
+    {
+      count += buckets.at(i);
+      if(count>=target)
+        return std::min(double(i+1)*bucketMS, maxMS);
+    }
+    return maxMS;
+  }
+};
+
+//##################################################################################################
+InputLatencyTracker::InputLatencyTracker(double bucketMS, size_t bucketCount):
+  d(new Private(bucketMS, bucketCount))
+{
+  d->lastLog = SDL_GetTicks();
+}
+
+//##################################################################################################
+InputLatencyTracker::~InputLatencyTracker()
+{
+  delete d;
+}
+
+//##################################################################################################
+void InputLatencyTracker::setEnabled(bool enabled)
+{
+  d->enabled = enabled;
+  d->pending.clear();
+  d->inFlight.clear();
+}
+
+//##################################################################################################
+bool InputLatencyTracker::enabled() const
+{
+  return d->enabled;
+}
+
+//##################################################################################################
+void InputLatencyTracker::setLogInterval(double intervalMS)
+{
+  d->logIntervalMS = intervalMS;
+}
+
+//##################################################################################################
+void InputLatencyTracker::inputEvent(uint32_t timestamp)
+{
+  if(d->enabled && d->pending.size()<maxPending)
+    d->pending.push_back(timestamp);
+}
+
+//##################################################################################################
+void InputLatencyTracker::frameStarted()
+{
+  // Events that arrive while a frame is painting belong to the next frame.
+  d->inFlight.insert(d->inFlight.end(), d->pending.begin(), d->pending.end());
+  d->pending.clear();
+}
+
+//##################################################################################################
+void InputLatencyTracker::framePresented()
+{
+  uint32_t now = SDL_GetTicks();
+
+  for(auto timestamp : d->inFlight)
+  {
+    // Unsigned subtraction handles the tick counter wrapping.
+    double ms = double(uint32_t(now-timestamp));
+    auto bucket = std::min(size_t(ms/d->bucketMS), d->buckets.size()-1);
+    d->buckets[bucket]++;
+    d->samples++;
+    d->sumMS += ms;
+    d->maxMS = std::max(d->maxMS, ms);
+  }
+  d->inFlight.clear();
+
+  if(d->logIntervalMS>0.0 && double(uint32_t(now-d->lastLog))>=d->logIntervalMS)
+  {
+    d->lastLog = now;
+    if(d->samples>0)
+    {
+      auto s = stats();
+      tpDebug() << "Input latency samples: " << s.samples
+                << " mean: " << s.meanMS << "ms"
+                << " p50: " << s.p50MS << "ms"
+                << " p90: " << s.p90MS << "ms"
+                << " p99: " << s.p99MS << "ms"
+                << " max: " << s.maxMS << "ms";
+    }
+  }
+}
+
+//##################################################################################################
+InputLatencyStats InputLatencyTracker::stats() const
+{
+  InputLatencyStats s;
+  s.samples = d->samples;
+  s.meanMS = (d->samples>0)?d->sumMS/double(d->samples):0.0;
+  s.p50MS = d->percentile(0.50);
+  s.p90MS = d->percentile(0.90);
+  s.p99MS = d->percentile(0.99);
+  s.maxMS = d->maxMS;
+  s.bucketMS = d->bucketMS;
+  s.buckets = d->buckets;
+  return s;
+}
+
+//##################################################################################################
+void InputLatencyTracker::resetStats()
+{
+  std::fill(d->buckets.begin(), d->buckets.end(), 0);
+  d->samples = 0;
+  d->sumMS = 0.0;
+  d->maxMS = 0.0;
+}
+
+}
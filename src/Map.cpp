@@ -1,14 +1,47 @@
 #include "tp_maps_sdl/Map.h"
 #include "tp_maps_sdl/Vulkan.h"
+#include "tp_maps_sdl/GLGPUProfiler.h"
+#include "tp_maps_sdl/GLProgramBinaryCache.h"
+#include "tp_maps_sdl/GLProfileCache.h"
+#include "tp_maps_sdl/VulkanGPUProfiler.h"
+#include "tp_maps_sdl/VulkanStaticFrameCache.h"
+#include "tp_maps_sdl/InputLatency.h"
+#include "tp_maps_sdl/FramePacer.h"
+#include "tp_maps_sdl/WorkerPool.h"
+#include "tp_maps_sdl/Trace.h"
+#include "tp_maps_sdl/GLDamagePresenter.h"
+#include "tp_maps_sdl/MemoryPressure.h"
+#include "tp_maps_sdl/VulkanUploader.h"
+#include "tp_maps_sdl/FramebufferConfig.h"
 
 #include "tp_maps/MouseEvent.h"
 #include "tp_maps/KeyEvent.h"
 
-#include "tp_utils/TimeUtils.h"
 #include "tp_utils/DebugUtils.h"
 
+#include <algorithm>
+#include <atomic>
+
+#if defined(__GLIBC__)
+#  include <malloc.h>
+#endif
+
 namespace tp_maps_sdl
 {
+
+namespace
+{
+//##################################################################################################
+//! The framebuffer that was always requested before it could be configured.
+FramebufferConfig defaultFramebufferConfig(bool enableDepthBuffer)
+{
+  FramebufferConfig config;
+  config.depthBits = enableDepthBuffer?24:0;
+  config.stencilBits = enableDepthBuffer?8:0;
+  return config;
+}
+}
+
 //##################################################################################################
 struct Map::Private
 {
@@ -17,14 +50,31 @@ struct Map::Private
 
   glm::ivec2 mousePos{0,0};
 
-  int64_t animationTimeMS{0};
-
   bool paint{true};
   bool quitting{false};
 
+  StartupTimings startupTimings;
+  InputLatencyTracker inputLatency;
+  FramePacer framePacer;
+  MemoryPressure memoryPressure;
+
+  //! The highest TrimLevel requested by appEventWatch() as an int, -1 if none is pending.
+  std::atomic<int> pendingTrim{-1};
+  FramebufferConfig requestedFramebufferConfig;
+  FramebufferConfig framebufferConfig;
+  std::string tracePath;
+  std::unique_ptr<WorkerPool> workerPool{std::make_unique<WorkerPool>()};
+
 
   //-- OpenGL --------------------------------------------------------------------------------------
   SDL_GLContext context{nullptr};
+  std::unique_ptr<GLGPUProfiler> glGPUProfiler;
+  std::unique_ptr<GLProgramBinaryCache> programBinaryCache;
+  std::unique_ptr<GLDamagePresenter> glDamagePresenter;
+  DamageTracker damage;
+  std::vector<DamageRect> repaintRects;
+  std::vector<DamageRect> presentRects;
+  bool partialFrame{false};
 
 
   //-- Vulkan --------------------------------------------------------------------------------------
@@ -38,6 +88,12 @@ struct Map::Private
 
   }
 
+  //################################################################################################
+  static double timeMS()
+  {
+    return double(SDL_GetPerformanceCounter()) * 1000.0 / double(SDL_GetPerformanceFrequency());
+  }
+
   //################################################################################################
   SDL_Rect getActiveDisplayBounds()
   {
@@ -72,6 +128,95 @@ struct Map::Private
     return displayBounds;
   }
 
+  //################################################################################################
+  //! Release the resources owned by the map, the app adds handlers for its own caches.
+  /*!
+  The GL path owns no caches of its own, so there only the heap is trimmed. Pixel pools, atlases and
+  the like belong to the app which registers handlers for them.
+  */
+  void addMemoryPressureHandlers()
+  {
+    memoryPressure.addHandler("Vulkan staging ring", 100, [&](TrimLevel)
+    {
+      if(vulkan && vulkan->uploader())
+        return vulkan->uploader()->releaseStagingMemory();
+      return size_t(0);
+    });
+
+#if defined(__GLIBC__)
+    // Runs last so that memory freed by the other handlers is handed back to the OS.
+    memoryPressure.addHandler("Process heap", 1000, [](TrimLevel)
+    {
+      size_t before = MemoryPressure::residentBytes();
+      malloc_trim(0);
+      size_t after = MemoryPressure::residentBytes();
+      return (before>after)?before-after:size_t(0);
+    });
+#endif
+  }
+
+  //################################################################################################
+  //! Runs when the event is pushed, on Android that is the Java thread rather than the main thread.
+  /*!
+  The handlers submit to the Vulkan queue and free buffers the main thread is using, so this only
+  records the request and the trim happens on the main thread in update(). The events are still queued
+  and update() trims as soon as it polls them, before the next poll can block in the Android pause.
+  */
+  static int appEventWatch(void* userData, SDL_Event* event)
+  {
+    auto d = static_cast<Private*>(userData);
+    switch(event->type)
+    {
+      case SDL_APP_LOWMEMORY:
+        d->requestTrim(TrimLevel::Critical);
+        break;
+
+      case SDL_APP_WILLENTERBACKGROUND:
+        d->requestTrim(TrimLevel::Background);
+        break;
+
+      default:
+        break;
+    }
+    return 0;
+  }
+
+  //################################################################################################
+  //! Thread safe, keeps the most severe level until trimPending() runs.
+  void requestTrim(TrimLevel level)
+  {
+    int pending = pendingTrim.load();
+    while(pending<int(level) && !pendingTrim.compare_exchange_weak(pending, int(level)));
+  }
+
+  //################################################################################################
+  //! Call on the main thread.
+  void trimPending()
+  {
+    if(int level = pendingTrim.exchange(-1); level>=0)
+      memoryPressure.trim(TrimLevel(level));
+  }
+
+  //################################################################################################
+  static bool isInputEvent(uint32_t type)
+  {
+    switch(type)
+    {
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP:
+      case SDL_MOUSEMOTION:
+      case SDL_MOUSEWHEEL:
+      case SDL_KEYDOWN:
+      case SDL_KEYUP:
+      case SDL_TEXTINPUT:
+      case SDL_TEXTEDITING:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
   //################################################################################################
   void initGL(bool fullScreen, const std::string& title)
   {
@@ -80,14 +225,17 @@ struct Map::Private
     auto tryMakeWindow = [&](const auto& setWindowOps)
     {
       setWindowOps();
+      startupTimings.attempts++;
+
+      double start = timeMS();
 
 #if defined(TP_ANDROID) || defined(TP_IOS)
-      d->window = SDL_CreateWindow(title.c_str(),
-                                   s.x,
-                                   s.y,
-                                   s.w,
-                                   s.h,
-                                   SDL_WINDOW_OPENGL);
+      window = SDL_CreateWindow(title.c_str(),
+                                s.x,
+                                s.y,
+                                s.w,
+                                s.h,
+                                SDL_WINDOW_OPENGL);
 #else
       if(fullScreen)
       {
@@ -110,31 +258,75 @@ struct Map::Private
       }
 #endif
 
+      startupTimings.windowMS += timeMS() - start;
+
       if(!window)
         return;
 
+      start = timeMS();
       context = SDL_GL_CreateContext(window);
+      startupTimings.contextMS += timeMS() - start;
 
       if(!context)
       {
+        start = timeMS();
         SDL_DestroyWindow(window);
         window = nullptr;
+        startupTimings.windowMS += timeMS() - start;
       }
     };
 
+    //-- Build the list of profiles to try in order ------------------------------------------------
+    std::vector<std::pair<std::string, std::function<void()>>> profiles;
+    {
+      auto addProfile = [&](const std::string& name, const std::function<void()>& setWindowOps)
+      {
+        for(const auto& profile : profiles)
+          if(profile.first == name)
+            return;
+        profiles.emplace_back(name, setWindowOps);
+      };
+
 #if defined(TP_GLES2)
-    tryMakeWindow([&]{d->opsForGLES2();});
+      addProfile("GLES2", [&]{opsForGLES2();});
 #endif
 
 #if defined(TP_OSX)
-    if(!d->context)tryMakeWindow([&]{d->opsForGL4_1();});
+      addProfile("GL4_1", [&]{opsForGL4_1();});
 #endif
 
 #if !defined(TP_ANDROID) && !defined(TP_IOS)
-    if(!context)tryMakeWindow([&]{opsForGL3_3();});
-    if(!context)tryMakeWindow([&]{opsForGL2_1();});
+      addProfile("GL3_3", [&]{opsForGL3_3();});
+      addProfile("GL2_1", [&]{opsForGL2_1();});
 #endif
-    if(!context)tryMakeWindow([&]{opsForGLES2();});
+      addProfile("GLES2", [&]{opsForGLES2();});
+    }
+
+    //-- Try the profile that worked last time first -----------------------------------------------
+    GLProfileCache profileCache;
+    std::string profileName;
+    {
+      auto i = std::find_if(profiles.begin(), profiles.end(), [&](const auto& p){return p.first == profileCache.profile();});
+      if(i != profiles.end())
+      {
+        tryMakeWindow([&]{i->second(); profileCache.applyAttributes(framebufferConfigToString(requestedFramebufferConfig));});
+        if(context)
+        {
+          profileName = i->first;
+          startupTimings.cachedProfile = true;
+        }
+      }
+    }
+
+    for(const auto& profile : profiles)
+    {
+      if(context)
+        break;
+
+      tryMakeWindow(profile.second);
+      if(context)
+        profileName = profile.first;
+    }
 
     if(!window)
     {
@@ -148,9 +340,29 @@ struct Map::Private
       return;
     }
 
+    profileCache.store(profileName, framebufferConfigToString(requestedFramebufferConfig));
+    framebufferConfig = currentGLFramebufferConfig();
+    framePacer.setWindow(window);
+
     SDL_GL_SetSwapInterval(-1);
 
-    q->initializeGL();
+    glGPUProfiler = std::make_unique<GLGPUProfiler>();
+    programBinaryCache = std::make_unique<GLProgramBinaryCache>(q->shaderProfile());
+    glDamagePresenter = std::make_unique<GLDamagePresenter>(window);
+
+    {
+      double start = timeMS();
+      q->initializeGL();
+      startupTimings.initializeGLMS = timeMS() - start;
+    }
+
+    tpDebug() << "OpenGL startup using " << profileName << (startupTimings.cachedProfile?" (cached)":"")
+              << " attempts: " << startupTimings.attempts
+              << " SDL init: " << startupTimings.sdlInitMS << "ms"
+              << " window: " << startupTimings.windowMS << "ms"
+              << " context: " << startupTimings.contextMS << "ms"
+              << " initializeGL: " << startupTimings.initializeGLMS << "ms"
+              << " framebuffer: " << framebufferConfigToString(framebufferConfig);
   }
 
   //################################################################################################
@@ -194,7 +406,8 @@ struct Map::Private
       if(!window)
         return;
 
-      vulkan = std::make_unique<Vulkan>(window, title);
+      vulkan = std::make_unique<Vulkan>(window, title, vulkanAttachmentConfig(requestedFramebufferConfig));
+      framebufferConfig = vulkanFramebufferConfig(*vulkan);
     };
 
     tryMakeWindow([&]{opsForVulkan();});
@@ -205,6 +418,8 @@ struct Map::Private
   //################################################################################################
   void update()
   {
+    TraceScope traceScope("processEvents", "frame");
+
     SDL_Event event;
     while(SDL_PollEvent(&event))
     {
@@ -216,6 +431,13 @@ struct Map::Private
           break;
         }
 
+        case SDL_APP_LOWMEMORY: //------------------------------------------------------------------
+        case SDL_APP_WILLENTERBACKGROUND: //--------------------------------------------------------
+        {
+          trimPending();
+          break;
+        }
+
         case SDL_MOUSEBUTTONDOWN: //----------------------------------------------------------------
         {
           tp_maps::MouseEvent e(tp_maps::MouseEventType::Press);
@@ -226,6 +448,7 @@ struct Map::Private
             case SDL_BUTTON_RIGHT: e.button = tp_maps::Button::RightButton; break;
             default:               e.button = tp_maps::Button::NoButton;    break;
           }
+          TraceScope handlerScope("mouseEvent", "input");
           q->mouseEvent(e);
           break;
         }
@@ -240,6 +463,7 @@ struct Map::Private
             case SDL_BUTTON_RIGHT: e.button = tp_maps::Button::RightButton; break;
             default:               e.button = tp_maps::Button::NoButton;    break;
           }
+          TraceScope handlerScope("mouseEvent", "input");
           q->mouseEvent(e);
           break;
         }
@@ -250,6 +474,7 @@ struct Map::Private
           mousePos = {event.motion.x, event.motion.y};
           e.pos = mousePos;
           e.posDelta = {event.motion.xrel, event.motion.yrel};
+          TraceScope handlerScope("mouseEvent", "input");
           q->mouseEvent(e);
           break;
         }
@@ -259,6 +484,7 @@ struct Map::Private
           tp_maps::MouseEvent e(tp_maps::MouseEventType::Wheel);
           e.pos = mousePos;
           e.delta = event.wheel.y;
+          TraceScope handlerScope("mouseEvent", "input");
           q->mouseEvent(e);
           break;
         }
@@ -268,20 +494,33 @@ struct Map::Private
           if (event.window.event == SDL_WINDOWEVENT_RESIZED)
           {
             q->resizeGL(event.window.data1, event.window.data2);
+            damage.damageAll();
             paint = true;
           }
           else if (event.window.event == SDL_WINDOWEVENT_SHOWN || event.window.event == SDL_WINDOWEVENT_EXPOSED)
           {
+            damage.damageAll();
             paint = true;
           }
+          else if (event.window.event == SDL_WINDOWEVENT_MOVED)
+          {
+            framePacer.displayChanged();
+          }
 
           break;
         }
 
+        case SDL_DISPLAYEVENT: //-------------------------------------------------------------------
+        {
+          framePacer.displayChanged();
+          break;
+        }
+
         case SDL_KEYDOWN: //------------------------------------------------------------------------
         {
           tp_maps::KeyEvent e(tp_maps::KeyEventType::Press);
           e.scancode = event.key.keysym.scancode;
+          TraceScope handlerScope("keyEvent", "input");
           q->keyEvent(e);
           break;
         }
@@ -293,6 +532,7 @@ struct Map::Private
 
           tp_maps::KeyEvent e(tp_maps::KeyEventType::Release);
           e.scancode = event.key.keysym.scancode;
+          TraceScope handlerScope("keyEvent", "input");
           q->keyEvent(e);
           break;
         }
@@ -301,6 +541,7 @@ struct Map::Private
         {
           tp_maps::TextInputEvent e;
           e.text = event.text.text;
+          TraceScope handlerScope("textInputEvent", "input");
           q->textInputEvent(e);
           break;
         }
@@ -311,6 +552,7 @@ struct Map::Private
           e.text           = event.edit.text;
           e.cursor         = event.edit.start;
           e.selectionLength = event.edit.length;
+          TraceScope handlerScope("textEditingEvent", "input");
           q->textEditingEvent(e);
           break;
         }
@@ -320,21 +562,76 @@ struct Map::Private
           break;
         }
       }
+
+      // Only events that lead to a repaint have a photon to measure, the others would be charged all the
+      // idle time until something else repaints.
+      if(paint && isInputEvent(event.type))
+        inputLatency.inputEvent(event.common.timestamp);
     }
 
-    if(const auto t = tp_utils::currentTimeMS(); animationTimeMS<t)
+    trimPending();
+    memoryPressure.checkBudget();
+
+    // Results from the worker pool, limited to a budget so they can't blow the frame.
+    if(workerPool)
+      workerPool->deliverCompleted();
+
+    // Animate once per frame with the scheduled time of the frame that it feeds.
+    if(framePacer.beginFrame())
     {
-      animationTimeMS = t+8;
+      TraceScope animateScope("animate", "frame");
       q->makeCurrent();
-      q->animate(double(t));
+      q->animate(framePacer.frameTimeMS());
     }
 
-    if(paint)
+    // Without a context, for example under the dummy video driver, events are still processed.
+    if(paint && context)
     {
       paint = false;
       q->makeCurrent();
-      q->paintGL();
-      SDL_GL_SwapWindow(window);
+      inputLatency.frameStarted();
+
+      // Only redraw and present the damaged parts of the window if the back buffer age is known.
+      partialFrame=false;
+      if(glDamagePresenter && glDamagePresenter->isSupported())
+      {
+        int w{0};
+        int h{0};
+        SDL_GL_GetDrawableSize(window, &w, &h);
+        partialFrame = damage.frameDamage(glDamagePresenter->bufferAge(), w, h, repaintRects, presentRects);
+        if(partialFrame)
+          glDamagePresenter->beginFrame(repaintRects);
+      }
+
+      if(glGPUProfiler)
+      {
+        glGPUProfiler->beginFrame();
+        glGPUProfiler->beginScope("paintGL");
+      }
+
+      {
+        TraceScope paintScope("paintGL", "frame");
+        q->paintGL();
+      }
+
+      if(glGPUProfiler)
+      {
+        glGPUProfiler->endScope();
+        glGPUProfiler->endFrame();
+      }
+
+      {
+        TraceScope swapScope("swap", "frame");
+        if(partialFrame)
+        {
+          glDamagePresenter->endFrame();
+          glDamagePresenter->swap(presentRects);
+        }
+        else
+          SDL_GL_SwapWindow(window);
+      }
+      damage.endFrame();
+      inputLatency.framePresented();
     }
   }
 
@@ -345,9 +642,7 @@ struct Map::Private
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    setGLFramebufferAttributes(requestedFramebufferConfig, true);
 
     q->setShaderProfile(tp_maps::ShaderProfile::GLSL_410);
   }
@@ -359,9 +654,7 @@ struct Map::Private
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    setGLFramebufferAttributes(requestedFramebufferConfig, true);
 
     q->setShaderProfile(tp_maps::ShaderProfile::GLSL_330);
   }
@@ -373,9 +666,8 @@ struct Map::Private
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
 
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    // Multisampled default framebuffers are unreliable on the drivers that fall back to these profiles.
+    setGLFramebufferAttributes(requestedFramebufferConfig, false);
 
     q->setShaderProfile(tp_maps::ShaderProfile::GLSL_120);
   }
@@ -387,9 +679,7 @@ struct Map::Private
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
 
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    setGLFramebufferAttributes(requestedFramebufferConfig, false);
 
     q->setShaderProfile(tp_maps::ShaderProfile::GLSL_100_ES);
   }
@@ -397,25 +687,46 @@ struct Map::Private
   //################################################################################################
   void opsForVulkan()
   {
-
-#warning set this correctly
-    q->setShaderProfile(tp_maps::ShaderProfile::GLSL_100_ES);
+    // Vulkan GLSL is compiled to SPIR-V, see VulkanShaderCache.
+    q->setShaderProfile(tp_maps::ShaderProfile::GLSL_450);
   }
 };
 
 //##################################################################################################
 Map::Map(bool enableDepthBuffer, bool fullScreen, const std::string& title):
-  tp_maps::Map(enableDepthBuffer),
+  Map(defaultFramebufferConfig(enableDepthBuffer), fullScreen, title)
+{
+
+}
+
+//##################################################################################################
+Map::Map(const FramebufferConfig& framebufferConfig, bool fullScreen, const std::string& title):
+  tp_maps::Map(framebufferConfig.depthBits>0),
   d(new Private(this))
 {
+  d->requestedFramebufferConfig = framebufferConfig;
+
+  double start = d->timeMS();
   if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_EVENTS) != 0)
   {
     tpWarning() << "Failed to initialize SDL: " << SDL_GetError();
     return;
   }
+  d->startupTimings.sdlInitMS = d->timeMS() - start;
+
+  d->addMemoryPressureHandlers();
+  SDL_AddEventWatch(Private::appEventWatch, d);
+
+  if(const char* tracePath = SDL_getenv("TP_MAPS_SDL_TRACE"); tracePath && *tracePath)
+  {
+    d->tracePath = tracePath;
+    setTraceThreadName("Main");
+    setTraceEnabled(true);
+  }
 
   d->initGL(fullScreen, title);
 
+  if(d->context)
   {
     int w{0};
     int h{0};
@@ -427,12 +738,27 @@ Map::Map(bool enableDepthBuffer, bool fullScreen, const std::string& title):
 //##################################################################################################
 Map::~Map()
 {
+  // Wait for running jobs before anything they might reference is destroyed.
+  d->workerPool.reset();
+
   preDelete();
 
+  makeCurrent();
+  d->glGPUProfiler.reset();
+  d->glDamagePresenter.reset();
+  d->programBinaryCache.reset();
+
+  SDL_DelEventWatch(Private::appEventWatch, d);
   SDL_GL_DeleteContext(d->context);
   SDL_DestroyWindow(d->window);
   SDL_Quit();
 
+  if(!d->tracePath.empty())
+  {
+    setTraceEnabled(false);
+    saveTrace(d->tracePath);
+  }
+
   delete d;
 }
 
@@ -442,7 +768,7 @@ void Map::exec()
   while(!d->quitting)
   {
     processEvents();
-    SDL_Delay(16);
+    d->framePacer.waitForNextFrame();
   }
 }
 
@@ -452,6 +778,50 @@ void Map::processEvents()
   d->update();
 }
 
+//##################################################################################################
+GPUProfiler* Map::gpuProfiler() const
+{
+  if(d->vulkan)
+    return d->vulkan->gpuProfiler();
+  return d->glGPUProfiler.get();
+}
+
+//##################################################################################################
+const StartupTimings& Map::startupTimings() const
+{
+  return d->startupTimings;
+}
+
+//##################################################################################################
+const FramebufferConfig& Map::framebufferConfig() const
+{
+  return d->framebufferConfig;
+}
+
+//##################################################################################################
+InputLatencyTracker* Map::inputLatency() const
+{
+  return &d->inputLatency;
+}
+
+//##################################################################################################
+FramePacer* Map::framePacer() const
+{
+  return &d->framePacer;
+}
+
+//##################################################################################################
+WorkerPool* Map::workerPool() const
+{
+  return d->workerPool.get();
+}
+
+//##################################################################################################
+GLProgramBinaryCache* Map::programBinaryCache() const
+{
+  return d->programBinaryCache.get();
+}
+
 //##################################################################################################
 void Map::makeCurrent()
 {
@@ -463,12 +833,45 @@ void Map::update(tp_maps::RenderFromStage renderFromStage)
 {
   tp_maps::Map::update(renderFromStage);
   d->paint = true;
+
+  // RenderFromStage names tp_maps render passes, not the cache's stage indices, and nothing maps one to
+  // the other yet, so any update re-records everything. Callers that record stages into the cache
+  // themselves can call invalidateFrom() with their own stage index.
+  if(d->vulkan)
+    if(auto staticFrameCache = d->vulkan->staticFrameCache(); staticFrameCache)
+      staticFrameCache->invalidateAll();
+}
+
+//##################################################################################################
+size_t Map::trimMemory(TrimLevel level)
+{
+  return d->memoryPressure.trim(level);
+}
+
+//##################################################################################################
+MemoryPressure* Map::memoryPressure() const
+{
+  return &d->memoryPressure;
+}
+
+//##################################################################################################
+void Map::addDamage(const DamageRect& rect)
+{
+  d->damage.addDamage(rect);
+}
+
+//##################################################################################################
+void Map::scissorToDamage()
+{
+  if(d->partialFrame && d->glDamagePresenter)
+    d->glDamagePresenter->scissorDefaultFramebuffer();
 }
 
 //##################################################################################################
 void Map::callAsync(const std::function<void()>& callback)
 {
-#warning implement
+  if(d->workerPool)
+    d->workerPool->post(callback);
 }
 
 //##################################################################################################
@@ -0,0 +1,219 @@
+#include "tp_maps_sdl/MemoryPressure.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+#if defined(__linux__)
+#  include <unistd.h>
+#elif defined(__APPLE__)
+#  include <mach/mach.h>
+#endif
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//! The most the check interval grows to while trims fail to bring usage under budget.
+constexpr double maxBackOff = 32.0;
+}
+
+//##################################################################################################
+const char* trimLevelToString(TrimLevel level)
+{
+  switch(level)
+  {
+    case TrimLevel::Background: return "Background";
+    case TrimLevel::Moderate:   return "Moderate";
+    case TrimLevel::Critical:   return "Critical";
+  }
+  return "Moderate";
+}
+
+//##################################################################################################
+struct MemoryPressure::Private
+{
+  //################################################################################################
+  struct HandlerDetails
+  {
+    size_t id;
+    std::string name;
+    int priority;
+    Handler handler;
+  };
+
+  std::mutex mutex;
+  std::vector<HandlerDetails> handlers;
+  size_t nextID{1};
+
+  size_t rssBudget{0};
+  size_t vramBudget{0};
+  float lowFraction{0.9f};
+  UsageFunction vramUsage;
+
+  std::chrono::steady_clock::time_point lastCheck{std::chrono::steady_clock::now()};
+
+  //! Set when a check finds usage over budget, cleared once usage is below the low target.
+  bool underPressure{false};
+  TrimLevel nextLevel{TrimLevel::Moderate};
+  double backOff{1.0};
+
+  std::atomic<size_t> releasedBytes{0};
+  std::atomic<bool> trimming{false};
+
+  //################################################################################################
+  bool overBudget(double fraction) const
+  {
+    if(rssBudget && double(residentBytes()) > double(rssBudget)*fraction)
+      return true;
+
+    if(vramBudget && vramUsage && double(vramUsage()) > double(vramBudget)*fraction)
+      return true;
+
+    return false;
+  }
+};
+
+//##################################################################################################
+MemoryPressure::MemoryPressure():
+  d(new Private())
+{
+
+}
+
+//##################################################################################################
+MemoryPressure::~MemoryPressure()
+{
+  delete d;
+}
+
+//##################################################################################################
+size_t MemoryPressure::addHandler(const std::string& name, int priority, const Handler& handler)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  size_t id = d->nextID++;
+  d->handlers.push_back({id, name, priority, handler});
+  std::stable_sort(d->handlers.begin(), d->handlers.end(), [](const auto& a, const auto& b){return a.priority<b.priority;});
+  return id;
+}
+
+//##################################################################################################
+void MemoryPressure::removeHandler(size_t id)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->handlers.erase(std::remove_if(d->handlers.begin(), d->handlers.end(), [&](const auto& h){return h.id==id;}), d->handlers.end());
+}
+
+//##################################################################################################
+size_t MemoryPressure::trim(TrimLevel level)
+{
+  // Handlers may trigger events that would trim again, or the OS may ask from another thread.
+  if(d->trimming.exchange(true))
+    return 0;
+  TP_CLEANUP([&]{d->trimming = false;});
+
+  std::vector<Private::HandlerDetails> handlers;
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    handlers = d->handlers;
+  }
+
+  size_t total=0;
+  for(const auto& h : handlers)
+  {
+    size_t released = h.handler(level);
+    if(released)
+      tpDebug() << "MemoryPressure: " << h.name << " released " << released/1024 << "KB";
+    total += released;
+  }
+
+  d->releasedBytes += total;
+  tpDebug() << "MemoryPressure: Trimmed at level " << trimLevelToString(level) << " released " << total/1024 << "KB";
+  return total;
+}
+
+//##################################################################################################
+void MemoryPressure::setBudget(size_t rssBytes, size_t vramBytes)
+{
+  d->rssBudget = rssBytes;
+  d->vramBudget = vramBytes;
+}
+
+//##################################################################################################
+void MemoryPressure::setLowFraction(float lowFraction)
+{
+  d->lowFraction = std::clamp(lowFraction, 0.0f, 1.0f);
+}
+
+//##################################################################################################
+void MemoryPressure::setVRAMUsageFunction(const UsageFunction& vramUsage)
+{
+  d->vramUsage = vramUsage;
+}
+
+//##################################################################################################
+size_t MemoryPressure::checkBudget(double intervalMS)
+{
+  if(!d->rssBudget && !d->vramBudget)
+    return 0;
+
+  auto now = std::chrono::steady_clock::now();
+  if(std::chrono::duration<double, std::milli>(now-d->lastCheck).count()<intervalMS*d->backOff)
+    return 0;
+  d->lastCheck = now;
+
+  // Once over budget keep trimming until usage is comfortably below it, not just under.
+  if(!d->overBudget(d->underPressure?double(d->lowFraction):1.0))
+  {
+    d->underPressure = false;
+    d->nextLevel = TrimLevel::Moderate;
+    d->backOff = 1.0;
+    return 0;
+  }
+
+  // Freed memory is rarely returned to the OS straight away, so only escalate to a critical trim if a
+  // later check is still over. Back off while trims are not helping rather than trimming every check.
+  size_t released = trim(d->nextLevel);
+  if(d->underPressure)
+    d->backOff = std::min(d->backOff*2.0, maxBackOff);
+  d->underPressure = true;
+  d->nextLevel = TrimLevel::Critical;
+  return released;
+}
+
+//##################################################################################################
+size_t MemoryPressure::residentBytes()
+{
+#if defined(__linux__)
+  size_t pages=0;
+  size_t resident=0;
+  if(FILE* f = fopen("/proc/self/statm", "r"); f)
+  {
+    if(fscanf(f, "%zu %zu", &pages, &resident) != 2)
+      resident = 0;
+    fclose(f);
+  }
+  return resident * size_t(sysconf(_SC_PAGESIZE));
+#elif defined(__APPLE__)
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+    return 0;
+  return size_t(info.resident_size);
+#else
+  return 0;
+#endif
+}
+
+//##################################################################################################
+size_t MemoryPressure::releasedBytes() const
+{
+  return d->releasedBytes;
+}
+
+}
@@ -0,0 +1,347 @@
+#include "tp_maps_sdl/TextureAtlas.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct TextureAtlas::Private
+{
+  TextureAtlasParams params;
+
+  //################################################################################################
+  //! A horizontal segment of the skyline, everything below y is considered used.
+  struct Segment
+  {
+    size_t x;
+    size_t y;
+    size_t width;
+  };
+
+  //################################################################################################
+  struct Page
+  {
+    tp_image_utils::ColorMap image;
+    std::vector<Segment> skyline;
+    size_t usedArea{0};
+    size_t freedArea{0};
+  };
+
+  //################################################################################################
+  struct Item
+  {
+    tp_image_utils::ColorMap image;
+    TextureAtlasEntry entry;
+  };
+
+  std::vector<Page> pages;
+  std::unordered_map<std::string, Item> items;
+  std::set<size_t> dirtyPages;
+
+  //################################################################################################
+  Private(const TextureAtlasParams& params_):
+    params(params_)
+  {
+    params.pageWidth  = std::max(size_t(1), params.pageWidth);
+    params.pageHeight = std::max(size_t(1), params.pageHeight);
+    params.maxPages   = std::max(size_t(1), params.maxPages);
+  }
+
+  //################################################################################################
+  void addPage()
+  {
+    auto& page = pages.emplace_back();
+    page.image = tp_image_utils::ColorMap(params.pageWidth, params.pageHeight);
+    std::fill(page.image.data(), page.image.data()+params.pageWidth*params.pageHeight, TPPixel{0, 0, 0, 0});
+    page.skyline.push_back({0, 0, params.pageWidth});
+  }
+
+  //################################################################################################
+  //! Find the y that a w*h rectangle would sit at if its left edge was on segment index.
+  bool fit(const Page& page, size_t index, size_t w, size_t h, size_t& y) const
+  {
+    const auto& skyline = page.skyline;
+    size_t x = skyline[index].x;
+    if(x+w > params.pageWidth)
+      return false;
+
+    y = skyline[index].y;
+    for(size_t widthLeft=w; widthLeft>0; index++)
+    {
+      y = std::max(y, skyline[index].y);
+      if(y+h > params.pageHeight)
+        return false;
+      widthLeft -= std::min(widthLeft, skyline[index].width);
+    }
+
+    return true;
+  }
+
+  //################################################################################################
+  //! Bottom left rule, pick the position with the lowest top edge then the leftmost.
+  bool findPosition(const Page& page, size_t w, size_t h, size_t& bestIndex, size_t& bestY) const
+  {
+    bool found=false;
+    size_t bestTop=0;
+    for(size_t i=0; i<page.skyline.size(); i++)
+    {
+      size_t y=0;
+      if(fit(page, i, w, h, y) && (!found || y+h<bestTop))
+      {
+        found = true;
+        bestIndex = i;
+        bestY = y;
+        bestTop = y+h;
+      }
+    }
+    return found;
+  }
+
+  //################################################################################################
+  void addSegment(Page& page, size_t index, size_t y, size_t w, size_t h)
+  {
+    auto& skyline = page.skyline;
+    skyline.insert(skyline.begin()+std::ptrdiff_t(index), Segment{skyline[index].x, y+h, w});
+
+    // Trim or remove the segments that are now underneath the new one.
+    for(size_t i=index+1; i<skyline.size();)
+    {
+      size_t previousEnd = skyline[i-1].x + skyline[i-1].width;
+      if(skyline[i].x >= previousEnd)
+        break;
+
+      size_t shrink = previousEnd - skyline[i].x;
+      if(skyline[i].width <= shrink)
+      {
+        skyline.erase(skyline.begin()+std::ptrdiff_t(i));
+        continue;
+      }
+
+      skyline[i].x += shrink;
+      skyline[i].width -= shrink;
+      break;
+    }
+
+    // Merge neighbours at the same height.
+    for(size_t i=1; i<skyline.size();)
+    {
+      if(skyline[i-1].y == skyline[i].y)
+      {
+        skyline[i-1].width += skyline[i].width;
+        skyline.erase(skyline.begin()+std::ptrdiff_t(i));
+      }
+      else
+        i++;
+    }
+  }
+
+  //################################################################################################
+  //! Copy the image into the page, extruding its edge pixels out into the padding.
+  void blit(Page& page, const tp_image_utils::ColorMap& image, size_t px, size_t py)
+  {
+    size_t w = image.width();
+    size_t h = image.height();
+    size_t p = params.padding;
+
+    const TPPixel* src = image.constData();
+    TPPixel* dst = page.image.data();
+
+    for(size_t y=0; y<h+2*p; y++)
+    {
+      size_t sy = std::min(h-1, (y>p)?y-p:0);
+      TPPixel* d = dst + (py+y)*params.pageWidth + px;
+      const TPPixel* s = src + sy*w;
+      for(size_t x=0; x<w+2*p; x++)
+        d[x] = s[std::min(w-1, (x>p)?x-p:0)];
+    }
+  }
+
+  //################################################################################################
+  //! Find space for the image and copy it into a page, the caller stores entry with the image.
+  bool place(const std::string& name, const tp_image_utils::ColorMap& image, TextureAtlasEntry& entry)
+  {
+    size_t w = image.width()  + 2*params.padding;
+    size_t h = image.height() + 2*params.padding;
+
+    if(image.width()<1 || image.height()<1)
+      return false;
+
+    if(w>params.pageWidth || h>params.pageHeight)
+    {
+      tpWarning() << "TextureAtlas: Image too big for atlas: " << name;
+      return false;
+    }
+
+    size_t pageIndex=0;
+    size_t segmentIndex=0;
+    size_t y=0;
+    for(; pageIndex<pages.size(); pageIndex++)
+      if(findPosition(pages[pageIndex], w, h, segmentIndex, y))
+        break;
+
+    if(pageIndex == pages.size())
+    {
+      if(pages.size() >= params.maxPages)
+        return false;
+
+      addPage();
+      if(!findPosition(pages.back(), w, h, segmentIndex, y))
+        return false;
+    }
+
+    auto& page = pages[pageIndex];
+    size_t x = page.skyline[segmentIndex].x;
+    addSegment(page, segmentIndex, y, w, h);
+    page.usedArea += w*h;
+
+    blit(page, image, x, y);
+    dirtyPages.insert(pageIndex);
+
+    entry.page   = pageIndex;
+    entry.x      = x + params.padding;
+    entry.y      = y + params.padding;
+    entry.width  = image.width();
+    entry.height = image.height();
+    entry.uvMin  = {float(entry.x) / float(params.pageWidth), float(entry.y) / float(params.pageHeight)};
+    entry.uvMax  = {float(entry.x + entry.width) / float(params.pageWidth), float(entry.y + entry.height) / float(params.pageHeight)};
+
+    return true;
+  }
+};
+
+//##################################################################################################
+TextureAtlas::TextureAtlas(const TextureAtlasParams& params):
+  d(new Private(params))
+{
+
+}
+
+//##################################################################################################
+TextureAtlas::~TextureAtlas()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool TextureAtlas::insert(const std::string& name, const tp_image_utils::ColorMap& image)
+{
+  // Place the new image before removing the old one so that a replace that fails keeps the old entry.
+  TextureAtlasEntry entry;
+  if(!d->place(name, image, entry))
+    return false;
+
+  remove(name);
+  auto& item = d->items[name];
+  item.image = image;
+  item.entry = entry;
+  return true;
+}
+
+//##################################################################################################
+bool TextureAtlas::insertResource(const std::string& path)
+{
+  return insert(path, loadTextureFromResource(path));
+}
+
+//##################################################################################################
+std::vector<std::string> TextureAtlas::insert(const std::vector<std::pair<std::string, tp_image_utils::ColorMap>>& images)
+{
+  std::vector<const std::pair<std::string, tp_image_utils::ColorMap>*> sorted;
+  sorted.reserve(images.size());
+  for(const auto& image : images)
+    sorted.push_back(&image);
+
+  std::stable_sort(sorted.begin(), sorted.end(), [](auto a, auto b)
+  {
+    return a->second.height() > b->second.height();
+  });
+
+  std::vector<std::string> failed;
+  for(auto image : sorted)
+    if(!insert(image->first, image->second))
+      failed.push_back(image->first);
+
+  return failed;
+}
+
+//##################################################################################################
+void TextureAtlas::remove(const std::string& name)
+{
+  auto i = d->items.find(name);
+  if(i == d->items.end())
+    return;
+
+  const auto& entry = i->second.entry;
+  d->pages[entry.page].freedArea += (entry.width+2*d->params.padding) * (entry.height+2*d->params.padding);
+  d->items.erase(i);
+}
+
+//##################################################################################################
+const TextureAtlasEntry* TextureAtlas::entry(const std::string& name) const
+{
+  auto i = d->items.find(name);
+  return (i != d->items.end())?&i->second.entry:nullptr;
+}
+
+//##################################################################################################
+size_t TextureAtlas::pageCount() const
+{
+  return d->pages.size();
+}
+
+//##################################################################################################
+const tp_image_utils::ColorMap& TextureAtlas::page(size_t index) const
+{
+  return d->pages.at(index).image;
+}
+
+//##################################################################################################
+std::vector<size_t> TextureAtlas::takeDirtyPages()
+{
+  std::vector<size_t> result(d->dirtyPages.begin(), d->dirtyPages.end());
+  d->dirtyPages.clear();
+  return result;
+}
+
+//##################################################################################################
+float TextureAtlas::fragmentation() const
+{
+  size_t used=0;
+  size_t freed=0;
+  for(const auto& page : d->pages)
+  {
+    used += page.usedArea;
+    freed += page.freedArea;
+  }
+
+  return (used>0)?float(freed)/float(used):0.0f;
+}
+
+//##################################################################################################
+void TextureAtlas::defragment()
+{
+  std::vector<std::pair<std::string, tp_image_utils::ColorMap>> images;
+  images.reserve(d->items.size());
+  for(auto& i : d->items)
+    images.emplace_back(i.first, std::move(i.second.image));
+
+  size_t previousPageCount = d->pages.size();
+  d->items.clear();
+  d->pages.clear();
+
+  auto failed = insert(images);
+  for(const auto& name : failed)
+    tpWarning() << "TextureAtlas: Failed to repack: " << name;
+
+  // Pages that are no longer used are reported too, with indices >= pageCount(), so that the caller can
+  // release them.
+  for(size_t i=0; i<std::max(previousPageCount, d->pages.size()); i++)
+    d->dirtyPages.insert(i);
+}
+
+}
@@ -0,0 +1,754 @@
+#include "tp_maps_sdl/TextureCompression.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//##################################################################################################
+//! 16 pixels in row major order, row 0 is the first row in memory.
+struct Block
+{
+  uint8_t p[16][4];
+};
+
+//##################################################################################################
+void fetchBlock(const tp_image_utils::ColorMap& image, size_t bx, size_t by, Block& block)
+{
+  size_t w = image.width();
+  size_t h = image.height();
+  const TPPixel* data = image.constData();
+
+  // Pad partial blocks by repeating the edge pixels.
+  for(size_t y=0; y<4; y++)
+  {
+    const TPPixel* row = data + std::min(by*4+y, h-1)*w;
+    for(size_t x=0; x<4; x++)
+    {
+      const TPPixel& c = row[std::min(bx*4+x, w-1)];
+      uint8_t* p = block.p[y*4+x];
+      p[0] = c.r;
+      p[1] = c.g;
+      p[2] = c.b;
+      p[3] = c.a;
+    }
+  }
+}
+
+//##################################################################################################
+int colorDistance(const uint8_t* a, const int* b)
+{
+  int dr = int(a[0])-b[0];
+  int dg = int(a[1])-b[1];
+  int db = int(a[2])-b[2];
+  return dr*dr + dg*dg + db*db;
+}
+
+//-- BC1 / BC3 -------------------------------------------------------------------------------------
+
+//##################################################################################################
+uint16_t to565(const float* c)
+{
+  auto q = [](float v, int max){return uint16_t(std::clamp(int(v*float(max)/255.0f + 0.5f), 0, max));};
+  return uint16_t(q(c[0], 31)<<11 | q(c[1], 63)<<5 | q(c[2], 31));
+}
+
+//##################################################################################################
+void from565(uint16_t c, int* out)
+{
+  int r = (c>>11) & 31;
+  int g = (c>>5)  & 63;
+  int b =  c      & 31;
+  out[0] = (r<<3) | (r>>2);
+  out[1] = (g<<2) | (g>>4);
+  out[2] = (b<<3) | (b>>2);
+}
+
+//##################################################################################################
+//! Fit the endpoints along the principal axis of the block's colors.
+void encodeBC1Color(const Block& block, uint8_t* out)
+{
+  float mean[3] = {0, 0, 0};
+  for(const auto& p : block.p)
+    for(int c=0; c<3; c++)
+      mean[c] += float(p[c]);
+  for(float& m : mean)
+    m /= 16.0f;
+
+  float cov[6] = {0, 0, 0, 0, 0, 0};
+  for(const auto& p : block.p)
+  {
+    float r = float(p[0])-mean[0];
+    float g = float(p[1])-mean[1];
+    float b = float(p[2])-mean[2];
+    cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+    cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+  }
+
+  // A few rounds of power iteration are enough to find the dominant axis.
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for(int i=0; i<4; i++)
+  {
+    float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+    float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+    float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+    float m = std::max({std::fabs(x), std::fabs(y), std::fabs(z)});
+    if(m<1e-6f)
+      break;
+    axis[0] = x/m;
+    axis[1] = y/m;
+    axis[2] = z/m;
+  }
+
+  float minT=0.0f;
+  float maxT=0.0f;
+  for(const auto& p : block.p)
+  {
+    float t = (float(p[0])-mean[0])*axis[0] + (float(p[1])-mean[1])*axis[1] + (float(p[2])-mean[2])*axis[2];
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+
+  float len2 = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+  float c0[3];
+  float c1[3];
+  for(int c=0; c<3; c++)
+  {
+    c0[c] = mean[c] + axis[c]*maxT/len2;
+    c1[c] = mean[c] + axis[c]*minT/len2;
+  }
+
+  uint16_t e0 = to565(c0);
+  uint16_t e1 = to565(c1);
+
+  // e0>e1 selects the four color mode.
+  if(e0<e1)
+    std::swap(e0, e1);
+
+  out[0] = uint8_t(e0);
+  out[1] = uint8_t(e0>>8);
+  out[2] = uint8_t(e1);
+  out[3] = uint8_t(e1>>8);
+
+  uint32_t indices=0;
+  if(e0!=e1)
+  {
+    int palette[4][3];
+    from565(e0, palette[0]);
+    from565(e1, palette[1]);
+    for(int c=0; c<3; c++)
+    {
+      palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+    }
+
+    for(int i=0; i<16; i++)
+    {
+      uint32_t best=0;
+      int bestError=colorDistance(block.p[i], palette[0]);
+      for(uint32_t j=1; j<4; j++)
+      {
+        int error = colorDistance(block.p[i], palette[j]);
+        if(error<bestError)
+        {
+          bestError = error;
+          best = j;
+        }
+      }
+      indices |= best << (i*2);
+    }
+  }
+
+  out[4] = uint8_t(indices);
+  out[5] = uint8_t(indices>>8);
+  out[6] = uint8_t(indices>>16);
+  out[7] = uint8_t(indices>>24);
+}
+
+//##################################################################################################
+void encodeBC4Alpha(const Block& block, uint8_t* out)
+{
+  uint8_t a0=0;
+  uint8_t a1=255;
+  for(const auto& p : block.p)
+  {
+    a0 = std::max(a0, p[3]);
+    a1 = std::min(a1, p[3]);
+  }
+
+  out[0] = a0;
+  out[1] = a1;
+
+  uint64_t indices=0;
+  if(a0!=a1)
+  {
+    // a0>a1 selects the eight value mode.
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    for(int i=1; i<7; i++)
+      palette[i+1] = ((7-i)*a0 + i*a1) / 7;
+
+    for(int i=0; i<16; i++)
+    {
+      int a = block.p[i][3];
+      uint64_t best=0;
+      int bestError=std::abs(a-palette[0]);
+      for(uint64_t j=1; j<8; j++)
+      {
+        int error = std::abs(a-palette[j]);
+        if(error<bestError)
+        {
+          bestError = error;
+          best = j;
+        }
+      }
+      indices |= best << (i*3);
+    }
+  }
+
+  for(int i=0; i<6; i++)
+    out[2+i] = uint8_t(indices>>(i*8));
+}
+
+//-- ETC1 / ETC2 / EAC -----------------------------------------------------------------------------
+
+const int etcModifiers[8][2] =
+{
+  {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+
+const int eacModifiers[16][8] =
+{
+  {-3, -6,  -9, -15, 2, 5, 8, 14},
+  {-3, -7, -10, -13, 2, 6, 9, 12},
+  {-2, -5,  -8, -13, 1, 4, 7, 12},
+  {-2, -4,  -6, -13, 1, 3, 5, 12},
+  {-3, -6,  -8, -12, 2, 5, 7, 11},
+  {-3, -7,  -9, -11, 2, 6, 8, 10},
+  {-4, -7,  -8, -11, 3, 6, 7, 10},
+  {-3, -5,  -8, -11, 2, 4, 7, 10},
+  {-2, -6,  -8, -10, 1, 5, 7,  9},
+  {-2, -5,  -8, -10, 1, 4, 7,  9},
+  {-2, -4,  -8, -10, 1, 3, 7,  9},
+  {-2, -5,  -7, -10, 1, 4, 6,  9},
+  {-3, -4,  -7, -10, 2, 3, 6,  9},
+  {-1, -2,  -3, -10, 0, 1, 2,  9},
+  {-4, -6,  -8,  -9, 3, 5, 7,  8},
+  {-3, -5,  -7,  -9, 2, 4, 6,  8}
+};
+
+//##################################################################################################
+struct ETCSubBlock
+{
+  int table{0};
+  int error{0};
+  uint32_t indices[8]{}; //!< Pixel selector for each of the 8 pixels in the sub block.
+};
+
+//##################################################################################################
+//! Choose the best table and selectors for a sub block around a base color.
+ETCSubBlock encodeETCSubBlock(const uint8_t* const* pixels, const int* base)
+{
+  ETCSubBlock best;
+  best.error = std::numeric_limits<int>::max();
+
+  for(int table=0; table<8; table++)
+  {
+    // Selector order: 0 +small, 1 +large, 2 -small, 3 -large.
+    const int modifiers[4] = {etcModifiers[table][0], etcModifiers[table][1], -etcModifiers[table][0], -etcModifiers[table][1]};
+
+    ETCSubBlock candidate;
+    candidate.table = table;
+    for(int i=0; i<8; i++)
+    {
+      int bestError = std::numeric_limits<int>::max();
+      for(uint32_t s=0; s<4; s++)
+      {
+        int c[3];
+        for(int j=0; j<3; j++)
+          c[j] = std::clamp(base[j]+modifiers[s], 0, 255);
+        int error = colorDistance(pixels[i], c);
+        if(error<bestError)
+        {
+          bestError = error;
+          candidate.indices[i] = s;
+        }
+      }
+      candidate.error += bestError;
+      if(candidate.error>=best.error)
+        break;
+    }
+
+    if(candidate.error<best.error)
+      best = candidate;
+  }
+
+  return best;
+}
+
+//##################################################################################################
+void encodeETC1(const Block& block, uint8_t* out)
+{
+  uint64_t bestBits=0;
+  int bestError = std::numeric_limits<int>::max();
+
+  for(int flip=0; flip<2; flip++)
+  {
+    // flip 0: two 2x4 sub blocks side by side, flip 1: two 4x2 sub blocks one above the other.
+    const uint8_t* pixels[2][8];
+    int xy[2][8][2];
+    int counts[2] = {0, 0};
+    for(int y=0; y<4; y++)
+    {
+      for(int x=0; x<4; x++)
+      {
+        int s = flip?(y>=2):(x>=2);
+        xy[s][counts[s]][0] = x;
+        xy[s][counts[s]][1] = y;
+        pixels[s][counts[s]++] = block.p[y*4+x];
+      }
+    }
+
+    float average[2][3];
+    for(int s=0; s<2; s++)
+    {
+      for(int c=0; c<3; c++)
+      {
+        int sum=0;
+        for(int i=0; i<8; i++)
+          sum += pixels[s][i][c];
+        average[s][c] = float(sum)/8.0f;
+      }
+    }
+
+    // Prefer differential mode, 5 bit base colors, if the second color is within range of the first.
+    int q5[2][3];
+    bool differential=true;
+    for(int s=0; s<2; s++)
+      for(int c=0; c<3; c++)
+        q5[s][c] = std::clamp(int(average[s][c]*31.0f/255.0f + 0.5f), 0, 31);
+    for(int c=0; c<3; c++)
+    {
+      int d = q5[1][c]-q5[0][c];
+      if(d<-4 || d>3)
+        differential = false;
+    }
+
+    int base[2][3];
+    int q4[2][3];
+    for(int s=0; s<2; s++)
+    {
+      for(int c=0; c<3; c++)
+      {
+        if(differential)
+          base[s][c] = (q5[s][c]<<3) | (q5[s][c]>>2);
+        else
+        {
+          q4[s][c] = std::clamp(int(average[s][c]*15.0f/255.0f + 0.5f), 0, 15);
+          base[s][c] = (q4[s][c]<<4) | q4[s][c];
+        }
+      }
+    }
+
+    ETCSubBlock sub[2] = {encodeETCSubBlock(pixels[0], base[0]), encodeETCSubBlock(pixels[1], base[1])};
+    int error = sub[0].error + sub[1].error;
+    if(error>=bestError)
+      continue;
+
+    bestError = error;
+
+    uint64_t bits=0;
+    if(differential)
+    {
+      for(int c=0; c<3; c++)
+      {
+        bits |= uint64_t(q5[0][c]) << (59-c*8);
+        bits |= uint64_t((q5[1][c]-q5[0][c]) & 7) << (56-c*8);
+      }
+    }
+    else
+    {
+      for(int c=0; c<3; c++)
+      {
+        bits |= uint64_t(q4[0][c]) << (60-c*8);
+        bits |= uint64_t(q4[1][c]) << (56-c*8);
+      }
+    }
+
+    bits |= uint64_t(sub[0].table) << 37;
+    bits |= uint64_t(sub[1].table) << 34;
+    bits |= uint64_t(differential?1:0) << 33;
+    bits |= uint64_t(flip) << 32;
+
+    // Pixels are numbered in column major order, MSBs in the upper 16 bits.
+    for(int s=0; s<2; s++)
+    {
+      for(int i=0; i<8; i++)
+      {
+        int j = xy[s][i][0]*4 + xy[s][i][1];
+        uint32_t index = sub[s].indices[i];
+        bits |= uint64_t((index>>1) & 1) << (16+j);
+        bits |= uint64_t( index     & 1) << j;
+      }
+    }
+
+    bestBits = bits;
+  }
+
+  for(int i=0; i<8; i++)
+    out[i] = uint8_t(bestBits >> (56-i*8));
+}
+
+//##################################################################################################
+void encodeEACAlpha(const Block& block, uint8_t* out)
+{
+  int minA=255;
+  int maxA=0;
+  for(const auto& p : block.p)
+  {
+    minA = std::min(minA, int(p[3]));
+    maxA = std::max(maxA, int(p[3]));
+  }
+
+  uint64_t bestBits=0;
+  int bestError = std::numeric_limits<int>::max();
+
+  auto tryEncoding = [&](int table, int multiplier, int base)
+  {
+    uint64_t bits = uint64_t(base)<<56 | uint64_t(multiplier)<<52 | uint64_t(table)<<48;
+    int error=0;
+    for(int x=0; x<4; x++)
+    {
+      for(int y=0; y<4; y++)
+      {
+        int a = block.p[y*4+x][3];
+        int bestPixelError = std::numeric_limits<int>::max();
+        uint64_t bestIndex=0;
+        for(uint64_t i=0; i<8; i++)
+        {
+          int v = std::clamp(base + eacModifiers[table][i]*multiplier, 0, 255);
+          int e = (v-a)*(v-a);
+          if(e<bestPixelError)
+          {
+            bestPixelError = e;
+            bestIndex = i;
+          }
+        }
+        error += bestPixelError;
+        bits |= bestIndex << (45 - (x*4+y)*3);
+      }
+    }
+
+    if(error<bestError)
+    {
+      bestError = error;
+      bestBits = bits;
+    }
+  };
+
+  if(minA==maxA)
+  {
+    // Table 13 has a zero modifier.
+    tryEncoding(13, 1, minA);
+  }
+  else
+  {
+    int range = maxA-minA;
+    for(int table=0; table<16 && bestError>0; table++)
+    {
+      const int* m = eacModifiers[table];
+      int span = m[7]-m[3];
+      int multiplier = std::clamp((range + span/2) / span, 1, 15);
+      for(int mult=std::max(1, multiplier-1); mult<=std::min(15, multiplier+1); mult++)
+      {
+        int base = std::clamp((minA+maxA)/2 - ((m[7]+m[3])*mult)/2, 0, 255);
+        tryEncoding(table, mult, base);
+      }
+    }
+  }
+
+  for(int i=0; i<8; i++)
+    out[i] = uint8_t(bestBits >> (56-i*8));
+}
+
+//##################################################################################################
+void encodeBlock(const Block& block, CompressedTextureFormat format, uint8_t* out)
+{
+  switch(format)
+  {
+    case CompressedTextureFormat::None:
+      break;
+
+    case CompressedTextureFormat::BC1:
+      encodeBC1Color(block, out);
+      break;
+
+    case CompressedTextureFormat::BC3:
+      encodeBC4Alpha(block, out);
+      encodeBC1Color(block, out+8);
+      break;
+
+    case CompressedTextureFormat::ETC2_RGB8:
+      encodeETC1(block, out);
+      break;
+
+    case CompressedTextureFormat::ETC2_RGBA8:
+      encodeEACAlpha(block, out);
+      encodeETC1(block, out+8);
+      break;
+  }
+}
+
+//##################################################################################################
+void writeU32(std::ostream& out, uint32_t value)
+{
+  out.write(reinterpret_cast<const char*>(&value), 4);
+}
+
+const uint8_t ktxIdentifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+}
+
+//##################################################################################################
+const char* compressedTextureFormatToString(CompressedTextureFormat format)
+{
+  switch(format)
+  {
+    case CompressedTextureFormat::None:       return "None";
+    case CompressedTextureFormat::BC1:        return "BC1";
+    case CompressedTextureFormat::BC3:        return "BC3";
+    case CompressedTextureFormat::ETC2_RGB8:  return "ETC2_RGB8";
+    case CompressedTextureFormat::ETC2_RGBA8: return "ETC2_RGBA8";
+  }
+  return "None";
+}
+
+//##################################################################################################
+uint32_t glInternalFormat(CompressedTextureFormat format)
+{
+  switch(format)
+  {
+    case CompressedTextureFormat::None:       return 0;
+    case CompressedTextureFormat::BC1:        return 0x83F0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    case CompressedTextureFormat::BC3:        return 0x83F3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    case CompressedTextureFormat::ETC2_RGB8:  return 0x9274; // GL_COMPRESSED_RGB8_ETC2
+    case CompressedTextureFormat::ETC2_RGBA8: return 0x9278; // GL_COMPRESSED_RGBA8_ETC2_EAC
+  }
+  return 0;
+}
+
+//##################################################################################################
+size_t blockBytes(CompressedTextureFormat format)
+{
+  switch(format)
+  {
+    case CompressedTextureFormat::None:       return 0;
+    case CompressedTextureFormat::BC1:        return 8;
+    case CompressedTextureFormat::BC3:        return 16;
+    case CompressedTextureFormat::ETC2_RGB8:  return 8;
+    case CompressedTextureFormat::ETC2_RGBA8: return 16;
+  }
+  return 0;
+}
+
+//##################################################################################################
+bool hasAlpha(CompressedTextureFormat format)
+{
+  return format==CompressedTextureFormat::BC3 || format==CompressedTextureFormat::ETC2_RGBA8;
+}
+
+//##################################################################################################
+CompressedImage compressImage(const tp_image_utils::ColorMap& image,
+                              CompressedTextureFormat format,
+                              size_t threadCount)
+{
+  CompressedImage result;
+  if(format==CompressedTextureFormat::None || image.width()<1 || image.height()<1)
+    return result;
+
+  result.format = format;
+  result.width = image.width();
+  result.height = image.height();
+
+  size_t blocksX = (result.width+3)/4;
+  size_t blocksY = (result.height+3)/4;
+  size_t bytes = blockBytes(format);
+  result.data.resize(blocksX*blocksY*bytes);
+
+  auto encodeRows = [&](size_t begin, size_t end)
+  {
+    Block block;
+    for(size_t by=begin; by<end; by++)
+    {
+      uint8_t* out = result.data.data() + by*blocksX*bytes;
+      for(size_t bx=0; bx<blocksX; bx++, out+=bytes)
+      {
+        fetchBlock(image, bx, by, block);
+        encodeBlock(block, format, out);
+      }
+    }
+  };
+
+  if(threadCount==0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  // Small images are not worth the cost of starting threads.
+  threadCount = std::min(threadCount, std::max(size_t(1), (blocksX*blocksY)/256));
+
+  if(threadCount<2)
+  {
+    encodeRows(0, blocksY);
+    return result;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  size_t rowsPerThread = (blocksY+threadCount-1)/threadCount;
+  for(size_t begin=0; begin<blocksY; begin+=rowsPerThread)
+    threads.emplace_back(encodeRows, begin, std::min(blocksY, begin+rowsPerThread));
+
+  for(auto& thread : threads)
+    thread.join();
+
+  return result;
+}
+
+//##################################################################################################
+CompressedTextureFormat selectGLCompressedTextureFormat(bool needAlpha)
+{
+  int major=0;
+  int minor=0;
+  int profile=0;
+  SDL_GL_GetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, &major);
+  SDL_GL_GetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, &minor);
+  SDL_GL_GetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, &profile);
+
+  bool bc = SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc");
+
+  bool etc2 = SDL_GL_ExtensionSupported("GL_ARB_ES3_compatibility");
+  if(profile == SDL_GL_CONTEXT_PROFILE_ES)
+    etc2 = etc2 || major>=3;
+  else
+    etc2 = etc2 || major>4 || (major==4 && minor>=3);
+
+  // Desktop GPUs that expose ETC2 through ES3 compatibility often decode it in software.
+  if(bc)
+    return needAlpha?CompressedTextureFormat::BC3:CompressedTextureFormat::BC1;
+
+  if(etc2)
+    return needAlpha?CompressedTextureFormat::ETC2_RGBA8:CompressedTextureFormat::ETC2_RGB8;
+
+  return CompressedTextureFormat::None;
+}
+
+//##################################################################################################
+bool writeKTX(const std::string& path, const CompressedImage& image)
+{
+  if(image.format==CompressedTextureFormat::None)
+    return false;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if(!out)
+  {
+    tpWarning() << "Failed to open for writing: " << path;
+    return false;
+  }
+
+  // Rows are stored bottom first, the same as ColorMap and GL.
+  static const char orientationKey[] = "KTXorientation";
+  static const char orientationValue[] = "S=r,T=u";
+  uint32_t keyValueSize = uint32_t(sizeof(orientationKey) + sizeof(orientationValue));
+  uint32_t keyValuePadding = (4 - (keyValueSize%4)) % 4;
+
+  out.write(reinterpret_cast<const char*>(ktxIdentifier), sizeof(ktxIdentifier));
+  writeU32(out, 0x04030201);
+  writeU32(out, 0); // glType
+  writeU32(out, 1); // glTypeSize
+  writeU32(out, 0); // glFormat
+  writeU32(out, glInternalFormat(image.format));
+  writeU32(out, hasAlpha(image.format)?0x1908:0x1907); // GL_RGBA or GL_RGB
+  writeU32(out, uint32_t(image.width));
+  writeU32(out, uint32_t(image.height));
+  writeU32(out, 0); // pixelDepth
+  writeU32(out, 0); // numberOfArrayElements
+  writeU32(out, 1); // numberOfFaces
+  writeU32(out, 1); // numberOfMipmapLevels
+  writeU32(out, 4 + keyValueSize + keyValuePadding);
+
+  writeU32(out, keyValueSize);
+  out.write(orientationKey, sizeof(orientationKey));
+  out.write(orientationValue, sizeof(orientationValue));
+  out.write("\0\0\0", keyValuePadding);
+
+  writeU32(out, uint32_t(image.data.size()));
+  out.write(reinterpret_cast<const char*>(image.data.data()), std::streamsize(image.data.size()));
+
+  if(!out)
+  {
+    tpWarning() << "Failed to write: " << path;
+    return false;
+  }
+
+  return true;
+}
+
+//##################################################################################################
+bool readKTX(const void* data, size_t size, CompressedImage& image)
+{
+  auto p = static_cast<const uint8_t*>(data);
+  constexpr size_t headerSize = 12 + 13*4;
+  if(size<headerSize+4 || std::memcmp(p, ktxIdentifier, sizeof(ktxIdentifier)) != 0)
+    return false;
+
+  auto u32 = [&](size_t offset)
+  {
+    uint32_t v;
+    std::memcpy(&v, p+offset, 4);
+    return v;
+  };
+
+  if(u32(12) != 0x04030201)
+    return false;
+
+  uint32_t internalFormat = u32(12+4*4);
+  image.format = CompressedTextureFormat::None;
+  for(auto format : {CompressedTextureFormat::BC1,
+                     CompressedTextureFormat::BC3,
+                     CompressedTextureFormat::ETC2_RGB8,
+                     CompressedTextureFormat::ETC2_RGBA8})
+    if(glInternalFormat(format) == internalFormat)
+      image.format = format;
+
+  if(image.format==CompressedTextureFormat::None)
+    return false;
+
+  image.width  = u32(12+6*4);
+  image.height = u32(12+7*4);
+
+  size_t offset = headerSize + u32(12+12*4);
+  if(offset+4>size)
+    return false;
+
+  size_t imageSize = u32(offset);
+  offset += 4;
+
+  size_t expected = ((image.width+3)/4) * ((image.height+3)/4) * blockBytes(image.format);
+  if(imageSize != expected || offset+imageSize>size)
+    return false;
+
+  image.data.assign(p+offset, p+offset+imageSize);
+  return true;
+}
+
+}
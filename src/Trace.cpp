@@ -0,0 +1,279 @@
+#include "tp_maps_sdl/Trace.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace tp_maps_sdl
+{
+
+std::atomic<bool> traceActive{false};
+
+namespace
+{
+constexpr size_t eventsPerThread = size_t(1)<<16;
+
+//##################################################################################################
+struct Event
+{
+  const char* name;
+  const char* category;
+  uint64_t startNS;
+  uint64_t durationNS;
+};
+
+//##################################################################################################
+//! Written only by its own thread, count is published with release so readers see whole events.
+/*!
+events is only allocated when the thread first records while tracing is enabled, so naming a thread
+or running with tracing disabled costs a few bytes rather than a full buffer.
+*/
+struct ThreadBuffer
+{
+  size_t tid{0};
+  std::atomic<const char*> name{nullptr};
+  std::vector<Event> events;
+  std::atomic<size_t> count{0};
+  std::atomic<size_t> dropped{0};
+
+  //! The trace session that the events belong to, the owner clears the buffer when this changes.
+  std::atomic<uint64_t> session{0};
+
+  //! Set when the thread exits, the registry drops the buffer once its events have been saved.
+  std::atomic<bool> exited{false};
+};
+
+//##################################################################################################
+//! Marks the buffer as exited when the thread ends, the registry may still hold it for saving.
+struct ThreadHandle
+{
+  std::shared_ptr<ThreadBuffer> buffer;
+
+  ~ThreadHandle()
+  {
+    if(buffer)
+      buffer->exited = true;
+  }
+};
+
+//##################################################################################################
+struct Registry
+{
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  std::atomic<uint64_t> session{0};
+  uint64_t startNS{0};
+  size_t nextTID{1};
+};
+
+//##################################################################################################
+Registry& registry()
+{
+  static Registry* r = new Registry();
+  return *r;
+}
+
+//##################################################################################################
+//! Drop the buffers of exited threads, keeping those with events in the current session unless all.
+//! Call with the registry mutex locked.
+void pruneExited(Registry& r, bool all)
+{
+  auto session = r.session.load();
+  r.buffers.erase(std::remove_if(r.buffers.begin(), r.buffers.end(), [&](const auto& b)
+  {
+    if(!b->exited)
+      return false;
+    return all || b->session != session || b->count == 0;
+  }), r.buffers.end());
+}
+
+//##################################################################################################
+ThreadBuffer& threadBuffer()
+{
+  thread_local ThreadHandle handle;
+  if(!handle.buffer)
+  {
+    handle.buffer = std::make_shared<ThreadBuffer>();
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    pruneExited(r, false);
+    handle.buffer->tid = r.nextTID++;
+    r.buffers.push_back(handle.buffer);
+  }
+
+  return *handle.buffer;
+}
+
+//##################################################################################################
+void escapeJSON(std::string& out, const char* s)
+{
+  for(; s && *s; s++)
+  {
+    if(*s=='"' || *s=='\\')
+      out += '\\';
+    if(uint8_t(*s)>=0x20)
+      out += *s;
+  }
+}
+}
+
+//##################################################################################################
+void setTraceEnabled(bool enabled)
+{
+  auto& r = registry();
+  if(enabled && !traceActive)
+  {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.startNS = traceNowNS();
+    r.session++;
+    pruneExited(r, true);
+  }
+  traceActive = enabled;
+}
+
+//##################################################################################################
+bool traceEnabled()
+{
+  return traceActive;
+}
+
+//##################################################################################################
+void setTraceThreadName(const char* name)
+{
+  threadBuffer().name = name;
+}
+
+//##################################################################################################
+void traceEvent(const char* name, const char* category, uint64_t startNS, uint64_t endNS)
+{
+  auto& b = threadBuffer();
+
+  if(b.events.empty())
+  {
+    if(!traceActive.load(std::memory_order_relaxed))
+      return;
+
+    // Allocated under the registry mutex so that it is never resized while traceToJSON() reads it.
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    b.events.resize(eventsPerThread);
+  }
+
+  // Reset the count before publishing the new session so readers never see stale events as new.
+  if(uint64_t session = registry().session.load(std::memory_order_acquire); b.session.load(std::memory_order_relaxed) != session)
+  {
+    b.count.store(0, std::memory_order_release);
+    b.dropped = 0;
+    b.session.store(session, std::memory_order_release);
+  }
+
+  size_t i = b.count.load(std::memory_order_relaxed);
+  if(i>=b.events.size())
+  {
+    b.dropped++;
+    return;
+  }
+
+  b.events[i] = Event{name, category, startNS, endNS-startNS};
+  b.count.store(i+1, std::memory_order_release);
+}
+
+//##################################################################################################
+uint64_t traceNowNS()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//##################################################################################################
+size_t traceDroppedEvents()
+{
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  size_t dropped=0;
+  for(const auto& b : r.buffers)
+    dropped += b->dropped;
+  return dropped;
+}
+
+//##################################################################################################
+std::string traceToJSON()
+{
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+
+  std::string json = "{\"traceEvents\":[\n";
+  bool first=true;
+  auto separator = [&]{json += first?"":",\n"; first=false;};
+
+  char buf[128];
+  for(const auto& b : r.buffers)
+  {
+    if(auto name = b->name.load(); name)
+    {
+      separator();
+      snprintf(buf, sizeof(buf), "{\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"name\":\"thread_name\",\"args\":{\"name\":\"", b->tid);
+      json += buf;
+      escapeJSON(json, name);
+      json += "\"}}";
+    }
+
+    // Buffers that have not recorded anything since the session started hold stale events.
+    if(b->session.load(std::memory_order_acquire) != r.session)
+      continue;
+
+    size_t count = b->count.load(std::memory_order_acquire);
+    for(size_t i=0; i<count; i++)
+    {
+      const auto& e = b->events[i];
+      if(e.startNS<r.startNS)
+        continue;
+
+      separator();
+      json += "{\"ph\":\"X\",\"pid\":1,\"name\":\"";
+      escapeJSON(json, e.name);
+      json += "\",\"cat\":\"";
+      escapeJSON(json, e.category);
+      snprintf(buf, sizeof(buf), "\",\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+               b->tid,
+               double(e.startNS-r.startNS)/1000.0,
+               double(e.durationNS)/1000.0);
+      json += buf;
+    }
+  }
+
+  json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return json;
+}
+
+//##################################################################################################
+bool saveTrace(const std::string& path)
+{
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if(!out)
+  {
+    tpWarning() << "Failed to open trace file for writing: " << path;
+    return false;
+  }
+
+  out << traceToJSON();
+
+  if(auto dropped = traceDroppedEvents(); dropped)
+    tpWarning() << "Trace dropped " << dropped << " events, buffers were full.";
+
+  // The events of exited threads are in the file now so their buffers can go.
+  if(out)
+  {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    pruneExited(r, true);
+  }
+
+  return bool(out);
+}
+
+}
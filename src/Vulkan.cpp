@@ -1,4 +1,12 @@
 #include "tp_maps_sdl/Vulkan.h"
+#include "tp_maps_sdl/VulkanUploader.h"
+#include "tp_maps_sdl/VulkanGPUProfiler.h"
+#include "tp_maps_sdl/VulkanCommandRecorder.h"
+#include "tp_maps_sdl/VulkanStaticFrameCache.h"
+#include "tp_maps_sdl/VulkanShaderCache.h"
+#include "tp_maps_sdl/VulkanPipelineCache.h"
+#include "tp_maps_sdl/TextureCompression.h"
+#include "tp_maps_sdl/Trace.h"
 
 #include "tp_utils/DebugUtils.h"
 
@@ -9,6 +17,10 @@
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan/vk_enum_string_helper.h>
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
 #include <set>
 
 namespace tp_maps_sdl
@@ -20,6 +32,9 @@ struct Vulkan::Private
   SDL_Window* window;
   std::string title;
 
+  //! True if there is no window, rendering goes to offscreen images that are read back.
+  bool headless;
+
   bool ok{true};
 
   const std::vector<const char*> validationLayers =
@@ -28,58 +43,128 @@ struct Vulkan::Private
     //"VK_LAYER_LUNARG_standard_validation"
   };
 
-  VkInstance instance;
-  VkSurfaceKHR surface;
-  VkPhysicalDevice physicalDevice;
+  VkInstance instance{VK_NULL_HANDLE};
+  VkSurfaceKHR surface{VK_NULL_HANDLE};
+  VkPhysicalDevice physicalDevice{VK_NULL_HANDLE};
 
   uint32_t graphicsQueueFamilyIndex{0};
   uint32_t presentQueueFamilyIndex{0};
-
-  VkDevice device;
-  VkQueue graphicsQueue;
-  VkQueue presentQueue;
+  uint32_t transferQueueFamilyIndex{0};
+
+  VkDevice device{VK_NULL_HANDLE};
+  bool textureCompressionBC{false};
+  bool textureCompressionETC2{false};
+  bool incrementalPresent{false};
+  bool memoryBudgetExtension{false};
+  PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2{nullptr};
+  std::function<bool(uint32_t, VkDeviceSize)> outOfMemoryHandler;
+  VkQueue graphicsQueue{VK_NULL_HANDLE};
+  VkQueue presentQueue{VK_NULL_HANDLE};
+  VkQueue transferQueue{VK_NULL_HANDLE};
+
+  std::unique_ptr<VulkanUploader> uploader;
+  std::unique_ptr<VulkanGPUProfiler> gpuProfiler;
+  std::unique_ptr<VulkanCommandRecorder> commandRecorder;
+  std::unique_ptr<VulkanStaticFrameCache> staticFrameCache;
+  std::unique_ptr<VulkanShaderCache> shaderCache;
+  std::unique_ptr<VulkanPipelineCache> pipelineCache;
 
   std::vector<VkImage> swapchainImages;
   uint32_t swapchainImageCount;
   VkSurfaceFormatKHR surfaceFormat;
   VkExtent2D swapchainSize;
-  VkSwapchainKHR swapchain;
+  VkSwapchainKHR swapchain{VK_NULL_HANDLE};
   VkSurfaceCapabilitiesKHR surfaceCapabilities;
 
   std::vector<VkImageView> swapchainImageViews;
 
-  VkFormat depthFormat;
-  VkImage depthImage;
-  VkDeviceMemory depthImageMemory;
-  VkImageView depthImageView;
+  VulkanAttachmentConfig attachmentConfig;
+  VulkanAttachmentConfig obtainedConfig;
+  VkSampleCountFlagBits sampleCount{VK_SAMPLE_COUNT_1_BIT};
+
+  VkFormat depthFormat{VK_FORMAT_UNDEFINED};
+  VkImage depthImage{VK_NULL_HANDLE};
+  VkDeviceMemory depthImageMemory{VK_NULL_HANDLE};
+  VkImageView depthImageView{VK_NULL_HANDLE};
 
-  VkRenderPass renderPass;
+  VkImage msaaColorImage{VK_NULL_HANDLE};
+  VkDeviceMemory msaaColorImageMemory{VK_NULL_HANDLE};
+  VkImageView msaaColorImageView{VK_NULL_HANDLE};
+
+  uint32_t attachmentCount{0};
+  uint32_t colorAttachmentIndex{0};
+  uint32_t depthAttachmentIndex{VK_ATTACHMENT_UNUSED};
+  uint32_t resolveAttachmentIndex{VK_ATTACHMENT_UNUSED};
+
+  VkRenderPass renderPass{VK_NULL_HANDLE};
 
   std::vector<VkFramebuffer> swapchainFramebuffers;
 
-  VkCommandPool commandPool;
+  VkCommandPool commandPool{VK_NULL_HANDLE};
   std::vector<VkCommandBuffer> commandBuffers;
 
-  VkSemaphore imageAvailableSemaphore;
-  VkSemaphore renderingFinishedSemaphore;
+  VkSemaphore imageAvailableSemaphore{VK_NULL_HANDLE};
+  VkSemaphore renderingFinishedSemaphore{VK_NULL_HANDLE};
 
   std::vector<VkFence> fences;
 
   PFN_vkCreateDebugReportCallbackEXT SDL2_vkCreateDebugReportCallbackEXT = nullptr;
-  VkDebugReportCallbackEXT debugCallback;
+  VkDebugReportCallbackEXT debugCallback{VK_NULL_HANDLE};
+
+  //-- Headless ------------------------------------------------------------------------------------
+  struct OffscreenFrame
+  {
+    VkImage colorImage{VK_NULL_HANDLE};
+    VkDeviceMemory colorImageMemory{VK_NULL_HANDLE};
+
+    VkBuffer readbackBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory readbackMemory{VK_NULL_HANDLE};
+    const uint8_t* readbackData{nullptr};
+    bool readbackCoherent{true};
+
+    //! Regions of the color image that are copied back, packed one after another in the buffer.
+    std::vector<VkRect2D> regions;
+    std::function<void(size_t, const tp_image_utils::ColorMap&)> completed;
+  };
 
+  std::vector<OffscreenFrame> offscreenFrames;
+  std::deque<size_t> pendingOffscreenFrames;
+  size_t nextOffscreenFrame{0};
 
   //################################################################################################
-  Private(SDL_Window* window_, const std::string& title_):
+  Private(SDL_Window* window_,
+          const std::string& title_,
+          size_t width,
+          size_t height,
+          size_t framesInFlight,
+          const VulkanAttachmentConfig& attachmentConfig_):
     window(window_),
-    title(title_)
+    title(title_),
+    headless(window_==nullptr),
+    attachmentConfig(attachmentConfig_)
   {
     //-- Create Instance ---------------------------------------------------------------------------
     {
+      // Headless rendering doesn't need any of the surface extensions.
       unsigned int extensionCount = 0;
-      SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, nullptr);
-      std::vector<const char *> extensionNames(extensionCount);
-      SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, extensionNames.data());
+      std::vector<const char *> extensionNames;
+      if(!headless)
+      {
+        SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, nullptr);
+        extensionNames.resize(extensionCount);
+        SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, extensionNames.data());
+      }
+
+      // Needed to query VK_EXT_memory_budget on a Vulkan 1.0 instance.
+      {
+        uint32_t count=0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> extensions(count);
+        vkEnumerateInstanceExtensionProperties(nullptr, &count, extensions.data());
+        for(const auto& extension : extensions)
+          if(std::strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)==0)
+            extensionNames.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+      }
 
       tpDebug() << "Extension names:";
       for(auto extensionName : extensionNames)
@@ -109,22 +194,28 @@ struct Vulkan::Private
       {
         tpWarning() << "Failed to create Vulkan instance.";
         ok = false;
+        return;
       }
     }
 
     //-- Create Debug ------------------------------------------------------------------------------
     {
-      SDL2_vkCreateDebugReportCallbackEXT = reinterpret_cast<PFN_vkCreateDebugReportCallbackEXT>(SDL_Vulkan_GetVkGetInstanceProcAddr());
+      // This is only available if VK_EXT_debug_report has been enabled by a layer or extension.
+      SDL2_vkCreateDebugReportCallbackEXT = reinterpret_cast<PFN_vkCreateDebugReportCallbackEXT>(vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT"));
 
-      VkDebugReportCallbackCreateInfoEXT debugCallbackCreateInfo = {};
-      debugCallbackCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
-      debugCallbackCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
-      debugCallbackCreateInfo.pfnCallback = vulkanReportFunc;
+      if(SDL2_vkCreateDebugReportCallbackEXT)
+      {
+        VkDebugReportCallbackCreateInfoEXT debugCallbackCreateInfo = {};
+        debugCallbackCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
+        debugCallbackCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
+        debugCallbackCreateInfo.pfnCallback = vulkanReportFunc;
 
-      SDL2_vkCreateDebugReportCallbackEXT(instance, &debugCallbackCreateInfo, 0, &debugCallback);
+        SDL2_vkCreateDebugReportCallbackEXT(instance, &debugCallbackCreateInfo, 0, &debugCallback);
+      }
     }
 
     //-- Create Surface ----------------------------------------------------------------------------
+    if(!headless)
     {
       SDL_Vulkan_CreateSurface(window, instance, &surface);
     }
@@ -138,15 +229,57 @@ struct Vulkan::Private
       physicalDevices.resize(physicalDeviceCount);
       vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
 
+      // Prefer real GPUs but accept a CPU implementation like lavapipe if that is all there is.
+      auto score = [&](VkPhysicalDevice physicalDevice, const VkPhysicalDeviceProperties& properties)
+      {
+        if(!headless)
+        {
+          uint32_t queueFamilyCount=0;
+          vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+          bool canPresent=false;
+          for(uint32_t i=0; i<queueFamilyCount && !canPresent; i++)
+          {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+            canPresent = presentSupport;
+          }
+
+          if(!canPresent)
+            return -1;
+        }
+
+        switch(properties.deviceType)
+        {
+          case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   return 4;
+          case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+          case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    return 2;
+          case VK_PHYSICAL_DEVICE_TYPE_CPU:            return 1;
+          default:                                     return 0;
+        }
+      };
+
+      int bestScore = -1;
       tpDebug() << "List physical devices:";
-      for(const auto& physicalDevice : physicalDevices)
+      for(const auto& candidate : physicalDevices)
       {
         VkPhysicalDeviceProperties properties;
-        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-        tpDebug() << " - " << properties.deviceName;
+        vkGetPhysicalDeviceProperties(candidate, &properties);
+        tpDebug() << " - " << properties.deviceName << " (" << string_VkPhysicalDeviceType(properties.deviceType) << ")";
+
+        if(int s=score(candidate, properties); s>bestScore)
+        {
+          bestScore = s;
+          physicalDevice = candidate;
+        }
       }
 
-      physicalDevice = physicalDevices[2];
+      if(bestScore<0)
+      {
+        tpWarning() << "Failed to find a suitable Vulkan physical device.";
+        ok = false;
+        return;
+      }
     }
 
     //-- Select Queue Family -----------------------------------------------------------------------
@@ -160,6 +293,8 @@ struct Vulkan::Private
 
       int graphicIndex = -1;
       int presentIndex = -1;
+      int transferIndex = -1;
+      int transferScore = -1;
 
       int i = 0;
       tpDebug() << "Queue familes:";
@@ -173,34 +308,89 @@ struct Vulkan::Private
                      " height: " << queueFamily.minImageTransferGranularity.height <<
                      " depth: " << queueFamily.minImageTransferGranularity.depth << ")";
 
-        if(queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        if(graphicIndex == -1 && queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
         {
           graphicIndex = i;
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
-        if(queueFamily.queueCount > 0 && presentSupport)
+        if(!headless)
+          vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        if(presentIndex == -1 && queueFamily.queueCount > 0 && presentSupport)
         {
           presentIndex = i;
         }
 
-        if(graphicIndex != -1 && presentIndex != -1)
+        // Prefer a transfer only family (DMA engine), then one without graphics (async compute).
+        if(queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
         {
-          break;
+          int score = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)?1:2;
+          if(score>transferScore)
+          {
+            transferScore = score;
+            transferIndex = i;
+          }
         }
 
         i++;
       }
+
+      // Nothing is presented in headless mode.
+      if(headless)
+        presentIndex = graphicIndex;
+
+      if(graphicIndex == -1 || presentIndex == -1)
+      {
+        tpWarning() << "Failed to find graphics and present queue families.";
+        ok = false;
+        return;
+      }
+
+      graphicsQueueFamilyIndex = uint32_t(graphicIndex);
+      presentQueueFamilyIndex = uint32_t(presentIndex);
+
+      // Devices with a single queue family (lavapipe, most mobile GPUs) upload on the graphics queue.
+      transferQueueFamilyIndex = (transferIndex != -1)?uint32_t(transferIndex):graphicsQueueFamilyIndex;
+
+      tpDebug() << "Graphics queue family: " << graphicsQueueFamilyIndex <<
+                   " present queue family: " << presentQueueFamilyIndex <<
+                   " transfer queue family: " << transferQueueFamilyIndex;
     }
 
     //-- Create Device -----------------------------------------------------------------------------
     {
-      const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+      std::vector<const char*> deviceExtensions;
+      if(!headless)
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+      getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+
+      {
+        uint32_t extensionCount=0;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+        for(const auto& extension : extensions)
+        {
+          // Lets the presentation engine copy only the damaged regions of each frame.
+          if(!headless && std::strcmp(extension.extensionName, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME)==0)
+          {
+            deviceExtensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+            incrementalPresent = true;
+          }
+
+          // Per heap budget and usage, including allocations made by other processes.
+          if(getMemoryProperties2 && std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)==0)
+          {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            memoryBudgetExtension = true;
+          }
+        }
+      }
       const float queue_priority[] = { 1.0f };
 
       std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-      std::set<uint32_t> uniqueQueueFamilies = { graphicsQueueFamilyIndex, presentQueueFamilyIndex };
+      std::set<uint32_t> uniqueQueueFamilies = { graphicsQueueFamilyIndex, presentQueueFamilyIndex, transferQueueFamilyIndex };
 
       float queuePriority = queue_priority[0];
       for(int queueFamily : uniqueQueueFamilies)
@@ -219,9 +409,18 @@ struct Vulkan::Private
       queueCreateInfo.queueCount = 1;
       queueCreateInfo.pQueuePriorities = &queuePriority;
 
+      VkPhysicalDeviceFeatures supportedFeatures = {};
+      vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
       //https://en.wikipedia.org/wiki/Anisotropic_filtering
       VkPhysicalDeviceFeatures deviceFeatures = {};
-      deviceFeatures.samplerAnisotropy = VK_TRUE;
+      deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+
+      // Block compressed textures, used by the tile loaders when the device can sample them.
+      deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+      deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+      textureCompressionBC = supportedFeatures.textureCompressionBC;
+      textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
 
       VkDeviceCreateInfo createInfo = {};
       createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -235,13 +434,44 @@ struct Vulkan::Private
       createInfo.enabledLayerCount = validationLayers.size();
       createInfo.ppEnabledLayerNames = validationLayers.data();
 
-      vkCreateDevice(physicalDevice, &createInfo, nullptr, &device);
+      if(auto r=vkCreateDevice(physicalDevice, &createInfo, nullptr, &device); r != VK_SUCCESS)
+      {
+        tpWarning() << "Failed to create Vulkan device: " << string_VkResult(r);
+        ok = false;
+        return;
+      }
 
       vkGetDeviceQueue(device, graphicsQueueFamilyIndex, 0, &graphicsQueue);
       vkGetDeviceQueue(device, presentQueueFamilyIndex, 0, &presentQueue);
+      vkGetDeviceQueue(device, transferQueueFamilyIndex, 0, &transferQueue);
+    }
+
+    //-- Create Uploader ---------------------------------------------------------------------------
+    {
+      VulkanUploader::Params params;
+      params.physicalDevice = physicalDevice;
+      params.device = device;
+      params.transferQueueFamilyIndex = transferQueueFamilyIndex;
+      params.transferQueue = transferQueue;
+      params.graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+      params.graphicsQueue = graphicsQueue;
+      uploader = std::make_unique<VulkanUploader>(params);
+
+      if(!uploader->isValid())
+      {
+        tpWarning() << "Failed to create Vulkan uploader.";
+        ok = false;
+        return;
+      }
+    }
+
+    //-- Create GPU Profiler -----------------------------------------------------------------------
+    {
+      gpuProfiler = std::make_unique<VulkanGPUProfiler>(physicalDevice, device, graphicsQueueFamilyIndex);
     }
 
     //-- Create Swap Chain -------------------------------------------------------------------------
+    if(!headless)
     {
       vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCapabilities);
 
@@ -260,17 +490,25 @@ struct Vulkan::Private
       {
         tpDebug() << " - format: " << string_VkFormat(surfaceFormat.format) <<
                      " colorSpace: " << string_VkColorSpaceKHR(surfaceFormat.colorSpace);
-
-        if(surfaceFormat.format == VK_FORMAT_B8G8R8A8_UNORM)
-          this->surfaceFormat = surfaceFormat;
       }
 
-      if(surfaceFormat.format != VK_FORMAT_B8G8R8A8_UNORM)
+      auto findFormat = [&](VkFormat format)
+      {
+        return std::find_if(surfaceFormats.begin(), surfaceFormats.end(), [&](const auto& f){return f.format == format;});
+      };
+
+      // Fall back to UNORM if sRGB was requested but is not offered by the surface.
+      auto i = findFormat(attachmentConfig.srgb?VK_FORMAT_B8G8R8A8_SRGB:VK_FORMAT_B8G8R8A8_UNORM);
+      if(i == surfaceFormats.end())
+        i = findFormat(VK_FORMAT_B8G8R8A8_UNORM);
+
+      if(i == surfaceFormats.end())
       {
         tpWarning() << "Error surfaceFormat.format != VK_FORMAT_B8G8R8A8_UNORM.";
         ok = false;
         return;
       }
+      surfaceFormat = *i;
 
       int width = 0;
       int height = 0;
@@ -282,14 +520,15 @@ struct Vulkan::Private
       swapchainSize.width = width;
       swapchainSize.height = height;
 
-      uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
+      uint32_t imageCount = attachmentConfig.imageCount?attachmentConfig.imageCount:surfaceCapabilities.minImageCount + 1;
+      imageCount = std::max(imageCount, surfaceCapabilities.minImageCount);
       if(surfaceCapabilities.maxImageCount > 0 && imageCount > surfaceCapabilities.maxImageCount)
         imageCount = surfaceCapabilities.maxImageCount;
 
       VkSwapchainCreateInfoKHR createInfo = {};
       createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
       createInfo.surface = surface;
-      createInfo.minImageCount = surfaceCapabilities.minImageCount;
+      createInfo.minImageCount = imageCount;
       createInfo.imageFormat = surfaceFormat.format;
       createInfo.imageColorSpace = surfaceFormat.colorSpace;
       createInfo.imageExtent = swapchainSize;
@@ -310,6 +549,14 @@ struct Vulkan::Private
 
       createInfo.preTransform = surfaceCapabilities.currentTransform;
       createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+      if(attachmentConfig.alpha)
+      {
+        if(surfaceCapabilities.supportedCompositeAlpha & VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR)
+          createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR;
+        else if(surfaceCapabilities.supportedCompositeAlpha & VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR)
+          createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR;
+      }
+      obtainedConfig.alpha = createInfo.compositeAlpha != VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
       createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
       createInfo.clipped = VK_TRUE;
 
@@ -320,6 +567,75 @@ struct Vulkan::Private
       vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, swapchainImages.data());
     }
 
+    //-- Create Offscreen Images -------------------------------------------------------------------
+    if(headless)
+    {
+      // Render straight into the byte order of TPPixel so readback is a plain copy.
+      surfaceFormat.format = attachmentConfig.srgb?VK_FORMAT_R8G8B8A8_SRGB:VK_FORMAT_R8G8B8A8_UNORM;
+      surfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+      swapchainSize.width = uint32_t(std::max(size_t(1), width));
+      swapchainSize.height = uint32_t(std::max(size_t(1), height));
+
+      swapchainImageCount = uint32_t(std::max(size_t(1), framesInFlight));
+      obtainedConfig.alpha = true;
+      offscreenFrames.resize(swapchainImageCount);
+
+      VkDeviceSize readbackSize = VkDeviceSize(swapchainSize.width) * VkDeviceSize(swapchainSize.height) * 4;
+
+      for(auto& frame : offscreenFrames)
+      {
+        createImage(swapchainSize.width,
+                    swapchainSize.height,
+                    surfaceFormat.format,
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    frame.colorImage,
+                    frame.colorImageMemory);
+        swapchainImages.push_back(frame.colorImage);
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = readbackSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        vkCreateBuffer(device, &bufferInfo, nullptr, &frame.readbackBuffer);
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, frame.readbackBuffer, &memRequirements);
+
+        // Cached memory is much faster to read from the CPU but may not be coherent.
+        uint32_t memoryTypeIndex=0;
+        if(tryFindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, memoryTypeIndex))
+        {
+          VkPhysicalDeviceMemoryProperties memProperties;
+          vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+          frame.readbackCoherent = memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        }
+        else
+          memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if(auto r=vkAllocateMemory(device, &allocInfo, nullptr, &frame.readbackMemory); r != VK_SUCCESS)
+        {
+          tpWarning() << "Failed to allocate readback memory: " << string_VkResult(r);
+          ok = false;
+          return;
+        }
+
+        vkBindBufferMemory(device, frame.readbackBuffer, frame.readbackMemory, 0);
+
+        void* mapped=nullptr;
+        vkMapMemory(device, frame.readbackMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        frame.readbackData = static_cast<const uint8_t*>(mapped);
+      }
+    }
+
     //-- Create Image Views ------------------------------------------------------------------------
     {
       swapchainImageViews.resize(swapchainImages.size());
@@ -330,62 +646,142 @@ struct Vulkan::Private
       }
     }
 
+    //-- Select Sample Count -----------------------------------------------------------------------
+    {
+      VkPhysicalDeviceProperties properties;
+      vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+      VkSampleCountFlags supported = properties.limits.framebufferColorSampleCounts;
+      if(attachmentConfig.depth || attachmentConfig.stencil)
+        supported &= properties.limits.framebufferDepthSampleCounts;
+
+      sampleCount = VK_SAMPLE_COUNT_1_BIT;
+      for(uint32_t samples=1; samples<=64 && samples<=attachmentConfig.sampleCount; samples*=2)
+        if(supported & samples)
+          sampleCount = VkSampleCountFlagBits(samples);
+
+      if(uint32_t(sampleCount) != attachmentConfig.sampleCount)
+        tpWarning() << "Requested " << attachmentConfig.sampleCount << " samples, using " << uint32_t(sampleCount) << ".";
+    }
+
     //-- Setup Depth Stencil -----------------------------------------------------------------------
+    if(attachmentConfig.depth || attachmentConfig.stencil)
     {
-      VkBool32 validDepthFormat = getSupportedDepthFormat(physicalDevice, &depthFormat);
-      createImage(swapchainSize.width,
-                  swapchainSize.height,
-                  VK_FORMAT_D32_SFLOAT_S8_UINT,
-                  VK_IMAGE_TILING_OPTIMAL,
-                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                  depthImage,
-                  depthImageMemory);
-      depthImageView = createImageView(depthImage, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_ASPECT_DEPTH_BIT);
+      if(!getSupportedDepthFormat(physicalDevice, &depthFormat))
+      {
+        tpWarning() << "Failed to find a supported depth format.";
+        ok = false;
+        return;
+      }
+
+      tpDebug() << "Depth format: " << string_VkFormat(depthFormat);
+
+      VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+      if(hasStencil(depthFormat))
+        aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+      createTransientAttachment(depthFormat,
+                                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                depthImage,
+                                depthImageMemory);
+      depthImageView = createImageView(depthImage, depthFormat, aspect);
+    }
+
+    //-- Record What Was Obtained ------------------------------------------------------------------
+    {
+      obtainedConfig.sampleCount = uint32_t(sampleCount);
+      obtainedConfig.depth = depthFormat != VK_FORMAT_UNDEFINED;
+      obtainedConfig.stencil = hasStencil(depthFormat);
+      obtainedConfig.depthPreference = attachmentConfig.depthPreference;
+      obtainedConfig.srgb = surfaceFormat.format == VK_FORMAT_B8G8R8A8_SRGB || surfaceFormat.format == VK_FORMAT_R8G8B8A8_SRGB;
+      obtainedConfig.imageCount = swapchainImageCount;
+    }
+
+    //-- Setup Multisample Color -------------------------------------------------------------------
+    if(sampleCount != VK_SAMPLE_COUNT_1_BIT)
+    {
+      createTransientAttachment(surfaceFormat.format,
+                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                msaaColorImage,
+                                msaaColorImageMemory);
+      msaaColorImageView = createImageView(msaaColorImage, surfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT);
     }
 
     //-- Create Render Pass ------------------------------------------------------------------------
     {
-      std::vector<VkAttachmentDescription> attachments(2);
-
-      attachments[0].format = surfaceFormat.format;
-      attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
-      attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-      attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-      attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-      attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-      attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-      attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-      attachments[1].format = depthFormat;
-      attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
-      attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-      attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-      attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-      attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-      attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-      attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+      // Only the single sample color image is ever read (presented or copied). Depth and multisample
+      // color are never stored so tiled GPUs can keep them in on-chip memory.
+      std::vector<VkAttachmentDescription> attachments;
+      const bool msaa = sampleCount != VK_SAMPLE_COUNT_1_BIT;
+      const VkImageLayout presentLayout = headless?VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+      {
+        colorAttachmentIndex = uint32_t(attachments.size());
+        auto& attachment = attachments.emplace_back();
+        attachment.format = surfaceFormat.format;
+        attachment.samples = sampleCount;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = msaa?VK_ATTACHMENT_STORE_OP_DONT_CARE:VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = msaa?VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:presentLayout;
+      }
+
+      depthAttachmentIndex = VK_ATTACHMENT_UNUSED;
+      if(depthImage)
+      {
+        depthAttachmentIndex = uint32_t(attachments.size());
+        auto& attachment = attachments.emplace_back();
+        attachment.format = depthFormat;
+        attachment.samples = sampleCount;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+      }
+
+      resolveAttachmentIndex = VK_ATTACHMENT_UNUSED;
+      if(msaa)
+      {
+        resolveAttachmentIndex = uint32_t(attachments.size());
+        auto& attachment = attachments.emplace_back();
+        attachment.format = surfaceFormat.format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = presentLayout;
+      }
 
       VkAttachmentReference colorReference = {};
-      colorReference.attachment = 0;
+      colorReference.attachment = colorAttachmentIndex;
       colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
       VkAttachmentReference depthReference = {};
-      depthReference.attachment = 1;
+      depthReference.attachment = depthAttachmentIndex;
       depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+      VkAttachmentReference resolveReference = {};
+      resolveReference.attachment = resolveAttachmentIndex;
+      resolveReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
       VkSubpassDescription subpassDescription = {};
       subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
       subpassDescription.colorAttachmentCount = 1;
       subpassDescription.pColorAttachments = &colorReference;
-      subpassDescription.pDepthStencilAttachment = &depthReference;
+      subpassDescription.pDepthStencilAttachment = depthImage?&depthReference:nullptr;
       subpassDescription.inputAttachmentCount = 0;
       subpassDescription.pInputAttachments = nullptr;
       subpassDescription.preserveAttachmentCount = 0;
       subpassDescription.pPreserveAttachments = nullptr;
-      subpassDescription.pResolveAttachments = nullptr;
+      subpassDescription.pResolveAttachments = msaa?&resolveReference:nullptr;
 
-      std::vector<VkSubpassDependency> dependencies(1);
+      std::vector<VkSubpassDependency> dependencies(2);
 
       dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
       dependencies[0].dstSubpass = 0;
@@ -395,6 +791,27 @@ struct Vulkan::Private
       dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
       dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
+      // The depth and multisample color buffers are shared between frames in flight.
+      dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+      dependencies[1].dstSubpass = 0;
+      dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+      dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+      dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+      dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+      dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+      // In headless mode the color attachment is copied to the readback buffer after the pass.
+      if(headless)
+      {
+        auto& dependency = dependencies.emplace_back();
+        dependency.srcSubpass = 0;
+        dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      }
+
       VkRenderPassCreateInfo renderPassInfo = {};
       renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
       renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
@@ -404,6 +821,8 @@ struct Vulkan::Private
       renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
       renderPassInfo.pDependencies = dependencies.data();
 
+      attachmentCount = renderPassInfo.attachmentCount;
+
       vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
     }
 
@@ -413,9 +832,17 @@ struct Vulkan::Private
 
       for (size_t i = 0; i < swapchainImageViews.size(); i++)
       {
-        std::vector<VkImageView> attachments(2);
-        attachments[0] = swapchainImageViews[i];
-        attachments[1] = depthImageView;
+        std::vector<VkImageView> attachments(attachmentCount);
+        if(resolveAttachmentIndex != VK_ATTACHMENT_UNUSED)
+        {
+          attachments[colorAttachmentIndex] = msaaColorImageView;
+          attachments[resolveAttachmentIndex] = swapchainImageViews[i];
+        }
+        else
+          attachments[colorAttachmentIndex] = swapchainImageViews[i];
+
+        if(depthAttachmentIndex != VK_ATTACHMENT_UNUSED)
+          attachments[depthAttachmentIndex] = depthImageView;
 
         VkFramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -457,6 +884,42 @@ struct Vulkan::Private
       vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data());
     }
 
+    //-- Create Command Recorder -------------------------------------------------------------------
+    {
+      VulkanCommandRecorder::Params params;
+      params.device = device;
+      params.queueFamilyIndex = graphicsQueueFamilyIndex;
+      params.framesInFlight = swapchainImageCount;
+      commandRecorder = std::make_unique<VulkanCommandRecorder>(params);
+    }
+
+    //-- Create Static Frame Cache -----------------------------------------------------------------
+    {
+      VulkanStaticFrameCache::Params params;
+      params.device = device;
+      params.queueFamilyIndex = graphicsQueueFamilyIndex;
+      params.imageCount = swapchainImageCount;
+      staticFrameCache = std::make_unique<VulkanStaticFrameCache>(params);
+    }
+
+    //-- Create Shader Cache -----------------------------------------------------------------------
+    {
+      VulkanShaderCache::Params params;
+      params.device = device;
+      shaderCache = std::make_unique<VulkanShaderCache>(params);
+    }
+
+    //-- Create Pipeline Cache ---------------------------------------------------------------------
+    {
+      VulkanPipelineCacheParams params;
+      params.physicalDevice = physicalDevice;
+      params.device = device;
+      params.renderPass = renderPass;
+      params.sampleCount = sampleCount;
+      params.shaderCache = shaderCache.get();
+      pipelineCache = std::make_unique<VulkanPipelineCache>(params);
+    }
+
     //-- Create Semaphores -------------------------------------------------------------------------
     {
       createSemaphore(&imageAvailableSemaphore);
@@ -477,6 +940,74 @@ struct Vulkan::Private
     }
   }
 
+  //################################################################################################
+  ~Private()
+  {
+    if(device)
+    {
+      vkDeviceWaitIdle(device);
+      pipelineCache.reset();
+      shaderCache.reset();
+      staticFrameCache.reset();
+      commandRecorder.reset();
+      gpuProfiler.reset();
+      uploader.reset();
+
+      // Everything below is destroyed in the reverse order to creation, null handles are ignored.
+      for(auto framebuffer : swapchainFramebuffers)
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+      for(auto imageView : swapchainImageViews)
+        vkDestroyImageView(device, imageView, nullptr);
+
+      vkDestroyImageView(device, msaaColorImageView, nullptr);
+      vkDestroyImage(device, msaaColorImage, nullptr);
+      vkFreeMemory(device, msaaColorImageMemory, nullptr);
+
+      vkDestroyImageView(device, depthImageView, nullptr);
+      vkDestroyImage(device, depthImage, nullptr);
+      vkFreeMemory(device, depthImageMemory, nullptr);
+
+      for(auto& frame : offscreenFrames)
+      {
+        if(frame.readbackData)
+          vkUnmapMemory(device, frame.readbackMemory);
+        vkDestroyBuffer(device, frame.readbackBuffer, nullptr);
+        vkFreeMemory(device, frame.readbackMemory, nullptr);
+        vkDestroyImage(device, frame.colorImage, nullptr);
+        vkFreeMemory(device, frame.colorImageMemory, nullptr);
+      }
+
+      vkDestroyRenderPass(device, renderPass, nullptr);
+
+      for(auto fence : fences)
+        vkDestroyFence(device, fence, nullptr);
+
+      vkDestroySemaphore(device, renderingFinishedSemaphore, nullptr);
+      vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+
+      // Also frees the command buffers allocated from it.
+      vkDestroyCommandPool(device, commandPool, nullptr);
+
+      vkDestroySwapchainKHR(device, swapchain, nullptr);
+      vkDestroyDevice(device, nullptr);
+    }
+
+    if(instance)
+    {
+      vkDestroySurfaceKHR(instance, surface, nullptr);
+
+      if(debugCallback)
+      {
+        auto destroyDebugCallback = reinterpret_cast<PFN_vkDestroyDebugReportCallbackEXT>(vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT"));
+        if(destroyDebugCallback)
+          destroyDebugCallback(instance, debugCallback, nullptr);
+      }
+
+      vkDestroyInstance(instance, nullptr);
+    }
+  }
+
   //################################################################################################
   static VKAPI_ATTR VkBool32 VKAPI_CALL vulkanReportFunc(VkDebugReportFlagsEXT flags,
                                                          VkDebugReportObjectTypeEXT objType,
@@ -514,19 +1045,36 @@ struct Vulkan::Private
     return imageView;
   }
 
+  //################################################################################################
+  static bool hasStencil(VkFormat format)
+  {
+    return
+        format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+        format == VK_FORMAT_D24_UNORM_S8_UINT ||
+        format == VK_FORMAT_D16_UNORM_S8_UINT;
+  }
+
   //################################################################################################
   VkBool32 getSupportedDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat)
   {
+    // Ordered by precision, reversed if the smallest format is preferred.
     std::vector<VkFormat> depthFormats = {
       VK_FORMAT_D32_SFLOAT_S8_UINT,
       VK_FORMAT_D32_SFLOAT,
       VK_FORMAT_D24_UNORM_S8_UINT,
+      VK_FORMAT_X8_D24_UNORM_PACK32,
       VK_FORMAT_D16_UNORM_S8_UINT,
       VK_FORMAT_D16_UNORM
     };
 
+    if(attachmentConfig.depthPreference == VulkanDepthPreference::Size)
+      std::reverse(depthFormats.begin(), depthFormats.end());
+
     for(auto& format : depthFormats)
     {
+      if(attachmentConfig.stencil && !hasStencil(format))
+        continue;
+
       VkFormatProperties formatProps;
       vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
       if (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
@@ -539,6 +1087,24 @@ struct Vulkan::Private
     return false;
   }
 
+  //################################################################################################
+  //! Create an attachment that is never stored, backed by lazily allocated memory if possible.
+  void createTransientAttachment(VkFormat format,
+                                 VkImageUsageFlags usage,
+                                 VkImage& image,
+                                 VkDeviceMemory& imageMemory)
+  {
+    createImage(swapchainSize.width,
+                swapchainSize.height,
+                format,
+                VK_IMAGE_TILING_OPTIMAL,
+                usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                image,
+                imageMemory,
+                sampleCount);
+  }
+
   //################################################################################################
   void createImage(uint32_t width,
                    uint32_t height,
@@ -547,7 +1113,8 @@ struct Vulkan::Private
                    VkImageUsageFlags usage,
                    VkMemoryPropertyFlags properties,
                    VkImage& image,
-                   VkDeviceMemory& imageMemory)
+                   VkDeviceMemory& imageMemory,
+                   VkSampleCountFlagBits samples=VK_SAMPLE_COUNT_1_BIT)
   {
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -561,7 +1128,7 @@ struct Vulkan::Private
     imageInfo.tiling = tiling;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = usage;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.samples = samples;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
@@ -572,12 +1139,13 @@ struct Vulkan::Private
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    // Lazily allocated memory is not available for every image, fall back to plain device memory.
+    uint32_t memoryTypeIndex=0;
+    if(!tryFindMemoryType(memRequirements.memoryTypeBits, properties, memoryTypeIndex))
+      memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties & ~VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT));
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+    if(allocateMemory(memRequirements.size, memoryTypeIndex, imageMemory) != VK_SUCCESS)
+    {
       throw std::runtime_error("failed to allocate image memory!");
     }
 
@@ -585,7 +1153,7 @@ struct Vulkan::Private
   }
 
   //################################################################################################
-  uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+  bool tryFindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& index)
   {
     VkPhysicalDeviceMemoryProperties memProperties;
     vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -594,13 +1162,111 @@ struct Vulkan::Private
     {
       if((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
       {
-        return i;
+        index = i;
+        return true;
       }
     }
 
+    return false;
+  }
+
+  //################################################################################################
+  //! Falls back to memory without the optional properties before giving up.
+  uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+  {
+    if(uint32_t i=0; tryFindMemoryType(typeFilter, properties, i))
+      return i;
+
+    const VkMemoryPropertyFlags optional =
+        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT |
+        VK_MEMORY_PROPERTY_HOST_CACHED_BIT |
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    if(uint32_t i=0; tryFindMemoryType(typeFilter, properties & ~optional, i))
+    {
+      tpWarning() << "No memory type with " << string_VkMemoryPropertyFlags(properties) << ", using " <<
+                     string_VkMemoryPropertyFlags(properties & ~optional) << ".";
+      return i;
+    }
+
     throw std::runtime_error("failed to find suitable memory type!");
   }
 
+  //################################################################################################
+  //! Allocate, giving the out of memory handler one chance to free space in the heap.
+  VkResult allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, VkDeviceMemory& memory)
+  {
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkResult r = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if(r == VK_ERROR_OUT_OF_DEVICE_MEMORY && outOfMemoryHandler)
+    {
+      VkPhysicalDeviceMemoryProperties memProperties;
+      vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+      if(outOfMemoryHandler(memProperties.memoryTypes[memoryTypeIndex].heapIndex, size))
+        r = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    }
+
+    if(r != VK_SUCCESS)
+      tpWarning() << "Failed to allocate " << size << " bytes: " << string_VkResult(r);
+    return r;
+  }
+
+  //################################################################################################
+  //! Read back the oldest pending offscreen frame, returns false if it is not ready and !wait.
+  bool collectOffscreenFrame(bool wait)
+  {
+    if(pendingOffscreenFrames.empty())
+      return false;
+
+    size_t index = pendingOffscreenFrames.front();
+    auto& frame = offscreenFrames.at(index);
+    VkFence fence = fences.at(index);
+
+    if(wait)
+      vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+    else if(vkGetFenceStatus(device, fence) != VK_SUCCESS)
+      return false;
+
+    pendingOffscreenFrames.pop_front();
+
+    if(!frame.readbackCoherent)
+    {
+      VkMappedMemoryRange range = {};
+      range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+      range.memory = frame.readbackMemory;
+      range.size = VK_WHOLE_SIZE;
+      vkInvalidateMappedMemoryRanges(device, 1, &range);
+    }
+
+    auto completed = std::move(frame.completed);
+    frame.completed = nullptr;
+
+    const uint8_t* src = frame.readbackData;
+    for(size_t r=0; r<frame.regions.size(); r++)
+    {
+      const auto& region = frame.regions.at(r);
+      tp_image_utils::ColorMap image(region.extent.width, region.extent.height);
+
+      // Note that:
+      // tp_image_utils::ColorMap 0,0 is in the bottom left.
+      // Vulkan images            0,0 is in the top left.
+      size_t rowBytes = size_t(region.extent.width)*4;
+      auto dst = reinterpret_cast<uint8_t*>(image.data());
+      for(size_t y=0; y<region.extent.height; y++)
+        std::memcpy(dst + y*rowBytes, src + (region.extent.height-1-y)*rowBytes, rowBytes);
+      src += rowBytes*region.extent.height;
+
+      if(completed)
+        completed(r, image);
+    }
+
+    return true;
+  }
+
   //################################################################################################
   void createSemaphore(VkSemaphore *semaphore)
   {
@@ -611,8 +1277,19 @@ struct Vulkan::Private
 };
 
 //##################################################################################################
-Vulkan::Vulkan(SDL_Window* window, const std::string& title):
-  d(new Private(window, title))
+Vulkan::Vulkan(SDL_Window* window, const std::string& title, const VulkanAttachmentConfig& attachmentConfig):
+  d(new Private(window, title, 0, 0, 0, attachmentConfig))
+{
+
+}
+
+//##################################################################################################
+Vulkan::Vulkan(size_t width,
+               size_t height,
+               size_t framesInFlight,
+               const std::string& title,
+               const VulkanAttachmentConfig& attachmentConfig):
+  d(new Private(nullptr, title, width, height, framesInFlight, attachmentConfig))
 {
 
 }
@@ -623,4 +1300,357 @@ Vulkan::~Vulkan()
   delete d;
 }
 
+//##################################################################################################
+bool Vulkan::isValid() const
+{
+  return d->ok;
+}
+
+//##################################################################################################
+bool Vulkan::isHeadless() const
+{
+  return d->headless;
+}
+
+//##################################################################################################
+uint32_t Vulkan::sampleCount() const
+{
+  return uint32_t(d->sampleCount);
+}
+
+//##################################################################################################
+VkFormat Vulkan::depthFormat() const
+{
+  return d->depthFormat;
+}
+
+//##################################################################################################
+const VulkanAttachmentConfig& Vulkan::attachmentConfig() const
+{
+  return d->obtainedConfig;
+}
+
+//##################################################################################################
+void Vulkan::renderOffscreen(const std::function<void(VkCommandBuffer)>& draw,
+                             const std::function<void(const tp_image_utils::ColorMap&)>& completed)
+{
+  VkRect2D region{{0, 0}, d->swapchainSize};
+  renderOffscreenRegions(draw, {region}, [completed](size_t, const tp_image_utils::ColorMap& image)
+  {
+    if(completed)
+      completed(image);
+  });
+}
+
+//##################################################################################################
+void Vulkan::renderOffscreenRegions(const std::function<void(VkCommandBuffer)>& draw,
+                                    const std::vector<VkRect2D>& regions,
+                                    const std::function<void(size_t, const tp_image_utils::ColorMap&)>& completed)
+{
+  TraceScope traceScope("renderOffscreen", "vulkan");
+
+  // Every region is always handed back, with an empty ColorMap if the frame could not be rendered.
+  auto fail = [&]
+  {
+    if(completed)
+      for(size_t i=0; i<regions.size(); i++)
+        completed(i, tp_image_utils::ColorMap());
+  };
+
+  if(!d->ok || !d->headless)
+  {
+    tpWarning() << "Vulkan::renderOffscreen() requires a valid headless Vulkan instance.";
+    fail();
+    return;
+  }
+
+  // Clip to the image, anything left empty is skipped.
+  std::vector<VkRect2D> clippedRegions;
+  clippedRegions.reserve(regions.size());
+  VkDeviceSize readbackBytes=0;
+  for(const auto& region : regions)
+  {
+    VkRect2D& clipped = clippedRegions.emplace_back();
+    clipped.offset.x = std::clamp(region.offset.x, 0, int32_t(d->swapchainSize.width));
+    clipped.offset.y = std::clamp(region.offset.y, 0, int32_t(d->swapchainSize.height));
+    clipped.extent.width = std::min(region.extent.width, d->swapchainSize.width - uint32_t(clipped.offset.x));
+    clipped.extent.height = std::min(region.extent.height, d->swapchainSize.height - uint32_t(clipped.offset.y));
+    readbackBytes += VkDeviceSize(clipped.extent.width) * VkDeviceSize(clipped.extent.height) * 4;
+  }
+
+  // The regions are packed into a readback buffer sized for one image, overlaps can overflow it.
+  if(readbackBytes > VkDeviceSize(d->swapchainSize.width) * VkDeviceSize(d->swapchainSize.height) * 4)
+  {
+    tpWarning() << "Vulkan::renderOffscreenRegions() regions cover more pixels than the image.";
+    fail();
+    return;
+  }
+
+  // If every frame is in flight wait for the oldest one and hand it back.
+  size_t index = d->nextOffscreenFrame;
+  while(std::find(d->pendingOffscreenFrames.begin(), d->pendingOffscreenFrames.end(), index) != d->pendingOffscreenFrames.end())
+    d->collectOffscreenFrame(true);
+  d->nextOffscreenFrame = (index+1) % d->offscreenFrames.size();
+
+  auto& frame = d->offscreenFrames.at(index);
+  frame.completed = completed;
+  frame.regions = std::move(clippedRegions);
+
+  VkFence fence = d->fences.at(index);
+  vkResetFences(d->device, 1, &fence);
+
+  VkCommandBuffer commandBuffer = d->commandBuffers.at(index);
+  vkResetCommandBuffer(commandBuffer, 0);
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+  std::vector<VkClearValue> clearValues(d->attachmentCount);
+  clearValues[d->colorAttachmentIndex].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+  if(d->depthAttachmentIndex != VK_ATTACHMENT_UNUSED)
+    clearValues[d->depthAttachmentIndex].depthStencil = {1.0f, 0};
+
+  VkRenderPassBeginInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = d->renderPass;
+  renderPassInfo.framebuffer = d->swapchainFramebuffers.at(index);
+  renderPassInfo.renderArea.extent = d->swapchainSize;
+  renderPassInfo.clearValueCount = uint32_t(clearValues.size());
+  renderPassInfo.pClearValues = clearValues.data();
+
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  if(draw)
+    draw(commandBuffer);
+  vkCmdEndRenderPass(commandBuffer);
+
+  // Only the regions are copied back, tightly packed, the buffer is sized for the whole image.
+  std::vector<VkBufferImageCopy> copies;
+  copies.reserve(frame.regions.size());
+  {
+    VkDeviceSize offset=0;
+    for(const auto& region : frame.regions)
+    {
+      if(region.extent.width>0 && region.extent.height>0)
+      {
+        auto& copy = copies.emplace_back();
+        copy.bufferOffset = offset;
+        copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.imageSubresource.layerCount = 1;
+        copy.imageOffset = {region.offset.x, region.offset.y, 0};
+        copy.imageExtent = {region.extent.width, region.extent.height, 1};
+      }
+      offset += VkDeviceSize(region.extent.width) * VkDeviceSize(region.extent.height) * 4;
+    }
+  }
+
+  if(!copies.empty())
+    vkCmdCopyImageToBuffer(commandBuffer, frame.colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readbackBuffer, uint32_t(copies.size()), copies.data());
+
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = frame.readbackBuffer;
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+
+  if(auto r=vkQueueSubmit(d->graphicsQueue, 1, &submitInfo, fence); r != VK_SUCCESS)
+  {
+    tpWarning() << "Failed to submit offscreen frame: " << string_VkResult(r);
+    frame.completed = nullptr;
+    fail();
+    return;
+  }
+
+  d->pendingOffscreenFrames.push_back(index);
+}
+
+//##################################################################################################
+VkExtent2D Vulkan::extent() const
+{
+  return d->swapchainSize;
+}
+
+//##################################################################################################
+size_t Vulkan::collectOffscreen(bool wait)
+{
+  size_t count=0;
+  while(d->collectOffscreenFrame(wait))
+    count++;
+  return count;
+}
+
+//##################################################################################################
+VulkanUploader* Vulkan::uploader() const
+{
+  return d->uploader.get();
+}
+
+//##################################################################################################
+VulkanGPUProfiler* Vulkan::gpuProfiler() const
+{
+  return d->gpuProfiler.get();
+}
+
+//##################################################################################################
+VulkanCommandRecorder* Vulkan::commandRecorder() const
+{
+  return d->commandRecorder.get();
+}
+
+//##################################################################################################
+VulkanStaticFrameCache* Vulkan::staticFrameCache() const
+{
+  return d->staticFrameCache.get();
+}
+
+//##################################################################################################
+VulkanShaderCache* Vulkan::shaderCache() const
+{
+  return d->shaderCache.get();
+}
+
+//##################################################################################################
+VulkanPipelineCache* Vulkan::pipelineCache() const
+{
+  return d->pipelineCache.get();
+}
+
+//##################################################################################################
+CompressedTextureFormat Vulkan::compressedTextureFormat(bool needAlpha) const
+{
+  auto sampleable = [&](CompressedTextureFormat format)
+  {
+    VkFormatProperties properties{};
+    vkGetPhysicalDeviceFormatProperties(d->physicalDevice, compressedTextureVkFormat(format), &properties);
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+  };
+
+  if(d->textureCompressionBC)
+  {
+    auto format = needAlpha?CompressedTextureFormat::BC3:CompressedTextureFormat::BC1;
+    if(sampleable(format))
+      return format;
+  }
+
+  if(d->textureCompressionETC2)
+  {
+    auto format = needAlpha?CompressedTextureFormat::ETC2_RGBA8:CompressedTextureFormat::ETC2_RGB8;
+    if(sampleable(format))
+      return format;
+  }
+
+  return CompressedTextureFormat::None;
+}
+
+//##################################################################################################
+VkFormat Vulkan::compressedTextureVkFormat(CompressedTextureFormat format)
+{
+  switch(format)
+  {
+    case CompressedTextureFormat::None:       return VK_FORMAT_UNDEFINED;
+    case CompressedTextureFormat::BC1:        return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case CompressedTextureFormat::BC3:        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case CompressedTextureFormat::ETC2_RGB8:  return VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+    case CompressedTextureFormat::ETC2_RGBA8: return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+  }
+  return VK_FORMAT_UNDEFINED;
+}
+
+//##################################################################################################
+bool Vulkan::memoryBudgetSupported() const
+{
+  return d->memoryBudgetExtension;
+}
+
+//##################################################################################################
+std::vector<VulkanHeapBudget> Vulkan::memoryBudget() const
+{
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+  budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+  VkPhysicalDeviceMemoryProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+
+  if(d->memoryBudgetExtension)
+  {
+    properties.pNext = &budgetProperties;
+    d->getMemoryProperties2(d->physicalDevice, &properties);
+  }
+  else
+    vkGetPhysicalDeviceMemoryProperties(d->physicalDevice, &properties.memoryProperties);
+
+  std::vector<VulkanHeapBudget> heaps(properties.memoryProperties.memoryHeapCount);
+  for(uint32_t i=0; i<properties.memoryProperties.memoryHeapCount; i++)
+  {
+    const auto& heap = properties.memoryProperties.memoryHeaps[i];
+    auto& budget = heaps.at(i);
+    budget.size = heap.size;
+    budget.deviceLocal = heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    budget.fromExtension = d->memoryBudgetExtension;
+
+    if(d->memoryBudgetExtension)
+    {
+      budget.budget = budgetProperties.heapBudget[i];
+      budget.usage = budgetProperties.heapUsage[i];
+    }
+    else
+    {
+      // Without the extension leave room for other processes and the driver's own allocations.
+      budget.budget = heap.size / 10 * 8;
+    }
+  }
+
+  return heaps;
+}
+
+//##################################################################################################
+void Vulkan::setOutOfMemoryHandler(const std::function<bool(uint32_t, VkDeviceSize)>& outOfMemoryHandler)
+{
+  d->outOfMemoryHandler = outOfMemoryHandler;
+}
+
+//##################################################################################################
+bool Vulkan::incrementalPresentSupported() const
+{
+  return d->incrementalPresent;
+}
+
+//##################################################################################################
+std::vector<VkRectLayerKHR> Vulkan::presentRectangles(const std::vector<DamageRect>& rects, VkExtent2D extent)
+{
+  std::vector<VkRectLayerKHR> result;
+  result.reserve(rects.size());
+  for(const auto& r : rects)
+  {
+    int x0 = std::clamp(r.x, 0, int(extent.width));
+    int x1 = std::clamp(r.x+r.width, 0, int(extent.width));
+
+    // Damage has a bottom left origin, present regions have a top left origin.
+    int y0 = std::clamp(int(extent.height)-(r.y+r.height), 0, int(extent.height));
+    int y1 = std::clamp(int(extent.height)-r.y, 0, int(extent.height));
+
+    if(x1<=x0 || y1<=y0)
+      continue;
+
+    VkRectLayerKHR rect{};
+    rect.offset = {x0, y0};
+    rect.extent = {uint32_t(x1-x0), uint32_t(y1-y0)};
+    rect.layer = 0;
+    result.push_back(rect);
+  }
+  return result;
+}
+
 }
@@ -0,0 +1,195 @@
+#include "tp_maps_sdl/VulkanBatchRenderer.h"
+#include "tp_maps_sdl/Vulkan.h"
+#include "tp_maps_sdl/Trace.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanBatchRenderer::Private
+{
+  Vulkan* vulkan;
+  DrawFunction draw;
+  VkExtent2D extent{0, 0};
+
+  // Jobs packed into the current pass, with rows filled left to right and top to bottom.
+  std::vector<BatchRenderJob> jobs;
+  std::vector<VkRect2D> tiles;
+  uint32_t rowX{0};
+  uint32_t rowY{0};
+  uint32_t rowHeight{0};
+  uint64_t tileArea{0};
+
+  BatchRenderStats stats;
+  uint64_t submittedArea{0};
+  uint64_t frameArea{0};
+
+  //################################################################################################
+  Private(Vulkan* vulkan_, const DrawFunction& draw_):
+    vulkan(vulkan_),
+    draw(draw_)
+  {
+    if(!vulkan || !vulkan->isValid() || !vulkan->isHeadless())
+    {
+      tpWarning() << "VulkanBatchRenderer requires a valid headless Vulkan instance.";
+      vulkan = nullptr;
+      return;
+    }
+
+    extent = vulkan->extent();
+  }
+
+  //################################################################################################
+  //! Find space for a tile in the current pass, false if the pass is full.
+  bool place(uint32_t width, uint32_t height, VkRect2D& tile)
+  {
+    if(rowX+width > extent.width)
+    {
+      rowX = 0;
+      rowY += rowHeight;
+      rowHeight = 0;
+    }
+
+    if(rowY+height > extent.height)
+      return false;
+
+    tile.offset = {int32_t(rowX), int32_t(rowY)};
+    tile.extent = {width, height};
+    rowX += width;
+    rowHeight = std::max(rowHeight, height);
+    return true;
+  }
+
+  //################################################################################################
+  void submitPass()
+  {
+    if(jobs.empty())
+      return;
+
+    TraceScope traceScope("batchPass", "vulkan");
+
+    // The completion callback runs after packing of the next pass has started so it owns the jobs.
+    auto passJobs = std::make_shared<std::vector<BatchRenderJob>>(std::move(jobs));
+    auto passTiles = std::move(tiles);
+    jobs.clear();
+    tiles.clear();
+
+    auto recordPass = [this, passJobs, &passTiles](VkCommandBuffer commandBuffer)
+    {
+      for(size_t i=0; i<passJobs->size(); i++)
+      {
+        const auto& tile = passTiles.at(i);
+
+        VkViewport viewport = {};
+        viewport.x = float(tile.offset.x);
+        viewport.y = float(tile.offset.y);
+        viewport.width = float(tile.extent.width);
+        viewport.height = float(tile.extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &tile);
+
+        if(draw)
+          draw(commandBuffer, passJobs->at(i), viewport);
+      }
+    };
+
+    auto completed = [passJobs](size_t index, const tp_image_utils::ColorMap& image)
+    {
+      if(const auto& job = passJobs->at(index); job.completed)
+        job.completed(image);
+    };
+
+    vulkan->renderOffscreenRegions(recordPass, passTiles, completed);
+
+    stats.jobs += passJobs->size();
+    stats.passes++;
+    submittedArea += tileArea;
+    frameArea += uint64_t(extent.width)*uint64_t(extent.height);
+    stats.occupancy = double(submittedArea)/double(frameArea);
+
+    rowX = 0;
+    rowY = 0;
+    rowHeight = 0;
+    tileArea = 0;
+  }
+};
+
+//##################################################################################################
+VulkanBatchRenderer::VulkanBatchRenderer(Vulkan* vulkan, const DrawFunction& draw):
+  d(new Private(vulkan, draw))
+{
+
+}
+
+//##################################################################################################
+VulkanBatchRenderer::~VulkanBatchRenderer()
+{
+  finish();
+  delete d;
+}
+
+//##################################################################################################
+void VulkanBatchRenderer::add(const BatchRenderJob& job)
+{
+  auto width = uint32_t(job.width);
+  auto height = uint32_t(job.height);
+
+  if(!d->vulkan || width==0 || height==0 || width>d->extent.width || height>d->extent.height)
+  {
+    tpWarning() << "VulkanBatchRenderer: Rejected a " << job.width << "x" << job.height << " job.";
+    d->stats.rejected++;
+    if(job.completed)
+      job.completed(tp_image_utils::ColorMap());
+    return;
+  }
+
+  VkRect2D tile;
+  if(!d->place(width, height, tile))
+  {
+    d->submitPass();
+    d->place(width, height, tile);
+  }
+
+  d->jobs.push_back(job);
+  d->tiles.push_back(tile);
+  d->tileArea += uint64_t(width)*uint64_t(height);
+}
+
+//##################################################################################################
+size_t VulkanBatchRenderer::flush()
+{
+  if(d->jobs.empty())
+    return 0;
+
+  d->submitPass();
+  return 1;
+}
+
+//##################################################################################################
+size_t VulkanBatchRenderer::collect(bool wait)
+{
+  return d->vulkan?d->vulkan->collectOffscreen(wait):0;
+}
+
+//##################################################################################################
+void VulkanBatchRenderer::finish()
+{
+  flush();
+  collect(true);
+}
+
+//##################################################################################################
+BatchRenderStats VulkanBatchRenderer::stats() const
+{
+  return d->stats;
+}
+
+}
@@ -0,0 +1,259 @@
+#include "tp_maps_sdl/VulkanCommandRecorder.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <vulkan/vulkan/vk_enum_string_helper.h>
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanCommandRecorder::Private
+{
+  Params params;
+
+  //################################################################################################
+  struct Pool
+  {
+    VkCommandPool commandPool{VK_NULL_HANDLE};
+    std::vector<VkCommandBuffer> secondaries;
+    size_t used{0};
+  };
+
+  //! pools[thread][frame], the last thread is the render thread.
+  std::vector<std::vector<Pool>> pools;
+  std::vector<std::thread> workers;
+  size_t frame{0};
+
+  std::mutex mutex;
+  std::condition_variable workCondition;
+  std::condition_variable doneCondition;
+  uint64_t generation{0};
+  bool quit{false};
+
+  // The current job, written by the render thread under the mutex as generation is incremented.
+  // Chunks are claimed and completed under the mutex for the generation they were claimed in, so a
+  // worker still running from an earlier job can never claim a chunk of the next one.
+  const RecordFunction* record{nullptr};
+  VkCommandBufferInheritanceInfo inheritance{};
+  size_t drawCount{0};
+  size_t chunkSize{0};
+  size_t chunkCount{0};
+  size_t nextChunk{0};
+  size_t completed{0};
+  std::vector<VkCommandBuffer> results;
+
+  //################################################################################################
+  Private(const Params& params_):
+    params(params_)
+  {
+    if(params.threadCount==0)
+    {
+      auto n = size_t(std::thread::hardware_concurrency());
+      params.threadCount = (n>1)?n-1:0;
+    }
+
+    params.framesInFlight = std::max(size_t(1), params.framesInFlight);
+    params.minDrawsPerJob = std::max(size_t(1), params.minDrawsPerJob);
+
+    pools.resize(params.threadCount+1);
+    for(auto& threadPools : pools)
+    {
+      threadPools.resize(params.framesInFlight);
+      for(auto& pool : threadPools)
+      {
+        VkCommandPoolCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        createInfo.queueFamilyIndex = params.queueFamilyIndex;
+        if(auto r=vkCreateCommandPool(params.device, &createInfo, nullptr, &pool.commandPool); r != VK_SUCCESS)
+          tpWarning() << "VulkanCommandRecorder: Failed to create command pool: " << string_VkResult(r);
+      }
+    }
+
+    workers.reserve(params.threadCount);
+    for(size_t i=0; i<params.threadCount; i++)
+      workers.emplace_back([this, i]{workerLoop(i);});
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    workCondition.notify_all();
+
+    for(auto& worker : workers)
+      worker.join();
+
+    // Destroying the pool frees its command buffers.
+    for(auto& threadPools : pools)
+      for(auto& pool : threadPools)
+        vkDestroyCommandPool(params.device, pool.commandPool, nullptr);
+  }
+
+  //################################################################################################
+  void workerLoop(size_t thread)
+  {
+    uint64_t seen=0;
+    for(;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        workCondition.wait(lock, [&]{return quit || generation!=seen;});
+        if(quit)
+          return;
+        seen = generation;
+      }
+
+      recordChunks(thread, seen);
+    }
+  }
+
+  //################################################################################################
+  //! Record chunks of the job with generation job until there are none left or a new job starts.
+  void recordChunks(size_t thread, uint64_t job)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(generation==job && nextChunk<chunkCount)
+    {
+      size_t chunk = nextChunk++;
+
+      // The job can't change until this chunk completes, so it is safe to read unlocked.
+      lock.unlock();
+      VkCommandBuffer commandBuffer = recordChunk(thread, chunk);
+      lock.lock();
+
+      results[chunk] = commandBuffer;
+      completed++;
+      if(completed == chunkCount)
+        doneCondition.notify_all();
+    }
+  }
+
+  //################################################################################################
+  VkCommandBuffer recordChunk(size_t thread, size_t chunk)
+  {
+    auto& pool = pools[thread][frame];
+
+    if(pool.used == pool.secondaries.size())
+    {
+      VkCommandBufferAllocateInfo allocateInfo = {};
+      allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocateInfo.commandPool = pool.commandPool;
+      allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocateInfo.commandBufferCount = 1;
+
+      VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+      if(auto r=vkAllocateCommandBuffers(params.device, &allocateInfo, &commandBuffer); r != VK_SUCCESS)
+      {
+        tpWarning() << "VulkanCommandRecorder: Failed to allocate command buffer: " << string_VkResult(r);
+        return VK_NULL_HANDLE;
+      }
+      pool.secondaries.push_back(commandBuffer);
+    }
+
+    VkCommandBuffer commandBuffer = pool.secondaries[pool.used++];
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    size_t begin = chunk*chunkSize;
+    size_t end = std::min(drawCount, begin+chunkSize);
+    (*record)(commandBuffer, begin, end);
+
+    vkEndCommandBuffer(commandBuffer);
+    return commandBuffer;
+  }
+};
+
+//##################################################################################################
+VulkanCommandRecorder::VulkanCommandRecorder(const Params& params):
+  d(new Private(params))
+{
+
+}
+
+//##################################################################################################
+VulkanCommandRecorder::~VulkanCommandRecorder()
+{
+  delete d;
+}
+
+//##################################################################################################
+size_t VulkanCommandRecorder::threadCount() const
+{
+  return d->params.threadCount;
+}
+
+//##################################################################################################
+void VulkanCommandRecorder::beginFrame(size_t frame)
+{
+  d->frame = frame%d->params.framesInFlight;
+
+  for(auto& threadPools : d->pools)
+  {
+    auto& pool = threadPools[d->frame];
+    vkResetCommandPool(d->params.device, pool.commandPool, 0);
+    pool.used = 0;
+  }
+}
+
+//##################################################################################################
+void VulkanCommandRecorder::executeParallel(VkCommandBuffer primary,
+                                            const VkCommandBufferInheritanceInfo& inheritance,
+                                            size_t drawCount,
+                                            const RecordFunction& record)
+{
+  if(drawCount==0)
+    return;
+
+  // A couple of chunks per thread lets faster threads pick up the slack from slower ones.
+  size_t maxChunks = (d->params.threadCount+1)*2;
+  size_t chunkCount = std::min(maxChunks, (drawCount + d->params.minDrawsPerJob - 1) / d->params.minDrawsPerJob);
+  chunkCount = std::max(size_t(1), chunkCount);
+
+  uint64_t job=0;
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->record = &record;
+    d->inheritance = inheritance;
+    d->drawCount = drawCount;
+    d->chunkCount = chunkCount;
+    d->chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+    d->completed = 0;
+    d->results.assign(chunkCount, VK_NULL_HANDLE);
+    d->nextChunk = 0;
+    job = ++d->generation;
+  }
+
+  // Only wake the workers if there is more than one chunk to share out.
+  if(chunkCount>1)
+    d->workCondition.notify_all();
+
+  // The render thread records chunks too, using the last set of pools.
+  d->recordChunks(d->params.threadCount, job);
+
+  {
+    std::unique_lock<std::mutex> lock(d->mutex);
+    d->doneCondition.wait(lock, [&]{return d->completed == d->chunkCount;});
+    d->record = nullptr;
+  }
+
+  // Chunks that failed to allocate a command buffer are left out.
+  d->results.erase(std::remove(d->results.begin(), d->results.end(), VK_NULL_HANDLE), d->results.end());
+  if(!d->results.empty())
+    vkCmdExecuteCommands(primary, uint32_t(d->results.size()), d->results.data());
+}
+
+}
@@ -0,0 +1,159 @@
+#include "tp_maps_sdl/VulkanGPUProfiler.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <vulkan/vulkan/vk_enum_string_helper.h>
+
+#include <algorithm>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanGPUProfiler::Private
+{
+  VkDevice device;
+
+  bool supported{false};
+  double timestampPeriod{1.0};
+  uint64_t validMask{~uint64_t(0)};
+
+  VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+  std::vector<VkQueryPool> queryPools;
+
+  //################################################################################################
+  Private(VkPhysicalDevice physicalDevice,
+          VkDevice device_,
+          uint32_t queueFamilyIndex,
+          size_t framesInFlight,
+          size_t maxScopesPerFrame):
+    device(device_)
+  {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod = double(properties.limits.timestampPeriod);
+
+    uint32_t queueFamilyCount=0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+    uint32_t validBits = (queueFamilyIndex<queueFamilyCount)?queueFamilyProperties.at(queueFamilyIndex).timestampValidBits:0;
+    if(validBits==0 || timestampPeriod<=0.0)
+    {
+      tpWarning() << "VulkanGPUProfiler: Timestamps are not supported on queue family " << queueFamilyIndex << ", GPU profiling disabled.";
+      return;
+    }
+
+    if(validBits<64)
+      validMask = (uint64_t(1)<<validBits) - 1;
+
+    queryPools.resize(std::max(size_t(2), framesInFlight), VK_NULL_HANDLE);
+    for(auto& queryPool : queryPools)
+    {
+      VkQueryPoolCreateInfo createInfo = {};
+      createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      createInfo.queryCount = uint32_t(maxScopesPerFrame*2);
+
+      if(auto r=vkCreateQueryPool(device, &createInfo, nullptr, &queryPool); r != VK_SUCCESS)
+      {
+        tpWarning() << "VulkanGPUProfiler: Failed to create query pool: " << string_VkResult(r);
+        return;
+      }
+    }
+
+    supported = true;
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    for(auto queryPool : queryPools)
+      vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+};
+
+//##################################################################################################
+VulkanGPUProfiler::VulkanGPUProfiler(VkPhysicalDevice physicalDevice,
+                                     VkDevice device,
+                                     uint32_t queueFamilyIndex,
+                                     size_t framesInFlight,
+                                     size_t maxScopesPerFrame,
+                                     size_t historySize):
+  GPUProfiler(framesInFlight, maxScopesPerFrame, historySize),
+  d(new Private(physicalDevice, device, queueFamilyIndex, framesInFlight, maxScopesPerFrame))
+{
+
+}
+
+//##################################################################################################
+VulkanGPUProfiler::~VulkanGPUProfiler()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool VulkanGPUProfiler::isSupported() const
+{
+  return d->supported;
+}
+
+//##################################################################################################
+void VulkanGPUProfiler::setCommandBuffer(VkCommandBuffer commandBuffer)
+{
+  d->commandBuffer = commandBuffer;
+}
+
+//##################################################################################################
+void VulkanGPUProfiler::resetQueries(size_t frame, size_t queryCount)
+{
+  if(d->commandBuffer)
+    vkCmdResetQueryPool(d->commandBuffer, d->queryPools.at(frame), 0, uint32_t(queryCount));
+}
+
+//##################################################################################################
+void VulkanGPUProfiler::writeTimestamp(size_t frame, size_t query, bool endOfScope)
+{
+  // The end of a scope waits for all prior work to complete.
+  if(d->commandBuffer)
+    vkCmdWriteTimestamp(d->commandBuffer,
+                        endOfScope?VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT:VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        d->queryPools.at(frame),
+                        uint32_t(query));
+}
+
+//##################################################################################################
+bool VulkanGPUProfiler::readTimestamps(size_t frame, size_t queryCount, std::vector<uint64_t>& nanoseconds)
+{
+  nanoseconds.clear();
+  if(queryCount==0)
+    return true;
+
+  std::vector<uint64_t> ticks(queryCount);
+  auto r = vkGetQueryPoolResults(d->device,
+                                 d->queryPools.at(frame),
+                                 0,
+                                 uint32_t(queryCount),
+                                 ticks.size()*sizeof(uint64_t),
+                                 ticks.data(),
+                                 sizeof(uint64_t),
+                                 VK_QUERY_RESULT_64_BIT);
+
+  if(r == VK_NOT_READY)
+    return false;
+
+  if(r != VK_SUCCESS)
+  {
+    tpWarning() << "VulkanGPUProfiler: Failed to read query results: " << string_VkResult(r);
+    return true;
+  }
+
+  nanoseconds.resize(queryCount);
+  for(size_t i=0; i<queryCount; i++)
+    nanoseconds[i] = uint64_t(double(ticks[i] & d->validMask) * d->timestampPeriod);
+
+  return true;
+}
+
+}
@@ -0,0 +1,722 @@
+#include "tp_maps_sdl/VulkanPipelineCache.h"
+#include "tp_maps_sdl/CacheFile.h"
+#include "tp_maps_sdl/VulkanShaderCache.h"
+#include "tp_maps_sdl/Trace.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <SDL2/SDL.h>
+
+#include <vulkan/vulkan/vk_enum_string_helper.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+constexpr uint32_t descriptionsMagic = 0x4c507074; // "tpPL"
+constexpr uint32_t descriptionsVersion = 1;
+
+//##################################################################################################
+template<typename T>
+void writeValue(std::string& out, const T& value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//##################################################################################################
+void writeString(std::string& out, const std::string& value)
+{
+  writeValue(out, uint32_t(value.size()));
+  out.append(value);
+}
+
+//##################################################################################################
+template<typename T>
+void writeVector(std::string& out, const std::vector<T>& values)
+{
+  writeValue(out, uint32_t(values.size()));
+  for(const auto& value : values)
+    writeValue(out, value);
+}
+
+//##################################################################################################
+void writeDescription(std::string& out, const VulkanPipelineDescription& description)
+{
+  writeString(out, description.vertexShader);
+  writeString(out, description.fragmentShader);
+  writeVector(out, description.bindings);
+  writeVector(out, description.attributes);
+  writeValue(out, uint32_t(description.topology));
+  writeValue(out, uint32_t(description.cullMode));
+  writeValue(out, uint8_t(description.depthTest));
+  writeValue(out, uint8_t(description.depthWrite));
+  writeValue(out, uint8_t(description.blend));
+  writeString(out, description.layout);
+}
+
+//##################################################################################################
+//! Reads back what the write functions produced, ok is cleared on the first short read.
+struct Reader
+{
+  const std::string& data;
+  size_t pos{0};
+  bool ok{true};
+
+  //################################################################################################
+  Reader(const std::string& data_):
+    data(data_)
+  {
+
+  }
+
+  //################################################################################################
+  template<typename T>
+  T value()
+  {
+    T result{};
+    if(!ok || data.size()-pos < sizeof(T))
+    {
+      ok = false;
+      return result;
+    }
+    std::memcpy(&result, data.data()+pos, sizeof(T));
+    pos += sizeof(T);
+    return result;
+  }
+
+  //################################################################################################
+  std::string string()
+  {
+    auto size = value<uint32_t>();
+    if(!ok || data.size()-pos < size)
+    {
+      ok = false;
+      return std::string();
+    }
+    pos += size;
+    return data.substr(pos-size, size);
+  }
+
+  //################################################################################################
+  template<typename T>
+  std::vector<T> vector()
+  {
+    std::vector<T> result;
+    auto size = value<uint32_t>();
+    if(!ok || (data.size()-pos)/sizeof(T) < size)
+    {
+      ok = false;
+      return result;
+    }
+    result.reserve(size);
+    for(uint32_t i=0; i<size; i++)
+      result.push_back(value<T>());
+    return result;
+  }
+
+  //################################################################################################
+  VulkanPipelineDescription description()
+  {
+    VulkanPipelineDescription description;
+    description.vertexShader = string();
+    description.fragmentShader = string();
+    description.bindings = vector<VkVertexInputBindingDescription>();
+    description.attributes = vector<VkVertexInputAttributeDescription>();
+    description.topology = VkPrimitiveTopology(value<uint32_t>());
+    description.cullMode = VkCullModeFlags(value<uint32_t>());
+    description.depthTest = value<uint8_t>();
+    description.depthWrite = value<uint8_t>();
+    description.blend = value<uint8_t>();
+    description.layout = string();
+    return description;
+  }
+};
+
+//##################################################################################################
+std::string readFile(const std::filesystem::path& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if(!in)
+    return std::string();
+  return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+}
+
+//##################################################################################################
+struct VulkanPipelineCache::Private
+{
+  VulkanPipelineCacheParams params;
+  LayoutFunction layoutFunction;
+
+  VkPipelineCache pipelineCache{VK_NULL_HANDLE};
+
+  //################################################################################################
+  enum class State
+  {
+    Queued,
+    Building,
+    Built,
+    Failed
+  };
+
+  //################################################################################################
+  struct Entry
+  {
+    VulkanPipelineDescription description;
+    VkPipelineLayout layout{VK_NULL_HANDLE};
+    State state{State::Queued};
+    VkPipeline pipeline{VK_NULL_HANDLE};
+  };
+
+  mutable std::mutex mutex;
+  std::condition_variable workCondition;
+  std::condition_variable doneCondition;
+  bool quit{false};
+  std::vector<std::thread> workers;
+
+  std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+  std::deque<Entry*> queue;
+  size_t building{0};
+
+  // Counts for progress(), reset whenever new work is queued after everything has finished.
+  size_t batchQueued{0};
+  size_t batchFinished{0};
+
+  std::map<std::string, VulkanPipelineDescription> recorded;
+  std::vector<VulkanPipelineDescription> previous;
+
+  VulkanPipelineCacheStats stats;
+
+  //################################################################################################
+  Private(const VulkanPipelineCacheParams& params_):
+    params(params_)
+  {
+    if(params.threadCount==0)
+    {
+      auto n = size_t(std::thread::hardware_concurrency());
+      params.threadCount = (n>1)?n-1:1;
+    }
+
+    if(params.cacheDirectory.empty())
+    {
+      if(char* path = SDL_GetPrefPath("tp_maps_sdl", "pipelines"); path)
+      {
+        params.cacheDirectory = path;
+        SDL_free(path);
+      }
+    }
+
+    std::string initialData;
+    if(!params.cacheDirectory.empty())
+    {
+      std::error_code ec;
+      std::filesystem::create_directories(params.cacheDirectory, ec);
+
+      initialData = readFile(cachePath());
+      if(!initialDataMatchesDevice(initialData))
+        initialData.clear();
+
+      loadDescriptions();
+    }
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.data();
+    if(auto r=vkCreatePipelineCache(params.device, &createInfo, nullptr, &pipelineCache); r != VK_SUCCESS)
+    {
+      tpWarning() << "VulkanPipelineCache: Failed to create pipeline cache: " << string_VkResult(r);
+      pipelineCache = VK_NULL_HANDLE;
+    }
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    stopWorkers();
+
+    for(const auto& i : entries)
+      vkDestroyPipeline(params.device, i.second->pipeline, nullptr);
+
+    vkDestroyPipelineCache(params.device, pipelineCache, nullptr);
+  }
+
+  //################################################################################################
+  std::filesystem::path cachePath() const
+  {
+    return std::filesystem::path(params.cacheDirectory) / "pipeline_cache.bin";
+  }
+
+  //################################################################################################
+  std::filesystem::path descriptionsPath() const
+  {
+    return std::filesystem::path(params.cacheDirectory) / "pipelines.bin";
+  }
+
+  //################################################################################################
+  //! Drivers should reject data from another device but not all of them do.
+  bool initialDataMatchesDevice(const std::string& data) const
+  {
+    VkPipelineCacheHeaderVersionOne header;
+    if(data.size()<sizeof(header))
+      return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(params.physicalDevice, &properties);
+
+    return
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID &&
+        header.deviceID == properties.deviceID &&
+        std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+  }
+
+  //################################################################################################
+  void loadDescriptions()
+  {
+    auto data = readFile(descriptionsPath());
+    if(data.empty())
+      return;
+
+    Reader reader(data);
+    if(reader.value<uint32_t>() != descriptionsMagic || reader.value<uint32_t>() != descriptionsVersion)
+      return;
+
+    auto count = reader.value<uint32_t>();
+    for(uint32_t i=0; i<count && reader.ok; i++)
+      if(auto description = reader.description(); reader.ok)
+        previous.push_back(std::move(description));
+  }
+
+  //################################################################################################
+  void startWorkers()
+  {
+    if(!workers.empty())
+      return;
+
+    workers.reserve(params.threadCount);
+    for(size_t i=0; i<params.threadCount; i++)
+      workers.emplace_back([this]{workerLoop();});
+  }
+
+  //################################################################################################
+  //! Workers finish the pipeline they are building, anything still queued is abandoned.
+  void stopWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    workCondition.notify_all();
+
+    for(auto& worker : workers)
+      worker.join();
+    workers.clear();
+  }
+
+  //################################################################################################
+  void workerLoop()
+  {
+    // The trace keeps this pointer, workers are told apart by their thread ids.
+    setTraceThreadName("PipelineWorker");
+
+    for(;;)
+    {
+      Entry* entry{nullptr};
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        workCondition.wait(lock, [&]{return quit || !queue.empty();});
+        if(quit)
+          return;
+
+        entry = queue.front();
+        queue.pop_front();
+        entry->state = State::Building;
+        building++;
+      }
+
+      build(entry);
+    }
+  }
+
+  //################################################################################################
+  VkPipelineLayout resolveLayout(const std::string& name) const
+  {
+    LayoutFunction function;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      function = layoutFunction;
+    }
+    return function?function(name):VK_NULL_HANDLE;
+  }
+
+  //################################################################################################
+  //! Call without the lock held after setting the state to Building.
+  void build(Entry* entry)
+  {
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline pipeline = createPipeline(entry->description, entry->layout);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      entry->pipeline = pipeline;
+      entry->state = pipeline?State::Built:State::Failed;
+      building--;
+      batchFinished++;
+      stats.buildMS += ms;
+      if(pipeline)
+        stats.built++;
+      else
+        stats.failed++;
+    }
+    doneCondition.notify_all();
+  }
+
+  //################################################################################################
+  VkPipeline createPipeline(const VulkanPipelineDescription& description, VkPipelineLayout layout)
+  {
+    TraceScope traceScope("buildPipeline", "vulkan");
+
+    if(!params.shaderCache || !layout)
+    {
+      tpWarning() << "VulkanPipelineCache: No shader cache or pipeline layout for: " << description.layout;
+      return VK_NULL_HANDLE;
+    }
+
+    VkShaderModule vertexModule = params.shaderCache->shaderModule(VK_SHADER_STAGE_VERTEX_BIT, description.vertexShader);
+    VkShaderModule fragmentModule = params.shaderCache->shaderModule(VK_SHADER_STAGE_FRAGMENT_BIT, description.fragmentShader);
+    if(!vertexModule || !fragmentModule)
+      return VK_NULL_HANDLE;
+
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertexModule;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragmentModule;
+    stages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInput = {};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = uint32_t(description.bindings.size());
+    vertexInput.pVertexBindingDescriptions = description.bindings.data();
+    vertexInput.vertexAttributeDescriptionCount = uint32_t(description.attributes.size());
+    vertexInput.pVertexAttributeDescriptions = description.attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = description.topology;
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {};
+    rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = description.cullMode;
+    rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterization.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample = {};
+    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = params.sampleCount;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = description.depthTest;
+    depthStencil.depthWriteEnable = description.depthWrite;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    VkPipelineColorBlendAttachmentState blendAttachment = {};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blendAttachment.blendEnable = description.blend;
+    blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlend = {};
+    colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlend.attachmentCount = 1;
+    colorBlend.pAttachments = &blendAttachment;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.stageCount = 2;
+    createInfo.pStages = stages;
+    createInfo.pVertexInputState = &vertexInput;
+    createInfo.pInputAssemblyState = &inputAssembly;
+    createInfo.pViewportState = &viewportState;
+    createInfo.pRasterizationState = &rasterization;
+    createInfo.pMultisampleState = &multisample;
+    createInfo.pDepthStencilState = &depthStencil;
+    createInfo.pColorBlendState = &colorBlend;
+    createInfo.pDynamicState = &dynamicState;
+    createInfo.layout = layout;
+    createInfo.renderPass = params.renderPass;
+    createInfo.subpass = params.subpass;
+
+    // The pipeline cache is internally synchronized so every worker can use it at once.
+    VkPipeline pipeline{VK_NULL_HANDLE};
+    if(auto r=vkCreateGraphicsPipelines(params.device, pipelineCache, 1, &createInfo, nullptr, &pipeline); r != VK_SUCCESS)
+    {
+      tpWarning() << "VulkanPipelineCache: Failed to create pipeline: " << string_VkResult(r);
+      return VK_NULL_HANDLE;
+    }
+
+    return pipeline;
+  }
+};
+
+//##################################################################################################
+VulkanPipelineCache::VulkanPipelineCache(const VulkanPipelineCacheParams& params):
+  d(new Private(params))
+{
+
+}
+
+//##################################################################################################
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+  // The cache data is read once nothing else is using it.
+  d->stopWorkers();
+  save();
+  delete d;
+}
+
+//##################################################################################################
+void VulkanPipelineCache::setLayoutFunction(const LayoutFunction& layoutFunction)
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->layoutFunction = layoutFunction;
+}
+
+//##################################################################################################
+std::string VulkanPipelineCache::descriptionKey(const VulkanPipelineDescription& description)
+{
+  std::string bytes;
+  writeDescription(bytes, description);
+
+  return hashToHex(fnv1a(fnv1aSeed, bytes.data(), bytes.size()));
+}
+
+//##################################################################################################
+std::vector<VulkanPipelineDescription> VulkanPipelineCache::previousDescriptions() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->previous;
+}
+
+//##################################################################################################
+size_t VulkanPipelineCache::warmUp(const std::vector<VulkanPipelineDescription>& descriptions)
+{
+  std::vector<std::pair<std::string, VkPipelineLayout>> resolved;
+  resolved.reserve(descriptions.size());
+  for(const auto& description : descriptions)
+    resolved.emplace_back(descriptionKey(description), d->resolveLayout(description.layout));
+
+  size_t queued=0;
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    if(d->queue.empty() && d->building==0)
+    {
+      d->batchQueued = 0;
+      d->batchFinished = 0;
+    }
+
+    for(size_t i=0; i<descriptions.size(); i++)
+    {
+      auto& entry = d->entries[resolved[i].first];
+      if(entry)
+        continue;
+
+      entry = std::make_unique<Private::Entry>();
+      entry->description = descriptions[i];
+      entry->layout = resolved[i].second;
+      d->queue.push_back(entry.get());
+      queued++;
+    }
+
+    d->batchQueued += queued;
+    d->stats.requested += queued;
+
+    if(queued)
+      d->startWorkers();
+  }
+
+  if(queued)
+    d->workCondition.notify_all();
+
+  return queued;
+}
+
+//##################################################################################################
+VkPipeline VulkanPipelineCache::pipeline(const VulkanPipelineDescription& description)
+{
+  auto key = descriptionKey(description);
+  Private::Entry* entry{nullptr};
+  {
+    std::unique_lock<std::mutex> lock(d->mutex);
+    d->recorded.try_emplace(key, description);
+
+    if(auto i = d->entries.find(key); i != d->entries.end())
+    {
+      entry = i->second.get();
+      switch(entry->state)
+      {
+        case Private::State::Built:
+        case Private::State::Failed:
+          return entry->pipeline;
+
+        case Private::State::Building:
+          d->doneCondition.wait(lock, [&]{return entry->state != Private::State::Building;});
+          return entry->pipeline;
+
+        case Private::State::Queued:
+          // Build it here rather than wait behind everything that was queued before it.
+          d->queue.erase(std::find(d->queue.begin(), d->queue.end(), entry));
+          entry->state = Private::State::Building;
+          d->building++;
+          d->stats.stolen++;
+          break;
+      }
+    }
+  }
+
+  if(!entry)
+  {
+    auto layout = d->resolveLayout(description.layout);
+
+    std::unique_lock<std::mutex> lock(d->mutex);
+    auto& newEntry = d->entries[key];
+    if(newEntry)
+    {
+      // Another thread requested the same pipeline while the layout was resolved.
+      entry = newEntry.get();
+      d->doneCondition.wait(lock, [&]{return entry->state == Private::State::Built || entry->state == Private::State::Failed;});
+      return entry->pipeline;
+    }
+
+    newEntry = std::make_unique<Private::Entry>();
+    entry = newEntry.get();
+    entry->description = description;
+    entry->layout = layout;
+    entry->state = Private::State::Building;
+    d->building++;
+    d->batchQueued++;
+    d->stats.requested++;
+  }
+
+  d->build(entry);
+  return entry->pipeline;
+}
+
+//##################################################################################################
+VkPipeline VulkanPipelineCache::tryPipeline(const VulkanPipelineDescription& description)
+{
+  auto key = descriptionKey(description);
+  std::lock_guard<std::mutex> lock(d->mutex);
+  if(auto i = d->entries.find(key); i != d->entries.end() && i->second->state == Private::State::Built)
+    return i->second->pipeline;
+  return VK_NULL_HANDLE;
+}
+
+//##################################################################################################
+float VulkanPipelineCache::progress() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return (d->batchQueued==0)?1.0f:float(d->batchFinished)/float(d->batchQueued);
+}
+
+//##################################################################################################
+size_t VulkanPipelineCache::pending() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->queue.size() + d->building;
+}
+
+//##################################################################################################
+void VulkanPipelineCache::waitAll()
+{
+  std::unique_lock<std::mutex> lock(d->mutex);
+  d->doneCondition.wait(lock, [&]{return d->queue.empty() && d->building==0;});
+}
+
+//##################################################################################################
+void VulkanPipelineCache::save()
+{
+  if(d->params.cacheDirectory.empty())
+    return;
+
+  //-- Pipeline cache ------------------------------------------------------------------------------
+  if(d->pipelineCache)
+  {
+    size_t size=0;
+    vkGetPipelineCacheData(d->params.device, d->pipelineCache, &size, nullptr);
+
+    std::string data(size, '\0');
+    if(size>0 && vkGetPipelineCacheData(d->params.device, d->pipelineCache, &size, data.data()) == VK_SUCCESS)
+    {
+      data.resize(size);
+      writeFileAtomic(d->cachePath(), data);
+    }
+  }
+
+  //-- Recorded descriptions -----------------------------------------------------------------------
+  {
+    std::string data;
+    {
+      std::lock_guard<std::mutex> lock(d->mutex);
+
+      // Keep the previous list if nothing was rendered this time.
+      if(d->recorded.empty())
+        return;
+
+      writeValue(data, descriptionsMagic);
+      writeValue(data, descriptionsVersion);
+      writeValue(data, uint32_t(d->recorded.size()));
+      for(const auto& i : d->recorded)
+        writeDescription(data, i.second);
+    }
+
+    writeFileAtomic(d->descriptionsPath(), data);
+  }
+}
+
+//##################################################################################################
+VulkanPipelineCacheStats VulkanPipelineCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->stats;
+}
+
+}
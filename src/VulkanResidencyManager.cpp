@@ -0,0 +1,244 @@
+#include "tp_maps_sdl/VulkanResidencyManager.h"
+#include "tp_maps_sdl/Vulkan.h"
+#include "tp_maps_sdl/Trace.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanResidencyManager::Private
+{
+  Vulkan* vulkan;
+
+  //################################################################################################
+  struct Texture
+  {
+    uint32_t heapIndex{0};
+    VkDeviceSize bytes{0};
+    size_t lastUsed{0};
+    DemoteFunction demote;
+    EvictFunction evict;
+  };
+
+  std::unordered_map<size_t, Texture> textures;
+  size_t nextID{1};
+  size_t frame{0};
+
+  float targetFraction{0.9f};
+  size_t minIdleFrames{3};
+
+  //! Textures used within this many frames may still be referenced by command buffers on the GPU.
+  size_t framesInFlight{1};
+
+  VulkanResidencyStats stats;
+
+  //################################################################################################
+  Private(Vulkan* vulkan_):
+    vulkan(vulkan_),
+    framesInFlight(std::max(size_t(1), size_t(vulkan->attachmentConfig().imageCount)))
+  {
+
+  }
+
+  //################################################################################################
+  VkDeviceSize trackedBytes(uint32_t heapIndex) const
+  {
+    VkDeviceSize bytes=0;
+    for(const auto& i : textures)
+      if(i.second.heapIndex == heapIndex)
+        bytes += i.second.bytes;
+    return bytes;
+  }
+
+  //################################################################################################
+  //! Demote the least recently used textures a mip at a time, evicting those with nothing left to drop.
+  VkDeviceSize release(uint32_t heapIndex, VkDeviceSize bytes, size_t idleFrames)
+  {
+    std::vector<std::pair<size_t, size_t>> candidates;
+    for(const auto& i : textures)
+      if(i.second.heapIndex == heapIndex && frame-i.second.lastUsed >= idleFrames)
+        candidates.emplace_back(i.second.lastUsed, i.first);
+
+    std::sort(candidates.begin(), candidates.end());
+
+    // Each round drops one mip from every candidate so old textures lose detail before any are evicted.
+    VkDeviceSize released=0;
+    while(released<bytes && !candidates.empty())
+    {
+      for(auto c=candidates.begin(); c!=candidates.end() && released<bytes;)
+      {
+        auto i = textures.find(c->second);
+        if(i == textures.end())
+        {
+          c = candidates.erase(c);
+          continue;
+        }
+
+        VkDeviceSize oldBytes = i->second.bytes;
+        VkDeviceSize newBytes = i->second.demote?i->second.demote():0;
+        if(newBytes>0 && newBytes<oldBytes)
+        {
+          i->second.bytes = newBytes;
+          released += oldBytes - newBytes;
+          stats.demotions++;
+          ++c;
+          continue;
+        }
+
+        // Erase before calling evict() so that it can safely call remove().
+        auto evict = std::move(i->second.evict);
+        textures.erase(i);
+        released += oldBytes;
+        stats.evictions++;
+        c = candidates.erase(c);
+
+        if(evict)
+          evict();
+      }
+    }
+
+    return released;
+  }
+};
+
+//##################################################################################################
+VulkanResidencyManager::VulkanResidencyManager(Vulkan* vulkan):
+  d(new Private(vulkan))
+{
+
+}
+
+//##################################################################################################
+VulkanResidencyManager::~VulkanResidencyManager()
+{
+  delete d;
+}
+
+//##################################################################################################
+size_t VulkanResidencyManager::add(uint32_t heapIndex, VkDeviceSize bytes, const DemoteFunction& demote, const EvictFunction& evict)
+{
+  size_t id = d->nextID++;
+  auto& texture = d->textures[id];
+  texture.heapIndex = heapIndex;
+  texture.bytes = bytes;
+  texture.lastUsed = d->frame;
+  texture.demote = demote;
+  texture.evict = evict;
+  return id;
+}
+
+//##################################################################################################
+void VulkanResidencyManager::remove(size_t id)
+{
+  d->textures.erase(id);
+}
+
+//##################################################################################################
+void VulkanResidencyManager::touch(size_t id)
+{
+  if(auto i = d->textures.find(id); i != d->textures.end())
+    i->second.lastUsed = d->frame;
+}
+
+//##################################################################################################
+void VulkanResidencyManager::resized(size_t id, VkDeviceSize bytes)
+{
+  if(auto i = d->textures.find(id); i != d->textures.end())
+    i->second.bytes = bytes;
+}
+
+//##################################################################################################
+void VulkanResidencyManager::beginFrame()
+{
+  d->frame++;
+}
+
+//##################################################################################################
+VkDeviceSize VulkanResidencyManager::enforce()
+{
+  TraceScope traceScope("enforceResidency", "vulkan");
+
+  VkDeviceSize released=0;
+  bool overBudget=false;
+
+  auto heaps = budget();
+  for(uint32_t h=0; h<heaps.size(); h++)
+  {
+    const auto& heap = heaps.at(h);
+    auto limit = VkDeviceSize(double(heap.budget) * double(d->targetFraction));
+    if(heap.usage <= limit)
+      continue;
+
+    VkDeviceSize over = heap.usage - limit;
+    VkDeviceSize heapReleased = d->release(h, over, std::max(d->minIdleFrames, d->framesInFlight));
+    released += heapReleased;
+
+    if(heapReleased < over)
+      overBudget = true;
+  }
+
+  if(overBudget)
+    d->stats.overBudgetFrames++;
+
+  return released;
+}
+
+//##################################################################################################
+bool VulkanResidencyManager::releaseFromHeap(uint32_t heapIndex, VkDeviceSize bytes)
+{
+  // Even when an allocation has failed, textures in frames still on the GPU can't be released.
+  VkDeviceSize released = d->release(heapIndex, bytes, d->framesInFlight);
+  if(released>0)
+    tpWarning() << "VulkanResidencyManager: Released " << released << " bytes from heap " << heapIndex << ".";
+  return released>0;
+}
+
+//##################################################################################################
+void VulkanResidencyManager::setTargetFraction(float targetFraction)
+{
+  d->targetFraction = std::clamp(targetFraction, 0.0f, 1.0f);
+}
+
+//##################################################################################################
+void VulkanResidencyManager::setMinIdleFrames(size_t minIdleFrames)
+{
+  d->minIdleFrames = minIdleFrames;
+}
+
+//##################################################################################################
+std::vector<VulkanHeapBudget> VulkanResidencyManager::budget() const
+{
+  auto heaps = d->vulkan->memoryBudget();
+  for(uint32_t h=0; h<heaps.size(); h++)
+    if(auto& heap = heaps.at(h); !heap.fromExtension)
+      heap.usage = d->trackedBytes(h);
+  return heaps;
+}
+
+//##################################################################################################
+size_t VulkanResidencyManager::usedBytes() const
+{
+  size_t bytes=0;
+  for(const auto& heap : budget())
+    if(heap.deviceLocal)
+      bytes += size_t(heap.usage);
+  return bytes;
+}
+
+//##################################################################################################
+VulkanResidencyStats VulkanResidencyManager::stats() const
+{
+  auto stats = d->stats;
+  stats.textures = d->textures.size();
+  stats.residentBytes = 0;
+  for(const auto& i : d->textures)
+    stats.residentBytes += i.second.bytes;
+  return stats;
+}
+
+}
@@ -0,0 +1,238 @@
+#include "tp_maps_sdl/VulkanShaderCache.h"
+#include "tp_maps_sdl/CacheFile.h"
+
+#include "tp_utils/DebugUtils.h"
+#include "tp_utils/Resources.h"
+
+#include <SDL2/SDL.h>
+
+#include <vulkan/vulkan/vk_enum_string_helper.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//##################################################################################################
+//! The file extensions that glslangValidator uses to infer the stage.
+const char* stageExtension(VkShaderStageFlagBits stage)
+{
+  switch(stage)
+  {
+    case VK_SHADER_STAGE_VERTEX_BIT:                  return "vert";
+    case VK_SHADER_STAGE_FRAGMENT_BIT:                return "frag";
+    case VK_SHADER_STAGE_COMPUTE_BIT:                 return "comp";
+    case VK_SHADER_STAGE_GEOMETRY_BIT:                return "geom";
+    case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:    return "tesc";
+    case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT: return "tese";
+    default:                                          return "glsl";
+  }
+}
+
+//##################################################################################################
+std::vector<uint32_t> spirvFromBytes(const void* data, size_t size)
+{
+  // SPIR-V is a stream of 32 bit words starting with the magic number.
+  std::vector<uint32_t> result;
+  if(size<4 || (size%4)!=0)
+    return result;
+
+  result.resize(size/4);
+  std::memcpy(result.data(), data, size);
+
+  if(result.front() != 0x07230203)
+    result.clear();
+
+  return result;
+}
+}
+
+//##################################################################################################
+struct VulkanShaderCache::Private
+{
+  Params params;
+
+  // Guards modules and stats, lookups and compilation run without holding it.
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, VkShaderModule> modules;
+
+  VulkanShaderCacheStats stats;
+
+  //################################################################################################
+  Private(const Params& params_):
+    params(params_)
+  {
+    if(params.cacheDirectory.empty())
+    {
+      if(char* path = SDL_GetPrefPath("tp_maps_sdl", "spirv"); path)
+      {
+        params.cacheDirectory = path;
+        SDL_free(path);
+      }
+    }
+
+    std::error_code ec;
+    for(const auto& directory : {params.cacheDirectory, params.exportDirectory})
+      if(!directory.empty())
+        std::filesystem::create_directories(directory, ec);
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    for(const auto& i : modules)
+      vkDestroyShaderModule(params.device, i.second, nullptr);
+  }
+
+  //################################################################################################
+  std::vector<uint32_t> readFile(const std::filesystem::path& path)
+  {
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+      return {};
+
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return spirvFromBytes(bytes.data(), bytes.size());
+  }
+};
+
+//##################################################################################################
+VulkanShaderCache::VulkanShaderCache(const Params& params):
+  d(new Private(params))
+{
+
+}
+
+//##################################################################################################
+VulkanShaderCache::~VulkanShaderCache()
+{
+  delete d;
+}
+
+//##################################################################################################
+std::string VulkanShaderCache::variantHash(VkShaderStageFlagBits stage, const std::string& glsl)
+{
+  // This must be stable across platforms and launches as it names the embedded resources.
+  auto s = uint32_t(stage);
+  uint64_t hash = fnv1a(fnv1aSeed, &s, sizeof(s));
+  hash = fnv1a(hash, glsl.data(), glsl.size());
+  return hashToHex(hash);
+}
+
+//##################################################################################################
+std::vector<uint32_t> VulkanShaderCache::spirv(VkShaderStageFlagBits stage, const std::string& glsl)
+{
+  auto hash = variantHash(stage, glsl);
+
+  //-- Embedded resources --------------------------------------------------------------------------
+  {
+    tp_utils::Resource resource = tp_utils::resource("/tp_maps_sdl/spirv/" + hash + ".spv");
+    if(resource.data && resource.size>0)
+    {
+      if(auto result = spirvFromBytes(resource.data, resource.size); !result.empty())
+      {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        d->stats.resourceHits++;
+        return result;
+      }
+
+      tpWarning() << "VulkanShaderCache: Invalid SPIR-V resource: " << hash;
+    }
+  }
+
+  if(!d->params.exportDirectory.empty())
+  {
+    auto path = std::filesystem::path(d->params.exportDirectory) / (hash + "." + stageExtension(stage));
+    writeFileAtomic(path, glsl);
+  }
+
+  //-- On disk cache -------------------------------------------------------------------------------
+  std::filesystem::path cachePath;
+  if(!d->params.cacheDirectory.empty())
+  {
+    cachePath = std::filesystem::path(d->params.cacheDirectory) / (hash + ".spv");
+    if(auto result = d->readFile(cachePath); !result.empty())
+    {
+      std::lock_guard<std::mutex> lock(d->mutex);
+      d->stats.diskHits++;
+      return result;
+    }
+  }
+
+  //-- Compile at runtime --------------------------------------------------------------------------
+  if(d->params.compile)
+  {
+    if(auto result = d->params.compile(stage, glsl); !result.empty())
+    {
+      {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        d->stats.compiled++;
+      }
+      tpDebug() << "VulkanShaderCache: Compiled " << string_VkShaderStageFlagBits(stage) << " variant " << hash << " at runtime.";
+
+      if(!cachePath.empty())
+        writeFileAtomic(cachePath, std::string(reinterpret_cast<const char*>(result.data()), result.size()*sizeof(uint32_t)));
+
+      return result;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->stats.failed++;
+  }
+  tpWarning() << "VulkanShaderCache: No SPIR-V for " << string_VkShaderStageFlagBits(stage) << " variant " << hash;
+  return {};
+}
+
+//##################################################################################################
+VkShaderModule VulkanShaderCache::shaderModule(VkShaderStageFlagBits stage, const std::string& glsl)
+{
+  auto hash = variantHash(stage, glsl);
+  {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    if(auto i = d->modules.find(hash); i != d->modules.end())
+      return i->second;
+  }
+
+  auto code = spirv(stage, glsl);
+  if(code.empty())
+    return VK_NULL_HANDLE;
+
+  VkShaderModuleCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size()*sizeof(uint32_t);
+  createInfo.pCode = code.data();
+
+  VkShaderModule shaderModule{VK_NULL_HANDLE};
+  if(auto r=vkCreateShaderModule(d->params.device, &createInfo, nullptr, &shaderModule); r != VK_SUCCESS)
+  {
+    tpWarning() << "VulkanShaderCache: Failed to create shader module: " << string_VkResult(r);
+    return VK_NULL_HANDLE;
+  }
+
+  // Another thread may have created the same module while this one was.
+  std::lock_guard<std::mutex> lock(d->mutex);
+  if(auto [i, inserted] = d->modules.emplace(hash, shaderModule); !inserted)
+  {
+    vkDestroyShaderModule(d->params.device, shaderModule, nullptr);
+    return i->second;
+  }
+  return shaderModule;
+}
+
+//##################################################################################################
+VulkanShaderCacheStats VulkanShaderCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(d->mutex);
+  return d->stats;
+}
+
+}
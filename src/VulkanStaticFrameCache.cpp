@@ -0,0 +1,176 @@
+#include "tp_maps_sdl/VulkanStaticFrameCache.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <vulkan/vulkan/vk_enum_string_helper.h>
+
+#include <algorithm>
+
+namespace tp_maps_sdl
+{
+
+//##################################################################################################
+struct VulkanStaticFrameCache::Private
+{
+  Params params;
+  bool enabled{true};
+
+  VkCommandPool commandPool{VK_NULL_HANDLE};
+
+  //################################################################################################
+  struct Image
+  {
+    std::vector<VkCommandBuffer> secondaries;
+
+    //! Stages before this are still valid, stageCount if everything is valid.
+    size_t firstInvalid{0};
+
+    VkRenderPass renderPass{VK_NULL_HANDLE};
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};
+  };
+
+  std::vector<Image> images;
+
+  VulkanStaticFrameCacheStats stats;
+
+  //################################################################################################
+  Private(const Params& params_):
+    params(params_)
+  {
+    params.imageCount = std::max(size_t(1), params.imageCount);
+    params.stageCount = std::max(size_t(1), params.stageCount);
+
+    // Not transient, the command buffers live for as long as their stage stays valid.
+    VkCommandPoolCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    createInfo.queueFamilyIndex = params.queueFamilyIndex;
+    if(auto r=vkCreateCommandPool(params.device, &createInfo, nullptr, &commandPool); r != VK_SUCCESS)
+    {
+      tpWarning() << "VulkanStaticFrameCache: Failed to create command pool: " << string_VkResult(r);
+      return;
+    }
+
+    images.resize(params.imageCount);
+    for(auto& image : images)
+    {
+      image.secondaries.resize(params.stageCount);
+
+      VkCommandBufferAllocateInfo allocateInfo = {};
+      allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocateInfo.commandPool = commandPool;
+      allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocateInfo.commandBufferCount = uint32_t(params.stageCount);
+      vkAllocateCommandBuffers(params.device, &allocateInfo, image.secondaries.data());
+    }
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    vkDestroyCommandPool(params.device, commandPool, nullptr);
+  }
+};
+
+//##################################################################################################
+VulkanStaticFrameCache::VulkanStaticFrameCache(const Params& params):
+  d(new Private(params))
+{
+
+}
+
+//##################################################################################################
+VulkanStaticFrameCache::~VulkanStaticFrameCache()
+{
+  delete d;
+}
+
+//##################################################################################################
+void VulkanStaticFrameCache::setEnabled(bool enabled)
+{
+  d->enabled = enabled;
+  invalidateAll();
+}
+
+//##################################################################################################
+bool VulkanStaticFrameCache::enabled() const
+{
+  return d->enabled;
+}
+
+//##################################################################################################
+void VulkanStaticFrameCache::invalidateFrom(size_t stage)
+{
+  for(auto& image : d->images)
+    image.firstInvalid = std::min(image.firstInvalid, stage);
+}
+
+//##################################################################################################
+void VulkanStaticFrameCache::invalidateAll()
+{
+  invalidateFrom(0);
+}
+
+//##################################################################################################
+bool VulkanStaticFrameCache::isImageValid(size_t image) const
+{
+  if(!d->enabled || d->images.empty())
+    return false;
+
+  return d->images.at(image%d->images.size()).firstInvalid == d->params.stageCount;
+}
+
+//##################################################################################################
+void VulkanStaticFrameCache::execute(size_t imageIndex,
+                                     VkCommandBuffer primary,
+                                     const VkCommandBufferInheritanceInfo& inheritance,
+                                     const RecordFunction& record)
+{
+  if(d->images.empty())
+    return;
+
+  auto& image = d->images.at(imageIndex%d->images.size());
+
+  if(!d->enabled)
+    image.firstInvalid = 0;
+
+  if(image.renderPass != inheritance.renderPass || image.framebuffer != inheritance.framebuffer)
+  {
+    image.renderPass = inheritance.renderPass;
+    image.framebuffer = inheritance.framebuffer;
+    image.firstInvalid = 0;
+  }
+
+  if(image.firstInvalid == d->params.stageCount)
+    d->stats.reusedFrames++;
+
+  d->stats.reusedStages += image.firstInvalid;
+
+  for(size_t stage=image.firstInvalid; stage<d->params.stageCount; stage++)
+  {
+    VkCommandBuffer commandBuffer = image.secondaries[stage];
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    record(commandBuffer, stage);
+    vkEndCommandBuffer(commandBuffer);
+
+    d->stats.recordedStages++;
+  }
+
+  image.firstInvalid = d->params.stageCount;
+
+  vkCmdExecuteCommands(primary, uint32_t(image.secondaries.size()), image.secondaries.data());
+}
+
+//##################################################################################################
+VulkanStaticFrameCacheStats VulkanStaticFrameCache::stats() const
+{
+  return d->stats;
+}
+
+}
@@ -0,0 +1,665 @@
+#include "tp_maps_sdl/VulkanUploader.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <vulkan/vulkan/vk_enum_string_helper.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <cstring>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+//! The number of transfer submissions that can be in flight at once.
+constexpr size_t batchCount=4;
+
+//! The number of completed batches used to calculate the rolling throughput.
+constexpr size_t throughputWindow=64;
+}
+
+//##################################################################################################
+struct VulkanUploader::Private
+{
+  Params params;
+
+  bool ok{true};
+  bool dedicated{false};
+
+  VkDeviceSize alignment{16};
+
+  VkBuffer ringBuffer{VK_NULL_HANDLE};
+  VkDeviceMemory ringMemory{VK_NULL_HANDLE};
+  uint8_t* ringData{nullptr};
+
+  // Monotonic byte counters, the offset into the ring is counter%ringSize.
+  VkDeviceSize head{0};
+  VkDeviceSize tail{0};
+
+  VkCommandPool commandPool{VK_NULL_HANDLE};
+
+  //################################################################################################
+  struct Batch
+  {
+    VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+    VkFence fence{VK_NULL_HANDLE};
+    VkSemaphore semaphore{VK_NULL_HANDLE};
+
+    VkDeviceSize ringEnd{0};
+    size_t bytes{0};
+    std::chrono::steady_clock::time_point submitTime;
+
+    bool recording{false};
+    bool inFlight{false};
+
+    //! True if the semaphore has been signaled but the graphics queue has not waited on it yet.
+    bool semaphorePending{false};
+
+    std::vector<VkBufferMemoryBarrier> bufferAcquires;
+    std::vector<VkImageMemoryBarrier> imageAcquires;
+  };
+
+  std::vector<Batch> batches;
+  std::deque<size_t> inFlight;
+  size_t current{batchCount};
+
+  //! Batches that have been submitted but not yet acquired by the graphics queue.
+  std::vector<size_t> pendingAcquire;
+
+  VulkanUploadStats stats;
+  std::deque<std::pair<size_t, double>> throughputSamples;
+
+  //################################################################################################
+  Private(const Params& params_):
+    params(params_)
+  {
+    dedicated = params.transferQueueFamilyIndex != params.graphicsQueueFamilyIndex;
+    stats.dedicatedTransferQueue = dedicated;
+
+    //-- Alignment ---------------------------------------------------------------------------------
+    {
+      VkPhysicalDeviceProperties properties;
+      vkGetPhysicalDeviceProperties(params.physicalDevice, &properties);
+      alignment = std::max(alignment, properties.limits.optimalBufferCopyOffsetAlignment);
+      alignment = std::max(alignment, properties.limits.nonCoherentAtomSize);
+    }
+
+    //-- Create Staging Ring -----------------------------------------------------------------------
+    if(!createRing())
+    {
+      ok = false;
+      return;
+    }
+
+    //-- Create Command Pool -----------------------------------------------------------------------
+    {
+      VkCommandPoolCreateInfo createInfo = {};
+      createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      createInfo.queueFamilyIndex = params.transferQueueFamilyIndex;
+      vkCreateCommandPool(params.device, &createInfo, nullptr, &commandPool);
+    }
+
+    //-- Create Batches ----------------------------------------------------------------------------
+    {
+      batches.resize(batchCount);
+
+      std::vector<VkCommandBuffer> commandBuffers(batchCount);
+      VkCommandBufferAllocateInfo allocateInfo = {};
+      allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocateInfo.commandPool = commandPool;
+      allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocateInfo.commandBufferCount = uint32_t(batchCount);
+      vkAllocateCommandBuffers(params.device, &allocateInfo, commandBuffers.data());
+
+      for(size_t i=0; i<batchCount; i++)
+      {
+        auto& batch = batches[i];
+        batch.commandBuffer = commandBuffers[i];
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        vkCreateFence(params.device, &fenceInfo, nullptr, &batch.fence);
+
+        if(dedicated)
+          createSemaphore(batch.semaphore);
+      }
+    }
+  }
+
+  //################################################################################################
+  ~Private()
+  {
+    if(!params.device)
+      return;
+
+    for(auto i : inFlight)
+      vkWaitForFences(params.device, 1, &batches[i].fence, VK_TRUE, UINT64_MAX);
+
+    for(auto& batch : batches)
+    {
+      vkDestroySemaphore(params.device, batch.semaphore, nullptr);
+      vkDestroyFence(params.device, batch.fence, nullptr);
+    }
+
+    vkDestroyCommandPool(params.device, commandPool, nullptr);
+
+    destroyRing();
+  }
+
+  //################################################################################################
+  bool createRing()
+  {
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = params.ringSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(auto r=vkCreateBuffer(params.device, &bufferInfo, nullptr, &ringBuffer); r != VK_SUCCESS)
+    {
+      tpWarning() << "Failed to create staging ring buffer: " << string_VkResult(r);
+      destroyRing();
+      return false;
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(params.device, ringBuffer, &memRequirements);
+
+    uint32_t memoryTypeIndex=0;
+    if(!findMemoryType(memRequirements.memoryTypeBits,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                       memoryTypeIndex))
+    {
+      tpWarning() << "Failed to find host visible memory for the staging ring buffer.";
+      destroyRing();
+      return false;
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    if(auto r=vkAllocateMemory(params.device, &allocInfo, nullptr, &ringMemory); r != VK_SUCCESS)
+    {
+      tpWarning() << "Failed to allocate staging ring memory: " << string_VkResult(r);
+      destroyRing();
+      return false;
+    }
+
+    vkBindBufferMemory(params.device, ringBuffer, ringMemory, 0);
+
+    void* mapped=nullptr;
+    if(auto r=vkMapMemory(params.device, ringMemory, 0, VK_WHOLE_SIZE, 0, &mapped); r != VK_SUCCESS)
+    {
+      tpWarning() << "Failed to map staging ring memory: " << string_VkResult(r);
+      destroyRing();
+      return false;
+    }
+    ringData = static_cast<uint8_t*>(mapped);
+    return true;
+  }
+
+  //################################################################################################
+  void destroyRing()
+  {
+    if(ringData)
+      vkUnmapMemory(params.device, ringMemory);
+    vkDestroyBuffer(params.device, ringBuffer, nullptr);
+    vkFreeMemory(params.device, ringMemory, nullptr);
+    ringData = nullptr;
+    ringBuffer = VK_NULL_HANDLE;
+    ringMemory = VK_NULL_HANDLE;
+  }
+
+  //################################################################################################
+  bool findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, uint32_t& index)
+  {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(params.physicalDevice, &memProperties);
+
+    for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+      if((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      {
+        index = i;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  //################################################################################################
+  void createSemaphore(VkSemaphore& semaphore)
+  {
+    VkSemaphoreCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    vkCreateSemaphore(params.device, &createInfo, nullptr, &semaphore);
+  }
+
+  //################################################################################################
+  //! Retire batches in submission order, if wait is true block on the oldest one.
+  bool retire(bool wait)
+  {
+    bool retired=false;
+    while(!inFlight.empty())
+    {
+      auto& batch = batches[inFlight.front()];
+
+      if(wait && !retired)
+      {
+        if(vkGetFenceStatus(params.device, batch.fence) == VK_NOT_READY)
+          stats.stallCount++;
+        vkWaitForFences(params.device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+      }
+      else if(vkGetFenceStatus(params.device, batch.fence) != VK_SUCCESS)
+        break;
+
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch.submitTime).count();
+      throughputSamples.emplace_back(batch.bytes, seconds);
+      while(throughputSamples.size()>throughputWindow)
+        throughputSamples.pop_front();
+
+      tail = batch.ringEnd;
+      batch.inFlight = false;
+      inFlight.pop_front();
+      retired = true;
+    }
+
+    return retired;
+  }
+
+  //################################################################################################
+  Batch* currentBatch()
+  {
+    if(current<batchCount)
+      return &batches[current];
+
+    for(;;)
+    {
+      for(size_t i=0; i<batchCount; i++)
+      {
+        auto& batch = batches[i];
+        if(batch.inFlight)
+          continue;
+
+        // The semaphore from the last use of this batch was never waited on, so it can't be
+        // signaled again. The signal operation has completed so the semaphore can be replaced.
+        if(batch.semaphorePending)
+        {
+          tpWarning() << "VulkanUploader: Upload semaphore was not consumed by the graphics queue.";
+          vkDestroySemaphore(params.device, batch.semaphore, nullptr);
+          createSemaphore(batch.semaphore);
+          batch.semaphorePending = false;
+          pendingAcquire.erase(std::remove(pendingAcquire.begin(), pendingAcquire.end(), i), pendingAcquire.end());
+        }
+
+        vkResetFences(params.device, 1, &batch.fence);
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+        batch.recording = true;
+        batch.bytes = 0;
+        batch.bufferAcquires.clear();
+        batch.imageAcquires.clear();
+        current = i;
+        return &batch;
+      }
+
+      retire(true);
+    }
+  }
+
+  //################################################################################################
+  //! Reserve space in the ring, returns false if size can never fit.
+  bool allocate(VkDeviceSize size, VkDeviceSize& offset)
+  {
+    if(size>params.ringSize)
+    {
+      tpWarning() << "VulkanUploader: Upload of " << size << " bytes exceeds the staging ring size.";
+      return false;
+    }
+
+    // The ring is released under memory pressure and created again on the next upload.
+    if(!ringData && !createRing())
+      return false;
+
+    for(;;)
+    {
+      VkDeviceSize start = ((head + alignment - 1) / alignment) * alignment;
+
+      // Don't let an allocation straddle the end of the ring.
+      if((start%params.ringSize) + size > params.ringSize)
+        start += params.ringSize - (start%params.ringSize);
+
+      if(start + size - tail <= params.ringSize)
+      {
+        head = start + size;
+        offset = start%params.ringSize;
+        return true;
+      }
+
+      if(retire(false))
+        continue;
+
+      if(!inFlight.empty())
+      {
+        retire(true);
+        continue;
+      }
+
+      // Anything recorded in the current batch must be submitted before we can wait on it.
+      if(current<batchCount)
+      {
+        flush();
+        continue;
+      }
+
+      // Nothing is in use so the space skipped at the end of the ring can be released as well.
+      tail = start;
+    }
+  }
+
+  //################################################################################################
+  void copyToRing(VkDeviceSize offset, const void* data, VkDeviceSize size)
+  {
+    std::memcpy(ringData+offset, data, size_t(size));
+    stats.bytesUploaded += size_t(size);
+    stats.uploadCount++;
+  }
+
+  //################################################################################################
+  void flush()
+  {
+    if(current>=batchCount)
+      return;
+
+    auto& batch = batches[current];
+    current = batchCount;
+
+    vkEndCommandBuffer(batch.commandBuffer);
+    batch.recording = false;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    if(dedicated)
+    {
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = &batch.semaphore;
+    }
+
+    batch.ringEnd = head;
+    batch.submitTime = std::chrono::steady_clock::now();
+
+    if(auto r=vkQueueSubmit(params.transferQueue, 1, &submitInfo, batch.fence); r != VK_SUCCESS)
+    {
+      tpWarning() << "VulkanUploader: Failed to submit uploads: " << string_VkResult(r);
+      return;
+    }
+
+    batch.inFlight = true;
+    inFlight.push_back(size_t(&batch - batches.data()));
+    stats.batchCount++;
+
+    if(dedicated)
+    {
+      batch.semaphorePending = true;
+      pendingAcquire.push_back(inFlight.back());
+    }
+  }
+
+  //################################################################################################
+  //! Ownership is released to the graphics family or made visible on the same queue.
+  void addBufferRelease(Batch& batch, VkBuffer dst, VkDeviceSize dstOffset, VkDeviceSize size)
+  {
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.buffer = dst;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    if(dedicated)
+    {
+      barrier.srcQueueFamilyIndex = params.transferQueueFamilyIndex;
+      barrier.dstQueueFamilyIndex = params.graphicsQueueFamilyIndex;
+      barrier.dstAccessMask = 0;
+      vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = dstAccess;
+      batch.bufferAcquires.push_back(barrier);
+    }
+    else
+    {
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstAccessMask = dstAccess;
+      vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+  }
+
+  //################################################################################################
+  void addImageRelease(Batch& batch, VkImage dst, VkImageLayout finalLayout)
+  {
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = finalLayout;
+    barrier.image = dst;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    if(dedicated)
+    {
+      barrier.srcQueueFamilyIndex = params.transferQueueFamilyIndex;
+      barrier.dstQueueFamilyIndex = params.graphicsQueueFamilyIndex;
+      barrier.dstAccessMask = 0;
+      vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      batch.imageAcquires.push_back(barrier);
+    }
+    else
+    {
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+  }
+};
+
+//##################################################################################################
+VulkanUploader::VulkanUploader(const Params& params):
+  d(new Private(params))
+{
+
+}
+
+//##################################################################################################
+VulkanUploader::~VulkanUploader()
+{
+  delete d;
+}
+
+//##################################################################################################
+bool VulkanUploader::isValid() const
+{
+  return d->ok;
+}
+
+//##################################################################################################
+bool VulkanUploader::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+  if(!d->ok || size==0)
+    return false;
+
+  VkDeviceSize offset=0;
+  if(!d->allocate(size, offset))
+    return false;
+
+  d->copyToRing(offset, data, size);
+
+  auto batch = d->currentBatch();
+  batch->bytes += size_t(size);
+
+  VkBufferCopy region = {};
+  region.srcOffset = offset;
+  region.dstOffset = dstOffset;
+  region.size = size;
+  vkCmdCopyBuffer(batch->commandBuffer, d->ringBuffer, dst, 1, &region);
+
+  d->addBufferRelease(*batch, dst, dstOffset, size);
+  return true;
+}
+
+//##################################################################################################
+bool VulkanUploader::uploadImage(VkImage dst,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 const void* data,
+                                 VkDeviceSize size,
+                                 VkImageLayout finalLayout)
+{
+  if(!d->ok || size==0)
+    return false;
+
+  VkDeviceSize offset=0;
+  if(!d->allocate(size, offset))
+    return false;
+
+  d->copyToRing(offset, data, size);
+
+  auto batch = d->currentBatch();
+  batch->bytes += size_t(size);
+
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = dst;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  VkBufferImageCopy region = {};
+  region.bufferOffset = offset;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {width, height, 1};
+  vkCmdCopyBufferToImage(batch->commandBuffer, d->ringBuffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  d->addImageRelease(*batch, dst, finalLayout);
+  return true;
+}
+
+//##################################################################################################
+void VulkanUploader::flush()
+{
+  d->flush();
+  d->retire(false);
+}
+
+//##################################################################################################
+void VulkanUploader::takeGraphicsWait(VkCommandBuffer graphicsCommandBuffer,
+                                      std::vector<VkSemaphore>& waitSemaphores,
+                                      std::vector<VkPipelineStageFlags>& waitStages)
+{
+  if(!d->dedicated)
+    return;
+
+  std::vector<VkBufferMemoryBarrier> bufferAcquires;
+  std::vector<VkImageMemoryBarrier> imageAcquires;
+
+  for(auto i : d->pendingAcquire)
+  {
+    auto& batch = d->batches[i];
+    bufferAcquires.insert(bufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+    imageAcquires.insert(imageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+    waitSemaphores.push_back(batch.semaphore);
+    waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    batch.semaphorePending = false;
+  }
+  d->pendingAcquire.clear();
+
+  if(bufferAcquires.empty() && imageAcquires.empty())
+    return;
+
+  vkCmdPipelineBarrier(graphicsCommandBuffer,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       0,
+                       0, nullptr,
+                       uint32_t(bufferAcquires.size()), bufferAcquires.data(),
+                       uint32_t(imageAcquires.size()), imageAcquires.data());
+}
+
+//##################################################################################################
+void VulkanUploader::waitIdle()
+{
+  d->flush();
+  for(auto i : d->inFlight)
+    vkWaitForFences(d->params.device, 1, &d->batches[i].fence, VK_TRUE, UINT64_MAX);
+  d->retire(false);
+}
+
+//##################################################################################################
+size_t VulkanUploader::releaseStagingMemory()
+{
+  if(!d->ringData)
+    return 0;
+
+  d->flush();
+  while(!d->inFlight.empty())
+    d->retire(true);
+
+  d->destroyRing();
+  d->head = 0;
+  d->tail = 0;
+  return size_t(d->params.ringSize);
+}
+
+//##################################################################################################
+VulkanUploadStats VulkanUploader::stats() const
+{
+  VulkanUploadStats stats = d->stats;
+
+  size_t bytes=0;
+  double seconds=0.0;
+  for(const auto& sample : d->throughputSamples)
+  {
+    bytes += sample.first;
+    seconds += sample.second;
+  }
+
+  if(seconds>0.0)
+    stats.throughputMBps = (double(bytes) / (1024.0*1024.0)) / seconds;
+
+  return stats;
+}
+
+}
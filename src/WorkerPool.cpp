@@ -0,0 +1,368 @@
+#include "tp_maps_sdl/WorkerPool.h"
+#include "tp_maps_sdl/Trace.h"
+
+#include "tp_utils/DebugUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace tp_maps_sdl
+{
+
+namespace
+{
+constexpr size_t priorityCount=3;
+
+//! Lets run() called from inside a job push to the queue of the worker that is running it.
+thread_local const void* currentPool{nullptr};
+thread_local size_t currentWorker{0};
+
+//##################################################################################################
+//! One per hardware thread less the main thread, hardware_concurrency() may return 0 if unknown.
+size_t defaultThreadCount()
+{
+  auto n = size_t(std::thread::hardware_concurrency());
+  return (n>1)?n-1:1;
+}
+}
+
+//##################################################################################################
+struct WorkerPool::Private
+{
+  const size_t threadCount;
+
+  //################################################################################################
+  struct Job
+  {
+    uint64_t id{0};
+    std::function<void()> work;
+    std::function<void()> done;
+  };
+
+  //################################################################################################
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Job> jobs[priorityCount];
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> nextQueue{0};
+
+  // Workers sleep on this when there is nothing queued.
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::atomic<size_t> queued{0};
+  bool quit{false};
+
+  // Jobs that have not been delivered yet, true if cancelled.
+  mutable std::mutex stateMutex;
+  std::unordered_map<uint64_t, bool> live;
+  std::atomic<uint64_t> nextID{1};
+
+  std::mutex completedMutex;
+  std::deque<Job> completed;
+
+  double completionBudgetMS{4.0};
+
+  std::atomic<size_t> running{0};
+  std::atomic<size_t> stolen{0};
+  std::atomic<size_t> cancelled{0};
+
+  //################################################################################################
+  Private(size_t threadCount_):
+    threadCount(threadCount_)
+  {
+    queues.resize(threadCount);
+    for(auto& queue : queues)
+      queue = std::make_unique<Queue>();
+  }
+
+  //################################################################################################
+  void start()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!workers.empty() || quit)
+      return;
+
+    workers.reserve(threadCount);
+    for(size_t i=0; i<threadCount; i++)
+      workers.emplace_back([this, i]{workerLoop(i);});
+  }
+
+  //################################################################################################
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quit = true;
+    }
+    condition.notify_all();
+
+    for(auto& worker : workers)
+      worker.join();
+    workers.clear();
+  }
+
+  //################################################################################################
+  void push(Job&& job, WorkPriority priority)
+  {
+    size_t q = (currentPool==this)?currentWorker:(nextQueue++ % queues.size());
+    {
+      auto& queue = *queues.at(q);
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs[size_t(priority)].push_back(std::move(job));
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queued++;
+    }
+    condition.notify_one();
+  }
+
+  //################################################################################################
+  //! Take the highest priority job, from our own queue first then from the back of the others.
+  bool take(size_t worker, Job& job)
+  {
+    for(size_t p=priorityCount; p>0; p--)
+    {
+      for(size_t i=0; i<queues.size(); i++)
+      {
+        size_t q = (worker+i) % queues.size();
+        auto& queue = *queues[q];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        auto& jobs = queue.jobs[p-1];
+        if(jobs.empty())
+          continue;
+
+        if(i==0)
+        {
+          job = std::move(jobs.front());
+          jobs.pop_front();
+        }
+        else
+        {
+          job = std::move(jobs.back());
+          jobs.pop_back();
+          stolen++;
+        }
+
+        queued--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //################################################################################################
+  void workerLoop(size_t worker)
+  {
+    currentPool = this;
+    currentWorker = worker;
+    setTraceThreadName("WorkerPool");
+
+    for(;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]{return quit || queued>0;});
+        if(quit)
+          return;
+      }
+
+      Job job;
+      while(take(worker, job))
+      {
+        if(!isCancelled(job.id))
+        {
+          running++;
+          TraceScope traceScope("job", "worker");
+          job.work();
+          running--;
+        }
+
+        job.work = std::function<void()>();
+        std::lock_guard<std::mutex> lock(completedMutex);
+        completed.push_back(std::move(job));
+      }
+    }
+  }
+
+  //################################################################################################
+  bool isCancelled(uint64_t id) const
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto i = live.find(id);
+    return i!=live.end() && i->second;
+  }
+
+  //################################################################################################
+  //! Returns false if the job was cancelled.
+  bool finish(uint64_t id)
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    auto i = live.find(id);
+    if(i==live.end())
+      return true;
+
+    bool ok = !i->second;
+    live.erase(i);
+    return ok;
+  }
+};
+
+//##################################################################################################
+WorkerPool::WorkerPool(size_t threadCount):
+  d(new Private((threadCount>0)?threadCount:defaultThreadCount()))
+{
+
+}
+
+//##################################################################################################
+WorkerPool::~WorkerPool()
+{
+  cancelAll();
+  d->stop();
+  delete d;
+}
+
+//##################################################################################################
+size_t WorkerPool::threadCount() const
+{
+  return d->threadCount;
+}
+
+//##################################################################################################
+uint64_t WorkerPool::run(const std::function<void()>& work,
+                         const std::function<void()>& done,
+                         WorkPriority priority)
+{
+  d->start();
+
+  Private::Job job;
+  job.id = d->nextID++;
+  job.work = work;
+  job.done = done;
+
+  {
+    std::lock_guard<std::mutex> lock(d->stateMutex);
+    d->live[job.id] = false;
+  }
+
+  uint64_t id = job.id;
+  d->push(std::move(job), priority);
+  return id;
+}
+
+//##################################################################################################
+void WorkerPool::post(const std::function<void()>& callback)
+{
+  Private::Job job;
+  job.done = callback;
+  std::lock_guard<std::mutex> lock(d->completedMutex);
+  d->completed.push_back(std::move(job));
+}
+
+//##################################################################################################
+bool WorkerPool::cancel(uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(d->stateMutex);
+  auto i = d->live.find(id);
+  if(i==d->live.end())
+    return false;
+
+  if(!i->second)
+  {
+    i->second = true;
+    d->cancelled++;
+  }
+  return true;
+}
+
+//##################################################################################################
+bool WorkerPool::isCancelled(uint64_t id) const
+{
+  return d->isCancelled(id);
+}
+
+//##################################################################################################
+void WorkerPool::cancelAll()
+{
+  std::lock_guard<std::mutex> lock(d->stateMutex);
+  for(auto& i : d->live)
+  {
+    if(!i.second)
+    {
+      i.second = true;
+      d->cancelled++;
+    }
+  }
+}
+
+//##################################################################################################
+void WorkerPool::setCompletionBudgetMS(double budgetMS)
+{
+  d->completionBudgetMS = budgetMS;
+}
+
+//##################################################################################################
+double WorkerPool::completionBudgetMS() const
+{
+  return d->completionBudgetMS;
+}
+
+//##################################################################################################
+size_t WorkerPool::deliverCompleted()
+{
+  TraceScope traceScope("deliverCompleted", "worker");
+  auto start = std::chrono::steady_clock::now();
+  auto budget = std::chrono::duration<double, std::milli>(d->completionBudgetMS);
+
+  size_t count=0;
+  for(;;)
+  {
+    Private::Job job;
+    {
+      std::lock_guard<std::mutex> lock(d->completedMutex);
+      if(d->completed.empty())
+        break;
+      job = std::move(d->completed.front());
+      d->completed.pop_front();
+    }
+
+    if(!d->finish(job.id) || !job.done)
+      continue;
+
+    job.done();
+    count++;
+
+    if(std::chrono::steady_clock::now()-start >= budget)
+      break;
+  }
+
+  return count;
+}
+
+//##################################################################################################
+WorkerPoolStats WorkerPool::stats() const
+{
+  WorkerPoolStats stats;
+  stats.queued = d->queued;
+  stats.running = d->running;
+  stats.stolen = d->stolen;
+  stats.cancelled = d->cancelled;
+
+  std::lock_guard<std::mutex> lock(d->completedMutex);
+  stats.completed = d->completed.size();
+  return stats;
+}
+
+}
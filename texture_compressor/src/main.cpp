@@ -0,0 +1,128 @@
+#include "tp_maps_sdl/Globals.h"
+#include "tp_maps_sdl/TextureCompression.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_main.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace tp_maps_sdl;
+
+namespace
+{
+//##################################################################################################
+bool parseFormat(const char* name, CompressedTextureFormat& format)
+{
+  for(auto f : {CompressedTextureFormat::BC1,
+                CompressedTextureFormat::BC3,
+                CompressedTextureFormat::ETC2_RGB8,
+                CompressedTextureFormat::ETC2_RGBA8})
+  {
+    if(SDL_strcasecmp(name, compressedTextureFormatToString(f)) == 0)
+    {
+      format = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+//##################################################################################################
+bool imageHasAlpha(const tp_image_utils::ColorMap& image)
+{
+  const TPPixel* p = image.constData();
+  const TPPixel* end = p + image.width()*image.height();
+  for(; p<end; p++)
+    if(p->a != 255)
+      return true;
+  return false;
+}
+}
+
+//##################################################################################################
+//! Usage: tp_maps_sdl_texture_compressor [--format BC1|BC3|ETC2_RGB8|ETC2_RGBA8] [--etc2] [--threads n] files...
+/*!
+Each image is written as a KTX file next to the source with the extension replaced. Without --format
+BC1 or BC3 is used depending on whether the image has any alpha, --etc2 picks the ETC2 equivalents.
+*/
+int main(int argc, char* argv[])
+{
+  CompressedTextureFormat format{CompressedTextureFormat::None};
+  bool etc2=false;
+  size_t threadCount=0;
+  std::vector<std::string> paths;
+
+  for(int i=1; i<argc; i++)
+  {
+    if(std::strcmp(argv[i], "--format")==0 && (i+1)<argc)
+    {
+      if(!parseFormat(argv[++i], format))
+      {
+        fprintf(stderr, "Unknown format: %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if(std::strcmp(argv[i], "--etc2")==0)
+      etc2 = true;
+    else if(std::strcmp(argv[i], "--threads")==0 && (i+1)<argc)
+      threadCount = size_t(std::strtoul(argv[++i], nullptr, 10));
+    else
+      paths.emplace_back(argv[i]);
+  }
+
+  if(paths.empty())
+  {
+    fprintf(stderr, "Usage: %s [--format BC1|BC3|ETC2_RGB8|ETC2_RGBA8] [--etc2] [--threads n] files...\n", argv[0]);
+    return 1;
+  }
+
+  int failed=0;
+  for(const auto& path : paths)
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    auto image = loadTextureFromData(data.data(), data.size(), path);
+    if(image.width()<1 || image.height()<1)
+    {
+      fprintf(stderr, "Failed to load: %s\n", path.c_str());
+      failed++;
+      continue;
+    }
+
+    auto f = format;
+    if(f == CompressedTextureFormat::None)
+    {
+      bool alpha = imageHasAlpha(image);
+      if(etc2)
+        f = alpha?CompressedTextureFormat::ETC2_RGBA8:CompressedTextureFormat::ETC2_RGB8;
+      else
+        f = alpha?CompressedTextureFormat::BC3:CompressedTextureFormat::BC1;
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    auto compressed = compressImage(image, f, threadCount);
+    double ms = double(SDL_GetPerformanceCounter()-start) * 1000.0 / double(SDL_GetPerformanceFrequency());
+
+    auto output = std::filesystem::path(path).replace_extension(".ktx").string();
+    if(!writeKTX(output, compressed))
+    {
+      failed++;
+      continue;
+    }
+
+    printf("%s %zux%zu %s %.1fms -> %s\n",
+           path.c_str(),
+           image.width(),
+           image.height(),
+           compressedTextureFormatToString(f),
+           ms,
+           output.c_str());
+  }
+
+  return failed?1:0;
+}
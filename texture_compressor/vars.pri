@@ -0,0 +1,4 @@
+TARGET = tp_maps_sdl_texture_compressor
+TEMPLATE = app
+
+SOURCES += src/main.cpp
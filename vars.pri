@@ -9,5 +9,83 @@ HEADERS += inc/tp_maps_sdl/Map.h
 SOURCES += src/Vulkan.cpp
 HEADERS += inc/tp_maps_sdl/Vulkan.h
 
+SOURCES += src/VulkanUploader.cpp
+HEADERS += inc/tp_maps_sdl/VulkanUploader.h
+
+SOURCES += src/VulkanCommandRecorder.cpp
+HEADERS += inc/tp_maps_sdl/VulkanCommandRecorder.h
+
+SOURCES += src/VulkanStaticFrameCache.cpp
+HEADERS += inc/tp_maps_sdl/VulkanStaticFrameCache.h
+
+SOURCES += src/VulkanShaderCache.cpp
+HEADERS += inc/tp_maps_sdl/VulkanShaderCache.h
+
+SOURCES += src/VulkanPipelineCache.cpp
+HEADERS += inc/tp_maps_sdl/VulkanPipelineCache.h
+
+SOURCES += src/VulkanBatchRenderer.cpp
+HEADERS += inc/tp_maps_sdl/VulkanBatchRenderer.h
+
+SOURCES += src/VulkanResidencyManager.cpp
+HEADERS += inc/tp_maps_sdl/VulkanResidencyManager.h
+
 SOURCES += src/Globals.cpp
 HEADERS += inc/tp_maps_sdl/Globals.h
+
+SOURCES += src/ImageDecoders.cpp
+HEADERS += inc/tp_maps_sdl/ImageDecoders.h
+
+SOURCES += src/ImageRowSink.cpp
+HEADERS += inc/tp_maps_sdl/ImageRowSink.h
+
+SOURCES += src/ColorMapPool.cpp
+HEADERS += inc/tp_maps_sdl/ColorMapPool.h
+
+SOURCES += src/TextureAtlas.cpp
+HEADERS += inc/tp_maps_sdl/TextureAtlas.h
+
+SOURCES += src/TextureCompression.cpp
+HEADERS += inc/tp_maps_sdl/TextureCompression.h
+
+SOURCES += src/MemoryPressure.cpp
+HEADERS += inc/tp_maps_sdl/MemoryPressure.h
+
+SOURCES += src/FramebufferConfig.cpp
+HEADERS += inc/tp_maps_sdl/FramebufferConfig.h
+
+SOURCES += src/DamageRegion.cpp
+HEADERS += inc/tp_maps_sdl/DamageRegion.h
+
+SOURCES += src/GLDamagePresenter.cpp
+HEADERS += inc/tp_maps_sdl/GLDamagePresenter.h
+
+SOURCES += src/Trace.cpp
+HEADERS += inc/tp_maps_sdl/Trace.h
+
+SOURCES += src/WorkerPool.cpp
+HEADERS += inc/tp_maps_sdl/WorkerPool.h
+
+SOURCES += src/FramePacer.cpp
+HEADERS += inc/tp_maps_sdl/FramePacer.h
+
+SOURCES += src/InputLatency.cpp
+HEADERS += inc/tp_maps_sdl/InputLatency.h
+
+SOURCES += src/GPUProfiler.cpp
+HEADERS += inc/tp_maps_sdl/GPUProfiler.h
+
+SOURCES += src/GLGPUProfiler.cpp
+HEADERS += inc/tp_maps_sdl/GLGPUProfiler.h
+
+SOURCES += src/CacheFile.cpp
+HEADERS += inc/tp_maps_sdl/CacheFile.h
+
+SOURCES += src/GLProgramBinaryCache.cpp
+HEADERS += inc/tp_maps_sdl/GLProgramBinaryCache.h
+
+SOURCES += src/GLProfileCache.cpp
+HEADERS += inc/tp_maps_sdl/GLProfileCache.h
+
+SOURCES += src/VulkanGPUProfiler.cpp
+HEADERS += inc/tp_maps_sdl/VulkanGPUProfiler.h